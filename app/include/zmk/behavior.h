@@ -58,6 +58,46 @@ const struct device *zmk_behavior_get_binding(const char *name);
 int zmk_behavior_invoke_binding(const struct zmk_behavior_binding *src_binding,
                                 struct zmk_behavior_binding_event event, bool pressed);
 
+/**
+ * @brief The device and locality of a behavior binding, looked up ahead of time.
+ */
+struct zmk_behavior_resolved_binding {
+    // NULL if the binding has no behavior, or its behavior was not found.
+    const struct device *behavior;
+    // An enum behavior_locality value.
+    uint8_t locality;
+};
+
+/**
+ * @brief Look up the behavior device and locality of a binding, so it can be invoked repeatedly
+ * without searching for the behavior by name each time.
+ *
+ * @param binding Behavior binding to resolve.
+ * @param resolved Filled in with the behavior device and locality, or zeroed on failure.
+ *
+ * @retval 0 If successful.
+ * @retval -ENODEV if the behavior is not found.
+ * @retval Negative errno code if failure.
+ */
+int zmk_behavior_resolve_binding(const struct zmk_behavior_binding *binding,
+                                 struct zmk_behavior_resolved_binding *resolved);
+
+/**
+ * @brief Invoke a behavior given its binding, the result of resolving that binding with
+ * zmk_behavior_resolve_binding(), and invoking event details.
+ *
+ * @param src_binding Behavior binding to invoke.
+ * @param resolved The resolved device and locality of @p src_binding.
+ * @param event The binding event struct containing details of the event that invoked it.
+ * @param pressed Whether the binding is pressed or released.
+ *
+ * @retval 0 If successful.
+ * @retval Negative errno code if failure.
+ */
+int zmk_behavior_invoke_resolved_binding(const struct zmk_behavior_binding *src_binding,
+                                         const struct zmk_behavior_resolved_binding *resolved,
+                                         struct zmk_behavior_binding_event event, bool pressed);
+
 /**
  * @brief Get a local ID for a behavior from its @p name field.
  *
@@ -9,14 +9,48 @@
 #include <stddef.h>
 #include <zephyr/kernel.h>
 #include <zephyr/types.h>
+#include <zephyr/sys/iterable_sections.h>
+
+/**
+ * @brief Per event type dispatch range, filled in at init time.
+ *
+ * Indexes into the flattened listener table built by the event manager, so that raising an event
+ * only visits the listeners subscribed to its type.
+ */
+struct zmk_event_dispatch {
+    uint8_t start;
+    uint8_t len;
+};
+
+/**
+ * @brief Pool of fixed-size blocks that captured events of one type are moved into.
+ *
+ * Only event types implemented with ZMK_EVENT_IMPL_WITH_ARENA have one.
+ */
+struct zmk_event_arena {
+    struct k_mem_slab *slab;
+    size_t event_size;
+    size_t block_size;
+    uint32_t max_used;
+    uint32_t copies;
+    uint32_t copies_avoided;
+};
 
 struct zmk_event_type {
     const char *name;
+    struct zmk_event_dispatch *dispatch;
+#if IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+    struct zmk_event_arena *arena;
+#endif
 };
 
 typedef struct {
     const struct zmk_event_type *event;
     uint8_t last_listener_index;
+#if IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+    // Number of holders of this event when it lives in an arena block, 0 otherwise.
+    uint8_t arena_refs;
+#endif
 } zmk_event_t;
 
 #define ZMK_EV_EVENT_BUBBLE 0
@@ -33,6 +67,18 @@ struct zmk_event_subscription {
     const struct zmk_listener *listener;
 };
 
+/**
+ * @brief Entry in the flattened listener table. One slot is reserved per subscription, and the
+ * table is grouped by event type at init, preserving subscription order within each type.
+ *
+ * Each slot also holds two buckets of the hash table that maps an event type and listener to the
+ * listener's slot, used by RAISE_AFTER and RAISE_AT.
+ */
+struct zmk_event_dispatch_slot {
+    const struct zmk_listener *listener;
+    uint8_t lookup[2];
+};
+
 #define ZMK_EVENT_DECLARE(event_type)                                                              \
     struct event_type##_event {                                                                    \
         zmk_event_t header;                                                                        \
@@ -43,13 +89,25 @@ struct zmk_event_subscription {
     struct event_type *as_##event_type(const zmk_event_t *eh);                                     \
     extern const struct zmk_event_type zmk_event_##event_type;
 
-#define ZMK_EVENT_IMPL(event_type)                                                                 \
-    const struct zmk_event_type zmk_event_##event_type = {.name = STRINGIFY(event_type)};          \
+#if IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+#define Z_ZMK_EVENT_ARENA_INIT(arena_ptr) , .arena = arena_ptr
+#define Z_ZMK_EVENT_CLEAR_ARENA_REFS(ev) (ev).header.arena_refs = 0
+#else
+#define Z_ZMK_EVENT_ARENA_INIT(arena_ptr)
+#define Z_ZMK_EVENT_CLEAR_ARENA_REFS(ev)
+#endif
+
+#define Z_ZMK_EVENT_IMPL(event_type, arena_ptr)                                                    \
+    static struct zmk_event_dispatch zmk_event_dispatch_##event_type;                              \
+    const struct zmk_event_type zmk_event_##event_type = {                                         \
+        .name = STRINGIFY(event_type),                                                             \
+        .dispatch = &zmk_event_dispatch_##event_type Z_ZMK_EVENT_ARENA_INIT(arena_ptr)};           \
     const struct zmk_event_type *zmk_event_ref_##event_type __used                                 \
         __attribute__((__section__(".event_type"))) = &zmk_event_##event_type;                     \
     struct event_type##_event copy_raised_##event_type(const struct event_type *ev) {              \
-        struct event_type##_event *outer = CONTAINER_OF(ev, struct event_type##_event, data);      \
-        return *outer;                                                                             \
+        struct event_type##_event copy = *CONTAINER_OF(ev, struct event_type##_event, data);       \
+        Z_ZMK_EVENT_CLEAR_ARENA_REFS(copy);                                                        \
+        return copy;                                                                               \
     };                                                                                             \
     int raise_##event_type(struct event_type data) {                                               \
         struct event_type##_event ev = {.data = data,                                              \
@@ -61,6 +119,33 @@ struct zmk_event_subscription {
                                                       : NULL;                                      \
     };
 
+#define ZMK_EVENT_IMPL(event_type) Z_ZMK_EVENT_IMPL(event_type, NULL)
+
+/**
+ * @brief Like ZMK_EVENT_IMPL, but when CONFIG_ZMK_EVENT_ARENA is enabled, also defines a pool that
+ * listeners can capture events of this type into with zmk_event_arena_capture().
+ *
+ * @param max_captured The most events of this type that listeners can hold captured at once, used
+ * as the pool size unless CONFIG_ZMK_EVENT_ARENA_BLOCKS overrides it.
+ */
+#if IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+#define ZMK_EVENT_ARENA_BLOCKS(max_captured)                                                       \
+    (CONFIG_ZMK_EVENT_ARENA_BLOCKS > 0 ? CONFIG_ZMK_EVENT_ARENA_BLOCKS : MAX(max_captured, 1))
+
+#define ZMK_EVENT_IMPL_WITH_ARENA(event_type, max_captured)                                        \
+    K_MEM_SLAB_DEFINE_STATIC(zmk_event_slab_##event_type,                                          \
+                             ROUND_UP(sizeof(struct event_type##_event), 8),                       \
+                             ZMK_EVENT_ARENA_BLOCKS(max_captured), 8);                             \
+    static struct zmk_event_arena zmk_event_arena_##event_type = {                                 \
+        .slab = &zmk_event_slab_##event_type,                                                      \
+        .event_size = sizeof(struct event_type##_event),                                           \
+        .block_size = ROUND_UP(sizeof(struct event_type##_event), 8),                              \
+    };                                                                                             \
+    Z_ZMK_EVENT_IMPL(event_type, &zmk_event_arena_##event_type)
+#else
+#define ZMK_EVENT_IMPL_WITH_ARENA(event_type, max_captured) ZMK_EVENT_IMPL(event_type)
+#endif
+
 #define ZMK_LISTENER(mod, cb) const struct zmk_listener zmk_listener_##mod = {.callback = cb};
 
 #define ZMK_SUBSCRIPTION(mod, ev_type)                                                             \
@@ -70,7 +155,9 @@ struct zmk_event_subscription {
         __attribute__((__section__(".event_subscription"))) = {                                    \
             .event_type = &zmk_event_##ev_type,                                                    \
             .listener = &zmk_listener_##mod,                                                       \
-    };
+    };                                                                                             \
+    STRUCT_SECTION_ITERABLE(zmk_event_dispatch_slot,                                               \
+                            _CONCAT(_CONCAT(zmk_event_slot_, mod), ev_type));
 
 #define ZMK_EVENT_RAISE(ev) zmk_event_manager_raise(&(ev).header)
 
@@ -84,4 +171,42 @@ struct zmk_event_subscription {
 int zmk_event_manager_raise(zmk_event_t *event);
 int zmk_event_manager_raise_after(zmk_event_t *event, const struct zmk_listener *listener);
 int zmk_event_manager_raise_at(zmk_event_t *event, const struct zmk_listener *listener);
-int zmk_event_manager_release(zmk_event_t *event);
\ No newline at end of file
+int zmk_event_manager_release(zmk_event_t *event);
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+
+struct zmk_event_arena_stats {
+    uint32_t blocks_used;
+    uint32_t blocks_max_used;
+    uint32_t block_size;
+    uint32_t copies;
+    uint32_t copies_avoided;
+};
+
+/**
+ * @brief Take a reference to an event that a listener is capturing.
+ *
+ * If the event already lives in an arena block, e.g. because it is being replayed by another
+ * listener, the block is shared and its reference count is incremented. Otherwise the event is
+ * copied into a free block of its type's arena.
+ *
+ * @return The captured event, which stays valid until zmk_event_arena_unref() is called on it,
+ * or NULL if the event type has no arena or the arena has no free blocks.
+ */
+zmk_event_t *zmk_event_arena_capture(const zmk_event_t *event);
+
+/**
+ * @brief Drop a reference taken with zmk_event_arena_capture(), freeing the block once the last
+ * reference is gone.
+ */
+void zmk_event_arena_unref(zmk_event_t *event);
+
+/**
+ * @brief Get the usage statistics of an event type's arena.
+ *
+ * @return 0 on success, -ENOTSUP if the event type has no arena.
+ */
+int zmk_event_arena_get_stats(const struct zmk_event_type *type,
+                              struct zmk_event_arena_stats *stats);
+
+#endif // IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
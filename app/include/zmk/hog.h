@@ -9,7 +9,17 @@
 #include <zmk/keys.h>
 #include <zmk/hid.h>
 
+struct zmk_hog_report_stats {
+    // Reports successfully handed to the BLE stack.
+    uint32_t sent;
+    // Reports merged into a queued report that had not been sent yet.
+    uint32_t coalesced;
+    // Queued reports discarded because the queue was full.
+    uint32_t dropped;
+};
+
 int zmk_hog_send_keyboard_report(struct zmk_hid_keyboard_report_body *body);
+void zmk_hog_get_keyboard_report_stats(struct zmk_hog_report_stats *stats);
 int zmk_hog_send_consumer_report(struct zmk_hid_consumer_report_body *body);
 
 #if IS_ENABLED(CONFIG_ZMK_POINTING)
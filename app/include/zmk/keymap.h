@@ -30,7 +30,40 @@ typedef uint8_t zmk_keymap_layer_id_t;
  */
 typedef uint8_t zmk_keymap_layer_index_t;
 
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_LAYER_STATE_64_BIT)
+typedef uint64_t zmk_keymap_layers_state_t;
+#else
 typedef uint32_t zmk_keymap_layers_state_t;
+#endif
+
+/**
+ * @brief The maximum number of layers that fit in a zmk_keymap_layers_state_t
+ */
+#define ZMK_KEYMAP_LAYERS_STATE_MAX_LEN (sizeof(zmk_keymap_layers_state_t) * 8)
+
+/**
+ * @brief The bit for the given layer in a zmk_keymap_layers_state_t, usable in constant
+ * expressions.
+ */
+#define ZMK_KEYMAP_LAYERS_STATE_BIT(layer) ((zmk_keymap_layers_state_t)1 << (layer))
+
+static inline bool zmk_keymap_layers_state_test(zmk_keymap_layers_state_t state,
+                                                zmk_keymap_layer_id_t layer) {
+    return layer < ZMK_KEYMAP_LAYERS_STATE_MAX_LEN && (state & ZMK_KEYMAP_LAYERS_STATE_BIT(layer));
+}
+
+static inline void zmk_keymap_layers_state_write(zmk_keymap_layers_state_t *state,
+                                                 zmk_keymap_layer_id_t layer, bool value) {
+    if (layer >= ZMK_KEYMAP_LAYERS_STATE_MAX_LEN) {
+        return;
+    }
+
+    if (value) {
+        *state |= ZMK_KEYMAP_LAYERS_STATE_BIT(layer);
+    } else {
+        *state &= ~ZMK_KEYMAP_LAYERS_STATE_BIT(layer);
+    }
+}
 
 zmk_keymap_layer_id_t zmk_keymap_layer_index_to_id(zmk_keymap_layer_index_t layer_index);
 
@@ -73,6 +106,46 @@ int zmk_keymap_save_changes(void);
 int zmk_keymap_discard_changes(void);
 int zmk_keymap_reset_settings(void);
 
+enum zmk_keymap_change_type {
+    ZMK_KEYMAP_CHANGE_BINDING,
+    ZMK_KEYMAP_CHANGE_LAYER_ORDER,
+    ZMK_KEYMAP_CHANGE_LAYER_NAME,
+};
+
+/**
+ * @brief A single change recorded in the keymap change journal.
+ */
+struct zmk_keymap_change {
+    enum zmk_keymap_change_type type;
+    zmk_keymap_layer_id_t layer_id;
+    /**
+     * @brief For binding changes, the changed position in the stock keymap, which does not depend
+     * on the selected physical layout.
+     */
+    uint32_t key_position;
+};
+
+typedef int (*zmk_keymap_change_cb)(const struct zmk_keymap_change *change, void *user_data);
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL)
+
+/**
+ * @brief Get the current keymap revision, which is bumped by every change to the keymap.
+ */
+uint32_t zmk_keymap_get_revision(void);
+
+/**
+ * @brief Invoke the callback for each change made after the given revision, oldest first. A
+ * negative return value from the callback stops the iteration and is returned.
+ *
+ * @retval 0 once every change has been visited.
+ * @retval -ENOENT if the journal no longer holds all of the changes since the revision, and the
+ * full keymap must be fetched again.
+ */
+int zmk_keymap_foreach_change_since(uint32_t revision, zmk_keymap_change_cb cb, void *user_data);
+
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL)
+
 int zmk_keymap_position_state_changed(uint8_t source, uint32_t position, bool pressed,
                                       int64_t timestamp);
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief The stages a local key position change passes through on its way to the host.
+ *
+ * Every stage is timed relative to the kscan callback that first saw the change.
+ */
+enum zmk_latency_trace_stage {
+    ZMK_LATENCY_TRACE_STAGE_KSCAN,
+    ZMK_LATENCY_TRACE_STAGE_MSGQ_DRAIN,
+    ZMK_LATENCY_TRACE_STAGE_DISPATCH,
+    ZMK_LATENCY_TRACE_STAGE_BEHAVIOR,
+    ZMK_LATENCY_TRACE_STAGE_HID,
+    ZMK_LATENCY_TRACE_STAGE_TRANSPORT,
+    ZMK_LATENCY_TRACE_STAGE_COUNT,
+};
+
+struct zmk_latency_trace_stats {
+    uint32_t samples;
+    uint32_t min_us;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+};
+
+#if IS_ENABLED(CONFIG_ZMK_LATENCY_TRACE)
+
+static inline uint32_t zmk_latency_trace_now(void) { return k_cycle_get_32(); }
+
+/**
+ * @brief Start tracing a position change that was seen by kscan at the given cycle count.
+ *
+ * Stages stamped before the matching zmk_latency_trace_end() are attributed to this trace.
+ */
+void zmk_latency_trace_begin(uint32_t kscan_cycles);
+
+/**
+ * @brief Record the first time the in-flight trace reaches the given stage.
+ */
+void zmk_latency_trace_stamp(enum zmk_latency_trace_stage stage);
+
+/**
+ * @brief Finish the in-flight trace and store it in the sample ring.
+ */
+void zmk_latency_trace_end(void);
+
+int zmk_latency_trace_get_stats(enum zmk_latency_trace_stage stage,
+                                struct zmk_latency_trace_stats *stats);
+
+void zmk_latency_trace_reset(void);
+
+void zmk_latency_trace_log_dump(void);
+
+#else
+
+static inline uint32_t zmk_latency_trace_now(void) { return 0; }
+static inline void zmk_latency_trace_begin(uint32_t kscan_cycles) {}
+static inline void zmk_latency_trace_stamp(enum zmk_latency_trace_stage stage) {}
+static inline void zmk_latency_trace_end(void) {}
+
+#endif // IS_ENABLED(CONFIG_ZMK_LATENCY_TRACE)
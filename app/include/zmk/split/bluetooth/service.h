@@ -6,16 +6,46 @@
 
 #pragma once
 
+#include <zephyr/sys/util.h>
+
 #include <zmk/events/sensor_event.h>
 #include <zmk/sensors.h>
 
 #define ZMK_SPLIT_RUN_BEHAVIOR_DEV_LEN 9
 
+#define ZMK_SPLIT_POS_STATE_LEN 16
+
+// Position state notifications carry the full bitmap, followed by the (little endian) transport
+// timestamp of the change that produced it. Centrals only rely on the bitmap being present.
+struct zmk_split_position_state_payload {
+    uint8_t state[ZMK_SPLIT_POS_STATE_LEN];
+    uint16_t timestamp;
+} __packed;
+
+#define ZMK_SPLIT_POSITION_DELTA_FLAG_KEYFRAME BIT(0)
+
+#define ZMK_SPLIT_POSITION_DELTA_PRESSED BIT(7)
+#define ZMK_SPLIT_POSITION_DELTA_POSITION_MASK BIT_MASK(7)
+
+// Position delta notifications carry a sequence number that increments by one per notification,
+// so the central can tell when it missed one. Keyframes carry the full bitmap in `data`, all
+// others carry one byte per changed position: the position, with ZMK_SPLIT_POSITION_DELTA_PRESSED
+// set if it is now pressed. Deltas hold the new state rather than a toggle, so applying one twice
+// is harmless.
+struct zmk_split_position_delta_payload {
+    uint8_t seq;
+    uint8_t flags;
+    uint16_t timestamp;
+    uint8_t data[ZMK_SPLIT_POS_STATE_LEN];
+} __packed;
+
 struct sensor_event {
     uint8_t sensor_index;
 
     uint8_t channel_data_size;
     struct zmk_sensor_channel_data channel_data[ZMK_SENSOR_EVENT_MAX_CHANNELS];
+
+    uint16_t timestamp;
 } __packed;
 
 struct zmk_split_run_behavior_data {
@@ -31,6 +61,17 @@ struct zmk_split_run_behavior_payload {
     char behavior_dev[ZMK_SPLIT_RUN_BEHAVIOR_DEV_LEN];
 } __packed;
 
+// The behavior local ID table is a sequence of entries, each a (little endian) local ID followed by
+// the behavior's null terminated name. Centrals use it to map their own behaviors to the
+// peripheral's local IDs, so they can invoke them by ID instead of by name. Centrals skip entries
+// with names longer than ZMK_SPLIT_BEHAVIOR_LOCAL_ID_NAME_MAX_LEN, including the terminator.
+#define ZMK_SPLIT_BEHAVIOR_LOCAL_ID_NAME_MAX_LEN 32
+
+struct zmk_split_run_behavior_by_id_payload {
+    struct zmk_split_run_behavior_data data;
+    uint16_t behavior_local_id;
+} __packed;
+
 struct zmk_split_input_event_payload {
     uint8_t type;
     uint16_t code;
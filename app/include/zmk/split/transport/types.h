@@ -10,11 +10,25 @@
 #include <zmk/sensors.h>
 #include <zephyr/sys/util.h>
 
+/**
+ * Peripheral event timestamps are the low 16 bits of the peripheral's uptime in milliseconds. The
+ * central reconstructs the full time using the clock offset learned from clock sync events. A value
+ * of ZMK_SPLIT_TRANSPORT_TIMESTAMP_NONE means the time is unknown and the arrival time is used.
+ */
+#define ZMK_SPLIT_TRANSPORT_TIMESTAMP_NONE 0
+
+static inline uint16_t zmk_split_transport_timestamp(int64_t timestamp) {
+    uint16_t ts = (uint16_t)timestamp;
+
+    return ts == ZMK_SPLIT_TRANSPORT_TIMESTAMP_NONE ? ts + 1 : ts;
+}
+
 enum zmk_split_transport_peripheral_event_type {
     ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_KEY_POSITION_EVENT,
     ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_SENSOR_EVENT,
     ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_INPUT_EVENT,
     ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_BATTERY_EVENT,
+    ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_CLOCK_SYNC_EVENT,
 };
 
 struct zmk_split_transport_peripheral_event {
@@ -24,12 +38,14 @@ struct zmk_split_transport_peripheral_event {
         struct {
             uint8_t position;
             uint8_t pressed;
+            uint16_t timestamp;
         } key_position_event;
 
         struct {
             struct zmk_sensor_channel_data channel_data;
 
             uint8_t sensor_index;
+            uint16_t timestamp;
         } sensor_event;
 
         struct {
@@ -43,6 +59,10 @@ struct zmk_split_transport_peripheral_event {
         struct {
             uint8_t level;
         } battery_event;
+
+        struct {
+            uint32_t uptime;
+        } clock_sync_event;
     } data;
 } __packed;
 
@@ -51,6 +71,7 @@ enum zmk_split_transport_central_command_type {
     ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_INVOKE_BEHAVIOR,
     ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SET_PHYSICAL_LAYOUT,
     ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SET_HID_INDICATORS,
+    ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SYNC_CLOCK,
 } __packed;
 
 struct zmk_split_transport_central_command {
@@ -63,6 +84,12 @@ struct zmk_split_transport_central_command {
             uint32_t position;
             uint8_t event_source;
             uint8_t state;
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+            // The central's local ID for the behavior, or UINT16_MAX if unknown. The BLE transport
+            // may send the peripheral's local ID instead, with an empty behavior_dev. Only the BLE
+            // transport enables this, so the wired command layout doesn't change.
+            uint16_t behavior_local_id;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
         } invoke_behavior;
 
         struct {
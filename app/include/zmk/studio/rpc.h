@@ -33,6 +33,13 @@ typedef zmk_studio_Response(subsystem_func)(const struct zmk_rpc_subsystem *subs
 
 typedef zmk_studio_Response(rpc_func)(const zmk_studio_Request *neq);
 
+/**
+ * @brief Upper bounds on the subsystem and request choices, which size the dispatch table built
+ *        when the RPC subsystem is initialized.
+ */
+#define ZMK_RPC_SUBSYSTEM_CHOICE_MAX 8
+#define ZMK_RPC_REQUEST_CHOICE_MAX 32
+
 /**
  * @brief An RPC subsystem is a cohesive collection of related RPCs. A specific RPC is identified by
  *        the pair or subsystem and request identifiers. This struct is the high level entity to
@@ -85,6 +92,8 @@ struct zmk_rpc_subsystem_settings_reset {
         uint8_t which_req = req->subsystem.prefix.which_request_type;                              \
         return zmk_rpc_subsystem_delegate_to_subs(subsys, req, which_req);                         \
     }                                                                                              \
+    BUILD_ASSERT(zmk_studio_Request_##prefix##_tag < ZMK_RPC_SUBSYSTEM_CHOICE_MAX,                 \
+                 "Subsystem choice too large for the RPC dispatch table");                         \
     STRUCT_SECTION_ITERABLE(zmk_rpc_subsystem, prefix##_subsystem) = {                             \
         .func = subsystem_func_##prefix,                                                           \
         .subsystem_choice = zmk_studio_Request_##prefix##_tag,                                     \
@@ -101,6 +110,8 @@ struct zmk_rpc_subsystem_settings_reset {
  *        zmk_studio_Response (*func)(const zmk_studio_Request*)
  */
 #define ZMK_RPC_SUBSYSTEM_HANDLER(prefix, request_id, _security)                                   \
+    BUILD_ASSERT(zmk_##prefix##_Request_##request_id##_tag < ZMK_RPC_REQUEST_CHOICE_MAX,           \
+                 "Request choice too large for the RPC dispatch table");                           \
     STRUCT_SECTION_ITERABLE(zmk_rpc_subsystem_handler,                                             \
                             prefix##_subsystem_handler_##request_id) = {                           \
         .func = request_id,                                                                        \
@@ -218,6 +229,8 @@ zmk_studio_Response zmk_rpc_subsystem_delegate_to_subs(const struct zmk_rpc_subs
 struct ring_buf *zmk_rpc_get_tx_buf(void);
 struct ring_buf *zmk_rpc_get_rx_buf(void);
 void zmk_rpc_rx_notify(void);
+/** Called by a transport after it takes bytes out of the TX buffer, to wake a blocked writer. */
+void zmk_rpc_tx_space_notify(void);
 
 #define ZMK_RPC_TRANSPORT(name, _transport, _rx_start, _rx_stop, _tx_user_data, _tx_notify)        \
     STRUCT_SECTION_ITERABLE(zmk_rpc_transport, name) = {                                           \
@@ -8,9 +8,24 @@
 
 #include <stdint.h>
 
+struct zmk_usb_hid_stats {
+    // Reports the host has read from the interrupt IN endpoint.
+    uint32_t sent;
+    // Mouse reports whose movement was added to a report that had not been sent yet.
+    uint32_t merged;
+    // Reports lost to a full queue or a failed endpoint write.
+    uint32_t dropped;
+    // Transfers that never completed, e.g. because of a bus reset.
+    uint32_t timeouts;
+    // Total and longest time between writing a report and the host reading it.
+    uint32_t busy_us_total;
+    uint32_t busy_us_max;
+};
+
 int zmk_usb_hid_send_keyboard_report(void);
 int zmk_usb_hid_send_consumer_report(void);
 #if IS_ENABLED(CONFIG_ZMK_POINTING)
 int zmk_usb_hid_send_mouse_report(void);
 #endif // IS_ENABLED(CONFIG_ZMK_POINTING)
 void zmk_usb_hid_set_protocol(uint8_t protocol);
+void zmk_usb_hid_get_stats(struct zmk_usb_hid_stats *stats);
@@ -10,6 +10,9 @@
 #include <zephyr/pm/device.h>
 #include <zephyr/drivers/kscan.h>
 #include <zephyr/logging/log.h>
+
+#include <zmk/kscan_event_time.h>
+
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #define MATRIX_NODE_ID DT_DRV_INST(0)
@@ -18,17 +21,16 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 struct kscan_composite_child_config {
     const struct device *child;
+    /** The composite device which includes the child. */
+    const struct device *composite;
+    /** Callback given to the child, which forwards its events using this config. */
+    kscan_callback_t callback;
     uint8_t row_offset;
     uint8_t column_offset;
 };
 
-#define CHILD_CONFIG(inst)                                                                         \
-    {.child = DEVICE_DT_GET(DT_PHANDLE(inst, kscan)),                                              \
-     .row_offset = DT_PROP(inst, row_offset),                                                      \
-     .column_offset = DT_PROP_OR(inst, col_offset, DT_PROP(inst, column_offset))},
-
 struct kscan_composite_config {
-    const struct kscan_composite_child_config *children;
+    const struct kscan_composite_child_config *const *children;
     size_t children_len;
 };
 
@@ -42,7 +44,7 @@ static int kscan_composite_enable_callback(const struct device *dev) {
     const struct kscan_composite_config *cfg = dev->config;
 
     for (int i = 0; i < cfg->children_len; i++) {
-        const struct kscan_composite_child_config *child_cfg = &cfg->children[i];
+        const struct kscan_composite_child_config *child_cfg = cfg->children[i];
 
 #if IS_ENABLED(CONFIG_PM_DEVICE_RUNTIME) || IS_ENABLED(CONFIG_PM_DEVICE)
         if (pm_device_wakeup_is_enabled(dev) && pm_device_wakeup_is_capable(child_cfg->child) &&
@@ -67,7 +69,7 @@ static int kscan_composite_enable_callback(const struct device *dev) {
 static int kscan_composite_disable_callback(const struct device *dev) {
     const struct kscan_composite_config *cfg = dev->config;
     for (int i = 0; i < cfg->children_len; i++) {
-        const struct kscan_composite_child_config *child_cfg = &cfg->children[i];
+        const struct kscan_composite_child_config *child_cfg = cfg->children[i];
 
 #if IS_ENABLED(CONFIG_PM_DEVICE_RUNTIME) || IS_ENABLED(CONFIG_PM_DEVICE)
         if (pm_device_wakeup_is_capable(child_cfg->child) &&
@@ -90,31 +92,36 @@ static int kscan_composite_disable_callback(const struct device *dev) {
     return 0;
 }
 
-#define KSCAN_COMP_INST_DEV(n) DEVICE_DT_GET(DT_DRV_INST(n)),
-
-static const struct device *all_instances[] = {DT_INST_FOREACH_STATUS_OKAY(KSCAN_COMP_INST_DEV)};
-
-static void kscan_composite_child_callback(const struct device *child_dev, uint32_t row,
-                                           uint32_t column, bool pressed) {
-    // TODO: Ideally we can get this passed into our callback!
-    for (int i = 0; i < ARRAY_SIZE(all_instances); i++) {
-
-        const struct device *dev = all_instances[i];
-        const struct kscan_composite_config *cfg = dev->config;
-        struct kscan_composite_data *data = dev->data;
-
-        for (int c = 0; c < cfg->children_len; c++) {
-            const struct kscan_composite_child_config *child_cfg = &cfg->children[c];
+static void kscan_composite_child_callback(const struct kscan_composite_child_config *child_cfg,
+                                           uint32_t row, uint32_t column, bool pressed) {
+    const struct device *dev = child_cfg->composite;
+    struct kscan_composite_data *data = dev->data;
 
-            if (child_cfg->child != child_dev) {
-                continue;
-            }
+    zmk_kscan_event_time_set(dev, zmk_kscan_event_time_get(child_cfg->child));
+    data->callback(dev, row + child_cfg->row_offset, column + child_cfg->column_offset, pressed);
+}
 
-            data->callback(dev, row + child_cfg->row_offset, column + child_cfg->column_offset,
-                           pressed);
-        }
+// The kscan callback only identifies the child device, so each child gets its
+// own callback which already knows which composite and offsets to use.
+#define CHILD_CONFIG_NAME(node_id) _CONCAT(kscan_composite_child_, DT_DEP_ORD(node_id))
+#define CHILD_CALLBACK_NAME(node_id) _CONCAT(kscan_composite_child_callback_, DT_DEP_ORD(node_id))
+
+#define CHILD_CONFIG(node_id)                                                                      \
+    static void CHILD_CALLBACK_NAME(node_id)(const struct device *child_dev, uint32_t row,         \
+                                             uint32_t column, bool pressed);                       \
+    static const struct kscan_composite_child_config CHILD_CONFIG_NAME(node_id) = {                \
+        .child = DEVICE_DT_GET(DT_PHANDLE(node_id, kscan)),                                        \
+        .composite = DEVICE_DT_GET(DT_PARENT(node_id)),                                            \
+        .callback = CHILD_CALLBACK_NAME(node_id),                                                  \
+        .row_offset = DT_PROP(node_id, row_offset),                                                \
+        .column_offset = DT_PROP_OR(node_id, col_offset, DT_PROP(node_id, column_offset)),         \
+    };                                                                                             \
+    static void CHILD_CALLBACK_NAME(node_id)(const struct device *child_dev, uint32_t row,         \
+                                             uint32_t column, bool pressed) {                      \
+        kscan_composite_child_callback(&CHILD_CONFIG_NAME(node_id), row, column, pressed);         \
     }
-}
+
+#define CHILD_CONFIG_REF(node_id) &CHILD_CONFIG_NAME(node_id),
 
 static int kscan_composite_configure(const struct device *dev, kscan_callback_t callback) {
     const struct kscan_composite_config *cfg = dev->config;
@@ -125,9 +132,9 @@ static int kscan_composite_configure(const struct device *dev, kscan_callback_t
     }
 
     for (int i = 0; i < cfg->children_len; i++) {
-        const struct kscan_composite_child_config *child_cfg = &cfg->children[i];
+        const struct kscan_composite_child_config *child_cfg = cfg->children[i];
 
-        kscan_config(child_cfg->child, &kscan_composite_child_callback);
+        kscan_config(child_cfg->child, child_cfg->callback);
     }
 
     data->callback = callback;
@@ -169,8 +176,9 @@ static int kscan_composite_pm_action(const struct device *dev, enum pm_device_ac
 #endif // IS_ENABLED(CONFIG_PM_DEVICE)
 
 #define KSCAN_COMP_DEV(n)                                                                          \
-    static const struct kscan_composite_child_config kscan_composite_children_##n[] = {            \
-        DT_INST_FOREACH_CHILD(n, CHILD_CONFIG)};                                                   \
+    DT_INST_FOREACH_CHILD(n, CHILD_CONFIG)                                                         \
+    static const struct kscan_composite_child_config *const kscan_composite_children_##n[] = {     \
+        DT_INST_FOREACH_CHILD(n, CHILD_CONFIG_REF)};                                               \
     static const struct kscan_composite_config kscan_composite_config_##n = {                      \
         .children = kscan_composite_children_##n,                                                  \
         .children_len = ARRAY_SIZE(kscan_composite_children_##n),                                  \
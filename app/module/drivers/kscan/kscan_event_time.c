@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include <zmk/kscan_event_time.h>
+
+// Enough for a composite kscan plus a few children. Devices beyond this fall back to the current
+// uptime rather than sharing a slot with another device.
+#define KSCAN_EVENT_TIME_SLOTS 4
+
+static struct {
+    const struct device *dev;
+    int64_t timestamp;
+} last_event_times[KSCAN_EVENT_TIME_SLOTS];
+
+static struct k_spinlock event_time_lock;
+
+void zmk_kscan_event_time_set(const struct device *dev, int64_t timestamp) {
+    if (dev == NULL) {
+        return;
+    }
+
+    K_SPINLOCK(&event_time_lock) {
+        for (int i = 0; i < ARRAY_SIZE(last_event_times); i++) {
+            if (last_event_times[i].dev == NULL) {
+                last_event_times[i].dev = dev;
+            }
+
+            if (last_event_times[i].dev == dev) {
+                last_event_times[i].timestamp = timestamp;
+                break;
+            }
+        }
+    }
+}
+
+int64_t zmk_kscan_event_time_get(const struct device *dev) {
+    int64_t timestamp = -1;
+
+    if (dev != NULL) {
+        K_SPINLOCK(&event_time_lock) {
+            for (int i = 0; i < ARRAY_SIZE(last_event_times); i++) {
+                if (last_event_times[i].dev == dev) {
+                    timestamp = last_event_times[i].timestamp;
+                    break;
+                }
+            }
+        }
+    }
+
+    return timestamp < 0 ? k_uptime_get() : timestamp;
+}
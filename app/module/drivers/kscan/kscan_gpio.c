@@ -7,6 +7,7 @@
 #include "kscan_gpio.h"
 
 #include <stdlib.h>
+#include <zephyr/kernel.h>
 
 static int compare_ports(const void *a, const void *b) {
     const struct kscan_gpio *gpio_a = a;
@@ -31,3 +32,15 @@ int kscan_gpio_pin_get(const struct kscan_gpio *gpio, struct kscan_gpio_port_sta
 
     return (state->value & BIT(gpio->spec.pin)) != 0;
 }
+
+int32_t kscan_gpio_scan_clock_tick(struct kscan_gpio_scan_clock *clock, const int32_t period_ms) {
+    const int64_t now = k_uptime_get();
+    const int64_t elapsed = clock->running ? now - clock->last_scan_time : period_ms;
+
+    clock->last_scan_time = now;
+    clock->running = true;
+
+    return MIN(elapsed, INT32_MAX);
+}
+
+void kscan_gpio_scan_clock_stop(struct kscan_gpio_scan_clock *clock) { clock->running = false; }
@@ -32,6 +32,20 @@ struct kscan_gpio_list {
 #define KSCAN_GPIO_LIST(gpio_array)                                                                \
     ((struct kscan_gpio_list){.gpios = gpio_array, .len = ARRAY_SIZE(gpio_array)})
 
+/**
+ * Get the slowest scan period which reports a change debounced for debounce_ms within
+ * budget_ms. A change is latched at most one period after the debounce time elapses, and when
+ * polling it can take up to one more period for a scan to first see it.
+ */
+#define KSCAN_GPIO_BUDGET_SCAN_PERIOD_MS(budget_ms, debounce_ms)                                   \
+    MAX(1, ((budget_ms) - (debounce_ms)) / 2)
+
+/** Tracks when a driver last scanned, so debouncers count the time which actually elapsed. */
+struct kscan_gpio_scan_clock {
+    int64_t last_scan_time;
+    bool running;
+};
+
 struct kscan_gpio_port_state {
     const struct device *port;
     gpio_port_value_t value;
@@ -59,3 +73,19 @@ void kscan_gpio_list_sort_by_port(struct kscan_gpio_list *list);
  * @retval -EWOULDBLOCK if operation would block.
  */
 int kscan_gpio_pin_get(const struct kscan_gpio *gpio, struct kscan_gpio_port_state *state);
+
+/**
+ * Get the time since the previous scan in milliseconds, to pass to zmk_debounce_update().
+ *
+ * Nothing is known about the switches while a driver is idle, so the first scan after
+ * kscan_gpio_scan_clock_stop() counts as one period_ms instead.
+ *
+ * @param clock The clock for the driver which is scanning.
+ * @param period_ms The time between scans while any key is active.
+ */
+int32_t kscan_gpio_scan_clock_tick(struct kscan_gpio_scan_clock *clock, const int32_t period_ms);
+
+/**
+ * Mark a driver as idle, e.g. because it returned to waiting for an interrupt.
+ */
+void kscan_gpio_scan_clock_stop(struct kscan_gpio_scan_clock *clock);
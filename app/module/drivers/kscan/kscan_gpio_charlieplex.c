@@ -4,7 +4,10 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include "kscan_gpio.h"
+
 #include <zmk/debounce.h>
+#include <zmk/kscan_event_time.h>
 
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
@@ -58,6 +61,7 @@ struct kscan_charlieplex_data {
     kscan_callback_t callback;
     struct k_work_delayable work;
     int64_t scan_time; /* Timestamp of the current or scheduled scan. */
+    struct kscan_gpio_scan_clock scan_clock;
     struct gpio_callback irq_callback;
     /**
      * Current state of the matrix as a flattened 2D array of length
@@ -235,6 +239,8 @@ static void kscan_charlieplex_read_end(const struct device *dev) {
     struct kscan_charlieplex_data *data = dev->data;
     const struct kscan_charlieplex_config *config = dev->config;
 
+    kscan_gpio_scan_clock_stop(&data->scan_clock);
+
     if (config->use_interrupt) {
         // Return to waiting for an interrupt.
         kscan_charlieplex_interrupt_enable(dev);
@@ -250,6 +256,8 @@ static int kscan_charlieplex_read(const struct device *dev) {
     struct kscan_charlieplex_data *data = dev->data;
     const struct kscan_charlieplex_config *config = dev->config;
     bool continue_scan = false;
+    const int32_t elapsed_ms =
+        kscan_gpio_scan_clock_tick(&data->scan_clock, config->debounce_scan_period_ms);
 
     // NOTE: RR vs MATRIX: set all pins as input, in case there was a failure on a
     // previous scan, and one of the pins is still set as output
@@ -278,7 +286,7 @@ static int kscan_charlieplex_read(const struct device *dev) {
             const int index = state_index(config, row, col);
 
             struct zmk_debounce_state *state = &data->charlieplex_state[index];
-            zmk_debounce_update(state, gpio_pin_get_dt(in_gpio), config->debounce_scan_period_ms,
+            zmk_debounce_update(state, gpio_pin_get_dt(in_gpio), elapsed_ms,
                                 &config->debounce_config);
 
             // NOTE: RR vs MATRIX: because we don't need an input/output => row/column
@@ -287,6 +295,7 @@ static int kscan_charlieplex_read(const struct device *dev) {
                 const bool pressed = zmk_debounce_is_pressed(state);
 
                 LOG_DBG("Sending event at %i,%i state %s", row, col, pressed ? "on" : "off");
+                zmk_kscan_event_time_set(dev, data->scan_time);
                 data->callback(dev, row, col, pressed);
             }
             continue_scan = continue_scan || zmk_debounce_is_active(state);
@@ -332,6 +341,7 @@ static int kscan_charlieplex_configure(const struct device *dev, const kscan_cal
 static int kscan_charlieplex_enable(const struct device *dev) {
     struct kscan_charlieplex_data *data = dev->data;
     data->scan_time = k_uptime_get();
+    kscan_gpio_scan_clock_stop(&data->scan_clock);
 
     // Read will automatically start interrupts/polling once done.
     return kscan_charlieplex_read(dev);
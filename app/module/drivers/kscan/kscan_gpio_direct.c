@@ -16,6 +16,8 @@
 #include <zephyr/sys/util.h>
 
 #include <zmk/debounce.h>
+#include <zmk/kscan_event_time.h>
+#include <zmk/kscan_scan_rate.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -35,6 +37,15 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
     DT_INST_PROP_OR(n, debounce_period, DT_INST_PROP(n, debounce_release_ms))
 #endif
 
+#define INST_DEBOUNCE_ALGORITHM(n) DT_INST_ENUM_IDX(n, debounce_algorithm)
+
+#define INST_DEBOUNCE_SCAN_PERIOD_MS(n)                                                            \
+    (DT_INST_PROP(n, latency_budget_ms) > 0                                                        \
+         ? KSCAN_GPIO_BUDGET_SCAN_PERIOD_MS(                                                       \
+               DT_INST_PROP(n, latency_budget_ms),                                                 \
+               MAX(INST_DEBOUNCE_PRESS_MS(n), INST_DEBOUNCE_RELEASE_MS(n)))                        \
+         : DT_INST_PROP(n, debounce_scan_period_ms))
+
 #define USE_POLLING IS_ENABLED(CONFIG_ZMK_KSCAN_DIRECT_POLLING)
 #define USE_INTERRUPTS (!USE_POLLING)
 
@@ -67,8 +78,14 @@ struct kscan_direct_data {
 #endif
     /** Timestamp of the current or scheduled scan. */
     int64_t scan_time;
+    struct kscan_gpio_scan_clock scan_clock;
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_ADAPTIVE_SCAN_RATE)
+    struct zmk_kscan_scan_rate scan_rate;
+#endif
     /** Current state of the inputs as an array of length config->inputs.len */
     struct zmk_debounce_state *pin_state;
+    /** Debounce timer shared by all inputs when deferring per row. */
+    struct zmk_debounce_state row_state;
 };
 
 struct kscan_direct_config {
@@ -149,21 +166,39 @@ static int kscan_inputs_set_flags(const struct kscan_gpio_list *inputs,
     return 0;
 }
 
-static void kscan_direct_read_continue(const struct device *dev) {
-    const struct kscan_direct_config *config = dev->config;
+static void kscan_direct_read_continue(const struct device *dev, const int32_t period_ms) {
     struct kscan_direct_data *data = dev->data;
 
-    data->scan_time += config->debounce_scan_period_ms;
+    data->scan_time += period_ms;
 
     k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
 }
 
+/**
+ * Get the time until the next scan, or 0 to return to waiting for an interrupt or slow polling.
+ */
+static int32_t kscan_direct_next_period(const struct device *dev, const bool continue_scan) {
+    const struct kscan_direct_config *config = dev->config;
+
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_ADAPTIVE_SCAN_RATE)
+    struct kscan_direct_data *data = dev->data;
+
+    return zmk_kscan_scan_rate_update(&data->scan_rate, data->scan_time, continue_scan,
+                                      config->debounce_scan_period_ms, config->poll_period_ms);
+#else
+    return continue_scan ? config->debounce_scan_period_ms : 0;
+#endif
+}
+
 static void kscan_direct_read_end(const struct device *dev) {
+    struct kscan_direct_data *data = dev->data;
+
+    kscan_gpio_scan_clock_stop(&data->scan_clock);
+
 #if USE_INTERRUPTS
     // Return to waiting for an interrupt.
     kscan_direct_interrupt_enable(dev);
 #else
-    struct kscan_direct_data *data = dev->data;
     const struct kscan_direct_config *config = dev->config;
 
     data->scan_time += config->poll_period_ms;
@@ -177,6 +212,9 @@ static int kscan_direct_read(const struct device *dev) {
     struct kscan_direct_data *data = dev->data;
     const struct kscan_direct_config *config = dev->config;
 
+    const int32_t elapsed_ms =
+        kscan_gpio_scan_clock_tick(&data->scan_clock, config->debounce_scan_period_ms);
+
     // Read the inputs.
     struct kscan_gpio_port_state state = {0};
 
@@ -189,10 +227,14 @@ static int kscan_direct_read(const struct device *dev) {
             return active;
         }
 
-        zmk_debounce_update(&data->pin_state[gpio->index], active, config->debounce_scan_period_ms,
+        zmk_debounce_update(&data->pin_state[gpio->index], active, elapsed_ms,
                             &config->debounce_config);
     }
 
+    // All inputs form one row.
+    zmk_debounce_update_row(&data->row_state, data->pin_state, data->inputs.len, 1, elapsed_ms,
+                            &config->debounce_config);
+
     // Process the new state.
     bool continue_scan = false;
 
@@ -204,6 +246,7 @@ static int kscan_direct_read(const struct device *dev) {
             const bool pressed = zmk_debounce_is_pressed(deb_state);
 
             LOG_DBG("Sending event at 0,%i state %s", gpio->index, pressed ? "on" : "off");
+            zmk_kscan_event_time_set(dev, data->scan_time);
             data->callback(dev, 0, gpio->index, pressed);
             if (config->toggle_mode && pressed) {
                 kscan_inputs_set_flags(&data->inputs, &gpio->spec);
@@ -213,10 +256,12 @@ static int kscan_direct_read(const struct device *dev) {
         continue_scan = continue_scan || zmk_debounce_is_active(deb_state);
     }
 
-    if (continue_scan) {
-        // At least one key is pressed or the debouncer has not yet decided if
-        // it is pressed. Poll quickly until everything is released.
-        kscan_direct_read_continue(dev);
+    const int32_t period_ms = kscan_direct_next_period(dev, continue_scan);
+
+    if (period_ms > 0) {
+        // At least one key is pressed, the debouncer has not yet decided if
+        // it is pressed, or a key was released recently. Keep polling.
+        kscan_direct_read_continue(dev, period_ms);
     } else {
         // All keys are released. Return to normal.
         kscan_direct_read_end(dev);
@@ -246,6 +291,7 @@ static int kscan_direct_enable(const struct device *dev) {
     struct kscan_direct_data *data = dev->data;
 
     data->scan_time = k_uptime_get();
+    kscan_gpio_scan_clock_stop(&data->scan_clock);
 
     // Read will automatically start interrupts/polling once done.
     return kscan_direct_read(dev);
@@ -337,6 +383,10 @@ static int kscan_direct_init(const struct device *dev) {
 
     k_work_init_delayable(&data->work, kscan_direct_work_handler);
 
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_ADAPTIVE_SCAN_RATE)
+    zmk_kscan_scan_rate_init(&data->scan_rate, dev);
+#endif
+
 #if IS_ENABLED(CONFIG_PM_DEVICE)
     pm_device_init_suspended(dev);
 
@@ -402,8 +452,9 @@ static const struct kscan_driver_api kscan_direct_api = {
             {                                                                                      \
                 .debounce_press_ms = INST_DEBOUNCE_PRESS_MS(n),                                    \
                 .debounce_release_ms = INST_DEBOUNCE_RELEASE_MS(n),                                \
+                .algorithm = INST_DEBOUNCE_ALGORITHM(n),                                           \
             },                                                                                     \
-        .debounce_scan_period_ms = DT_INST_PROP(n, debounce_scan_period_ms),                       \
+        .debounce_scan_period_ms = INST_DEBOUNCE_SCAN_PERIOD_MS(n),                                \
         .poll_period_ms = DT_INST_PROP(n, poll_period_ms),                                         \
         .toggle_mode = DT_INST_PROP(n, toggle_mode),                                               \
     };                                                                                             \
@@ -17,6 +17,8 @@
 #include <zephyr/sys/util.h>
 
 #include <zmk/debounce.h>
+#include <zmk/kscan_event_time.h>
+#include <zmk/kscan_scan_rate.h>
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -45,6 +47,30 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
     DT_INST_PROP_OR(n, debounce_period, DT_INST_PROP(n, debounce_release_ms))
 #endif
 
+#define INST_DEBOUNCE_ALGORITHM(n) DT_INST_ENUM_IDX(n, debounce_algorithm)
+
+#define INST_DEBOUNCE_SCAN_PERIOD_MS(n)                                                            \
+    (DT_INST_PROP(n, latency_budget_ms) > 0                                                        \
+         ? KSCAN_GPIO_BUDGET_SCAN_PERIOD_MS(                                                       \
+               DT_INST_PROP(n, latency_budget_ms),                                                 \
+               MAX(INST_DEBOUNCE_PRESS_MS(n), INST_DEBOUNCE_RELEASE_MS(n)))                        \
+         : DT_INST_PROP(n, debounce_scan_period_ms))
+
+#define INST_DEBOUNCE_PRESS_SCANS(n)                                                               \
+    DIV_ROUND_UP(INST_DEBOUNCE_PRESS_MS(n), MAX(INST_DEBOUNCE_SCAN_PERIOD_MS(n), 1))
+#define INST_DEBOUNCE_RELEASE_SCANS(n)                                                             \
+    DIV_ROUND_UP(INST_DEBOUNCE_RELEASE_MS(n), MAX(INST_DEBOUNCE_SCAN_PERIOD_MS(n), 1))
+#define INST_DEBOUNCE_PLANES(n)                                                                    \
+    DEBOUNCE_PACKED_PLANES(MAX(INST_DEBOUNCE_PRESS_SCANS(n), INST_DEBOUNCE_RELEASE_SCANS(n)))
+#define INST_OUTPUTS_LEN(n) COND_DIODE_DIR(n, (INST_ROWS_LEN(n)), (INST_COLS_LEN(n)))
+#define INST_PACKED_STATE_LEN(n)                                                                   \
+    (INST_OUTPUTS_LEN(n) * DEBOUNCE_PACKED_STATE_LEN(INST_DEBOUNCE_PLANES(n)))
+
+#define USE_PACKED_SCAN IS_ENABLED(CONFIG_ZMK_KSCAN_MATRIX_PACKED_SCAN)
+
+#define COND_PACKED_SCAN(packedcode, keycode)                                                      \
+    COND_CODE_1(CONFIG_ZMK_KSCAN_MATRIX_PACKED_SCAN, packedcode, keycode)
+
 #define USE_POLLING IS_ENABLED(CONFIG_ZMK_KSCAN_MATRIX_POLLING)
 #define USE_INTERRUPTS (!USE_POLLING)
 
@@ -78,16 +104,34 @@ struct kscan_matrix_data {
 #endif
     /** Timestamp of the current or scheduled scan. */
     int64_t scan_time;
+    struct kscan_gpio_scan_clock scan_clock;
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_ADAPTIVE_SCAN_RATE)
+    struct zmk_kscan_scan_rate scan_rate;
+#endif
+#if USE_PACKED_SCAN
+    /**
+     * Current state of the matrix as one packed debounce state per output, indexed by output
+     * index. Bit N of each state is the key at input index N.
+     */
+    uint32_t *packed_state;
+#else
     /**
      * Current state of the matrix as a flattened 2D array of length
      * (config->rows * config->cols)
      */
     struct zmk_debounce_state *matrix_state;
+    /** Row debounce timers as an array of length config->rows */
+    struct zmk_debounce_state *row_state;
+#endif
 };
 
 struct kscan_matrix_config {
     struct kscan_gpio_list outputs;
+#if USE_PACKED_SCAN
+    struct zmk_debounce_packed_config debounce_config;
+#else
     struct zmk_debounce_config debounce_config;
+#endif
     size_t rows;
     size_t cols;
     int32_t debounce_scan_period_ms;
@@ -191,21 +235,39 @@ static void kscan_matrix_irq_callback_handler(const struct device *port, struct
 }
 #endif
 
-static void kscan_matrix_read_continue(const struct device *dev) {
-    const struct kscan_matrix_config *config = dev->config;
+static void kscan_matrix_read_continue(const struct device *dev, const int32_t period_ms) {
     struct kscan_matrix_data *data = dev->data;
 
-    data->scan_time += config->debounce_scan_period_ms;
+    data->scan_time += period_ms;
 
     k_work_reschedule(&data->work, K_TIMEOUT_ABS_MS(data->scan_time));
 }
 
+/**
+ * Get the time until the next scan, or 0 to return to waiting for an interrupt or slow polling.
+ */
+static int32_t kscan_matrix_next_period(const struct device *dev, const bool continue_scan) {
+    const struct kscan_matrix_config *config = dev->config;
+
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_ADAPTIVE_SCAN_RATE)
+    struct kscan_matrix_data *data = dev->data;
+
+    return zmk_kscan_scan_rate_update(&data->scan_rate, data->scan_time, continue_scan,
+                                      config->debounce_scan_period_ms, config->poll_period_ms);
+#else
+    return continue_scan ? config->debounce_scan_period_ms : 0;
+#endif
+}
+
 static void kscan_matrix_read_end(const struct device *dev) {
+    struct kscan_matrix_data *data = dev->data;
+
+    kscan_gpio_scan_clock_stop(&data->scan_clock);
+
 #if USE_INTERRUPTS
     // Return to waiting for an interrupt.
     kscan_matrix_interrupt_enable(dev);
 #else
-    struct kscan_matrix_data *data = dev->data;
     const struct kscan_matrix_config *config = dev->config;
 
     data->scan_time += config->poll_period_ms;
@@ -215,17 +277,130 @@ static void kscan_matrix_read_end(const struct device *dev) {
 #endif
 }
 
-static int kscan_matrix_read(const struct device *dev) {
+static int kscan_matrix_set_output(const struct kscan_gpio *out_gpio, const int value) {
+    int err = gpio_pin_set_dt(&out_gpio->spec, value);
+    if (err) {
+        LOG_ERR("Failed to set output %i %s: %i", out_gpio->index, value ? "active" : "inactive",
+                err);
+    }
+
+    return err;
+}
+
+#if USE_PACKED_SCAN
+
+/**
+ * Read every input while the given output is active.
+ *
+ * @param active_mask Set to a bitmask where bit N is set if the input with index N is active.
+ */
+static int kscan_matrix_read_inputs(const struct device *dev, const struct kscan_gpio *out_gpio,
+                                    uint32_t *active_mask) {
+    const struct kscan_matrix_data *data = dev->data;
+
+    int err = kscan_matrix_set_output(out_gpio, 1);
+    if (err) {
+        return err;
+    }
+
+#if CONFIG_ZMK_KSCAN_MATRIX_WAIT_BEFORE_INPUTS > 0
+    k_busy_wait(CONFIG_ZMK_KSCAN_MATRIX_WAIT_BEFORE_INPUTS);
+#endif
+
+    // Inputs are sorted by port, so this reads each port once.
+    struct kscan_gpio_port_state state = {0};
+    *active_mask = 0;
+
+    for (int i = 0; i < data->inputs.len; i++) {
+        const struct kscan_gpio *in_gpio = &data->inputs.gpios[i];
+
+        const int active = kscan_gpio_pin_get(in_gpio, &state);
+        if (active < 0) {
+            LOG_ERR("Failed to read port %s: %i", in_gpio->spec.port->name, active);
+            return active;
+        }
+
+        *active_mask |= (uint32_t)active << in_gpio->index;
+    }
+
+    err = kscan_matrix_set_output(out_gpio, 0);
+    if (err) {
+        return err;
+    }
+
+#if CONFIG_ZMK_KSCAN_MATRIX_WAIT_BETWEEN_OUTPUTS > 0
+    k_busy_wait(CONFIG_ZMK_KSCAN_MATRIX_WAIT_BETWEEN_OUTPUTS);
+#endif
+
+    return 0;
+}
+
+/**
+ * Scan the matrix and raise events for any keys which changed.
+ *
+ * Each output's inputs are debounced together as one bitmask, and only the keys
+ * whose latched state flipped are visited. Events are raised in output order.
+ *
+ * @returns whether any key is pressed or not yet debounced, or a negative error code.
+ */
+static int kscan_matrix_scan(const struct device *dev) {
     struct kscan_matrix_data *data = dev->data;
     const struct kscan_matrix_config *config = dev->config;
+    const size_t state_len = DEBOUNCE_PACKED_STATE_LEN(config->debounce_config.planes);
+
+    bool continue_scan = false;
+
+    for (int i = 0; i < config->outputs.len; i++) {
+        const struct kscan_gpio *out_gpio = &config->outputs.gpios[i];
+
+        uint32_t active_mask;
+        int err = kscan_matrix_read_inputs(dev, out_gpio, &active_mask);
+        if (err) {
+            return err;
+        }
+
+        uint32_t *state = &data->packed_state[out_gpio->index * state_len];
+        uint32_t changed = zmk_debounce_packed_update(state, active_mask, &config->debounce_config);
+
+        while (changed) {
+            const int input_idx = find_lsb_set(changed) - 1;
+            const bool pressed = zmk_debounce_packed_get_pressed(state) & BIT(input_idx);
+            const int row = config->diode_direction == KSCAN_ROW2COL ? out_gpio->index : input_idx;
+            const int col = config->diode_direction == KSCAN_ROW2COL ? input_idx : out_gpio->index;
+
+            changed &= ~BIT(input_idx);
+
+            LOG_DBG("Sending event at %i,%i state %s", row, col, pressed ? "on" : "off");
+            zmk_kscan_event_time_set(dev, data->scan_time);
+            data->callback(dev, row, col, pressed);
+        }
+
+        continue_scan =
+            continue_scan || zmk_debounce_packed_get_active(state, &config->debounce_config);
+    }
+
+    return continue_scan;
+}
+
+#else // USE_PACKED_SCAN
+
+/**
+ * Scan the matrix and raise events for any keys which changed.
+ *
+ * @returns whether any key is pressed or not yet debounced, or a negative error code.
+ */
+static int kscan_matrix_scan(const struct device *dev) {
+    struct kscan_matrix_data *data = dev->data;
+    const struct kscan_matrix_config *config = dev->config;
+    const int32_t elapsed_ms =
+        kscan_gpio_scan_clock_tick(&data->scan_clock, config->debounce_scan_period_ms);
 
     // Scan the matrix.
     for (int i = 0; i < config->outputs.len; i++) {
         const struct kscan_gpio *out_gpio = &config->outputs.gpios[i];
 
-        int err = gpio_pin_set_dt(&out_gpio->spec, 1);
+        int err = kscan_matrix_set_output(out_gpio, 1);
         if (err) {
-            LOG_ERR("Failed to set output %i active: %i", out_gpio->index, err);
             return err;
         }
 
@@ -244,13 +419,12 @@ static int kscan_matrix_read(const struct device *dev) {
                 return active;
             }
 
-            zmk_debounce_update(&data->matrix_state[index], active, config->debounce_scan_period_ms,
+            zmk_debounce_update(&data->matrix_state[index], active, elapsed_ms,
                                 &config->debounce_config);
         }
 
-        err = gpio_pin_set_dt(&out_gpio->spec, 0);
+        err = kscan_matrix_set_output(out_gpio, 0);
         if (err) {
-            LOG_ERR("Failed to set output %i inactive: %i", out_gpio->index, err);
             return err;
         }
 
@@ -263,6 +437,11 @@ static int kscan_matrix_read(const struct device *dev) {
     bool continue_scan = false;
 
     for (int r = 0; r < config->rows; r++) {
+        struct zmk_debounce_state *row_start = &data->matrix_state[state_index_rc(config, r, 0)];
+
+        zmk_debounce_update_row(&data->row_state[r], row_start, config->cols, config->rows,
+                                elapsed_ms, &config->debounce_config);
+
         for (int c = 0; c < config->cols; c++) {
             const int index = state_index_rc(config, r, c);
             struct zmk_debounce_state *state = &data->matrix_state[index];
@@ -271,6 +450,7 @@ static int kscan_matrix_read(const struct device *dev) {
                 const bool pressed = zmk_debounce_is_pressed(state);
 
                 LOG_DBG("Sending event at %i,%i state %s", r, c, pressed ? "on" : "off");
+                zmk_kscan_event_time_set(dev, data->scan_time);
                 data->callback(dev, r, c, pressed);
             }
 
@@ -278,10 +458,23 @@ static int kscan_matrix_read(const struct device *dev) {
         }
     }
 
-    if (continue_scan) {
-        // At least one key is pressed or the debouncer has not yet decided if
-        // it is pressed. Poll quickly until everything is released.
-        kscan_matrix_read_continue(dev);
+    return continue_scan;
+}
+
+#endif // USE_PACKED_SCAN
+
+static int kscan_matrix_read(const struct device *dev) {
+    const int continue_scan = kscan_matrix_scan(dev);
+    if (continue_scan < 0) {
+        return continue_scan;
+    }
+
+    const int32_t period_ms = kscan_matrix_next_period(dev, continue_scan);
+
+    if (period_ms > 0) {
+        // At least one key is pressed, the debouncer has not yet decided if
+        // it is pressed, or a key was released recently. Keep polling.
+        kscan_matrix_read_continue(dev, period_ms);
     } else {
         // All keys are released. Return to normal.
         kscan_matrix_read_end(dev);
@@ -311,6 +504,7 @@ static int kscan_matrix_enable(const struct device *dev) {
     struct kscan_matrix_data *data = dev->data;
 
     data->scan_time = k_uptime_get();
+    kscan_gpio_scan_clock_stop(&data->scan_clock);
 
     // Read will automatically start interrupts/polling once done.
     return kscan_matrix_read(dev);
@@ -453,6 +647,10 @@ static int kscan_matrix_init(const struct device *dev) {
 
     k_work_init_delayable(&data->work, kscan_matrix_work_handler);
 
+#if IS_ENABLED(CONFIG_ZMK_KSCAN_ADAPTIVE_SCAN_RATE)
+    zmk_kscan_scan_rate_init(&data->scan_rate, dev);
+#endif
+
 #if IS_ENABLED(CONFIG_PM_DEVICE)
     pm_device_init_suspended(dev);
 
@@ -497,6 +695,12 @@ static const struct kscan_driver_api kscan_matrix_api = {
                  "ZMK_KSCAN_DEBOUNCE_PRESS_MS or debounce-press-ms is too large");                 \
     BUILD_ASSERT(INST_DEBOUNCE_RELEASE_MS(n) <= DEBOUNCE_COUNTER_MAX,                              \
                  "ZMK_KSCAN_DEBOUNCE_RELEASE_MS or debounce-release-ms is too large");             \
+    COND_PACKED_SCAN(                                                                              \
+        (BUILD_ASSERT(INST_INPUTS_LEN(n) <= DEBOUNCE_PACKED_WIDTH,                                 \
+                      "ZMK_KSCAN_MATRIX_PACKED_SCAN supports up to 32 inputs");                    \
+         BUILD_ASSERT(INST_DEBOUNCE_ALGORITHM(n) == ZMK_DEBOUNCE_INTEGRATOR,                       \
+                      "ZMK_KSCAN_MATRIX_PACKED_SCAN only supports the integrator algorithm");),    \
+        ())                                                                                        \
                                                                                                    \
     static struct kscan_gpio kscan_matrix_rows_##n[] = {                                           \
         LISTIFY(INST_ROWS_LEN(n), KSCAN_GPIO_ROW_CFG_INIT, (, ), n)};                              \
@@ -504,7 +708,10 @@ static const struct kscan_driver_api kscan_matrix_api = {
     static struct kscan_gpio kscan_matrix_cols_##n[] = {                                           \
         LISTIFY(INST_COLS_LEN(n), KSCAN_GPIO_COL_CFG_INIT, (, ), n)};                              \
                                                                                                    \
-    static struct zmk_debounce_state kscan_matrix_state_##n[INST_MATRIX_LEN(n)];                   \
+    COND_PACKED_SCAN(                                                                              \
+        (static uint32_t kscan_matrix_state_##n[INST_PACKED_STATE_LEN(n)];),                       \
+        (static struct zmk_debounce_state kscan_matrix_state_##n[INST_MATRIX_LEN(n)];              \
+         static struct zmk_debounce_state kscan_matrix_row_state_##n[INST_ROWS_LEN(n)];))          \
                                                                                                    \
     COND_INTERRUPTS(                                                                               \
         (static struct kscan_matrix_irq_callback kscan_matrix_irqs_##n[INST_INPUTS_LEN(n)];))      \
@@ -512,7 +719,9 @@ static const struct kscan_driver_api kscan_matrix_api = {
     static struct kscan_matrix_data kscan_matrix_data_##n = {                                      \
         .inputs =                                                                                  \
             KSCAN_GPIO_LIST(COND_DIODE_DIR(n, (kscan_matrix_cols_##n), (kscan_matrix_rows_##n))),  \
-        .matrix_state = kscan_matrix_state_##n,                                                    \
+        COND_PACKED_SCAN((.packed_state = kscan_matrix_state_##n, ),                               \
+                         (.matrix_state = kscan_matrix_state_##n,                                  \
+                          .row_state = kscan_matrix_row_state_##n, ))                              \
         COND_INTERRUPTS((.irqs = kscan_matrix_irqs_##n, ))};                                       \
                                                                                                    \
     static const struct kscan_matrix_config kscan_matrix_config_##n = {                            \
@@ -520,12 +729,18 @@ static const struct kscan_driver_api kscan_matrix_api = {
         .cols = ARRAY_SIZE(kscan_matrix_cols_##n),                                                 \
         .outputs =                                                                                 \
             KSCAN_GPIO_LIST(COND_DIODE_DIR(n, (kscan_matrix_rows_##n), (kscan_matrix_cols_##n))),  \
-        .debounce_config =                                                                         \
-            {                                                                                      \
+        .debounce_config = COND_PACKED_SCAN(                                                       \
+            ({                                                                                     \
+                .debounce_press_scans = INST_DEBOUNCE_PRESS_SCANS(n),                              \
+                .debounce_release_scans = INST_DEBOUNCE_RELEASE_SCANS(n),                          \
+                .planes = INST_DEBOUNCE_PLANES(n),                                                 \
+            }),                                                                                    \
+            ({                                                                                     \
                 .debounce_press_ms = INST_DEBOUNCE_PRESS_MS(n),                                    \
                 .debounce_release_ms = INST_DEBOUNCE_RELEASE_MS(n),                                \
-            },                                                                                     \
-        .debounce_scan_period_ms = DT_INST_PROP(n, debounce_scan_period_ms),                       \
+                .algorithm = INST_DEBOUNCE_ALGORITHM(n),                                           \
+            })),                                                                                   \
+        .debounce_scan_period_ms = INST_DEBOUNCE_SCAN_PERIOD_MS(n),                                \
         .poll_period_ms = DT_INST_PROP(n, poll_period_ms),                                         \
         .diode_direction = INST_DIODE_DIR(n),                                                      \
     };                                                                                             \
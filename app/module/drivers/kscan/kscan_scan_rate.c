@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include <zmk/kscan_scan_rate.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#define STATS_WINDOW_MS 1000
+
+static sys_slist_t schedulers = SYS_SLIST_STATIC_INIT(&schedulers);
+
+void zmk_kscan_scan_rate_init(struct zmk_kscan_scan_rate *rate, const struct device *dev) {
+    *rate = (struct zmk_kscan_scan_rate){
+        .dev = dev,
+        .idle = true,
+    };
+
+    sys_slist_append(&schedulers, &rate->node);
+}
+
+static void update_stats(struct zmk_kscan_scan_rate *rate, const int64_t scan_time,
+                         const bool active) {
+    rate->stats.scans++;
+    if (!active) {
+        rate->stats.idle_scans++;
+    }
+
+    if (rate->window_scans == 0) {
+        rate->window_start = scan_time;
+    }
+    rate->window_scans++;
+
+    const int64_t elapsed = scan_time - rate->window_start;
+    if (elapsed >= STATS_WINDOW_MS) {
+        rate->stats.scans_per_second = (rate->window_scans - 1) * MSEC_PER_SEC / elapsed;
+        rate->window_start = scan_time;
+        rate->window_scans = 1;
+    }
+}
+
+int32_t zmk_kscan_scan_rate_update(struct zmk_kscan_scan_rate *rate, const int64_t scan_time,
+                                   const bool active, const int32_t burst_period_ms,
+                                   const int32_t idle_period_ms) {
+    update_stats(rate, scan_time, active);
+
+    if (active) {
+        if (rate->idle) {
+            rate->idle = false;
+            rate->stats.wakeups++;
+        }
+
+        rate->last_active_time = scan_time;
+        rate->period_ms = burst_period_ms;
+        return burst_period_ms;
+    }
+
+    if (rate->idle) {
+        return 0;
+    }
+
+    const int64_t since_active = scan_time - rate->last_active_time;
+
+    if (since_active < CONFIG_ZMK_KSCAN_SCAN_RATE_BURST_MS) {
+        return rate->period_ms;
+    }
+
+    if (since_active < CONFIG_ZMK_KSCAN_SCAN_RATE_BURST_MS + CONFIG_ZMK_KSCAN_SCAN_RATE_DECAY_MS) {
+        rate->period_ms = MIN(rate->period_ms * 2, MAX(idle_period_ms, burst_period_ms));
+        return rate->period_ms;
+    }
+
+    LOG_DBG("%s idle after %u scans, %u idle, %u wakeups", rate->dev->name, rate->stats.scans,
+            rate->stats.idle_scans, rate->stats.wakeups);
+
+    rate->idle = true;
+    return 0;
+}
+
+int zmk_kscan_scan_rate_get_stats(const struct device *dev,
+                                  struct zmk_kscan_scan_rate_stats *stats) {
+    struct zmk_kscan_scan_rate *rate;
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&schedulers, rate, node) {
+        if (rate->dev == dev) {
+            *stats = rate->stats;
+            return 0;
+        }
+    }
+
+    return -ENODEV;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/sys/ring_buffer.h>
+
+/** The only zero byte in an encoded frame, which ends it. */
+#define ZMK_COBS_DELIMITER 0x00
+
+/** Longest run of non-zero bytes one code byte can cover. */
+#define ZMK_COBS_MAX_RUN 254
+
+/**
+ * Most bytes that len bytes can take once encoded: one code byte per run, plus the delimiter.
+ */
+#define ZMK_COBS_ENCODED_LEN_MAX(len) ((len) + (len) / ZMK_COBS_MAX_RUN + 2)
+
+/**
+ * Encodes head followed by tail as one frame, straight into the storage of buf, and ends it
+ * with a delimiter. Either part may be empty.
+ *
+ * @param buf The buffer to queue the frame on.
+ * @param head The first part of the frame.
+ * @param head_len Length of head.
+ * @param tail The rest of the frame, e.g. a checksum of head.
+ * @param tail_len Length of tail.
+ *
+ * @retval 0 on success.
+ * @retval -ENOSPC if buf might not have room for the whole frame. Nothing is queued.
+ */
+int zmk_cobs_put(struct ring_buf *buf, const uint8_t *head, size_t head_len, const uint8_t *tail,
+                 size_t tail_len);
+
+/**
+ * Finds the next frame in buf without consuming anything.
+ *
+ * @param buf The buffer to search.
+ * @param frame_len Set to the length of the frame, not counting its delimiter.
+ *
+ * @retval 0 on success.
+ * @retval -EAGAIN if buf does not hold a delimiter yet.
+ */
+int zmk_cobs_find_frame(struct ring_buf *buf, size_t *frame_len);
+
+/**
+ * Decodes a frame in place.
+ *
+ * @param frame The frame, without its delimiter.
+ * @param len Length of the frame.
+ *
+ * @returns the decoded length, which is always less than len.
+ * @retval -EINVAL if the frame is malformed.
+ */
+int zmk_cobs_decode(uint8_t *frame, size_t len);
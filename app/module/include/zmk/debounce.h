@@ -7,6 +7,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <zephyr/sys/util.h>
 
@@ -19,11 +20,35 @@ struct zmk_debounce_state {
     uint16_t counter : DEBOUNCE_COUNTER_BITS;
 };
 
+enum zmk_debounce_algorithm {
+    /**
+     * Latch a change once the switch has been stable for the debounce time. Readings which match
+     * the latched state count back down towards zero.
+     */
+    ZMK_DEBOUNCE_INTEGRATOR,
+    /**
+     * Latch a change as soon as it is read, then ignore the switch for debounce_press_ms after a
+     * press or debounce_release_ms after a release.
+     */
+    ZMK_DEBOUNCE_EAGER,
+    /**
+     * Latch a press as soon as it is read. Latch a release once the switch has read as released
+     * for debounce_release_ms without interruption.
+     */
+    ZMK_DEBOUNCE_EAGER_PRESS,
+    /**
+     * Latch the changes in a row once no switch in the row has changed for the longer of
+     * debounce_press_ms and debounce_release_ms. Requires zmk_debounce_update_row().
+     */
+    ZMK_DEBOUNCE_DEFER_ROW,
+};
+
 struct zmk_debounce_config {
     /** Duration a switch must be pressed to latch as pressed. */
     uint32_t debounce_press_ms;
     /** Duration a switch must be released to latch as released. */
     uint32_t debounce_release_ms;
+    enum zmk_debounce_algorithm algorithm;
 };
 
 /**
@@ -37,6 +62,25 @@ struct zmk_debounce_config {
 void zmk_debounce_update(struct zmk_debounce_state *state, const bool active, const int elapsed_ms,
                          const struct zmk_debounce_config *config);
 
+/**
+ * Debounces one row of switches. For ZMK_DEBOUNCE_DEFER_ROW, zmk_debounce_update()
+ * only records each switch's reading, and this latches them once the row is
+ * stable. Other algorithms debounce each switch independently, so this does
+ * nothing for them.
+ *
+ * Call this after calling zmk_debounce_update() for every switch in the row.
+ *
+ * @param row The state for the row's timer. Must be zero-initialized before the first use.
+ * @param states The state for the first switch in the row.
+ * @param len The number of switches in the row.
+ * @param stride The distance between consecutive switches of the row in the states array.
+ * @param elapsed_ms Time elapsed since the previous update in milliseconds.
+ * @param config Debounce settings.
+ */
+void zmk_debounce_update_row(struct zmk_debounce_state *row, struct zmk_debounce_state *states,
+                             const size_t len, const size_t stride, const int elapsed_ms,
+                             const struct zmk_debounce_config *config);
+
 /**
  * @returns whether the switch is either latched as pressed or it is potentially
  * pressed but the debouncer has not yet made a decision. If this returns true,
@@ -54,3 +98,65 @@ bool zmk_debounce_is_pressed(const struct zmk_debounce_state *state);
  * debounce_update.
  */
 bool zmk_debounce_get_changed(const struct zmk_debounce_state *state);
+
+/** Maximum number of switches which can be debounced by one packed state. */
+#define DEBOUNCE_PACKED_WIDTH 32
+
+/**
+ * Number of counter bit-planes needed to count from 0 to max_scans inclusive.
+ */
+#define DEBOUNCE_PACKED_PLANES(max_scans)                                                          \
+    (1 + ((max_scans) >= BIT(1)) + ((max_scans) >= BIT(2)) + ((max_scans) >= BIT(3)) +             \
+     ((max_scans) >= BIT(4)) + ((max_scans) >= BIT(5)) + ((max_scans) >= BIT(6)) +                 \
+     ((max_scans) >= BIT(7)) + ((max_scans) >= BIT(8)) + ((max_scans) >= BIT(9)) +                 \
+     ((max_scans) >= BIT(10)) + ((max_scans) >= BIT(11)) + ((max_scans) >= BIT(12)) +              \
+     ((max_scans) >= BIT(13)))
+
+/**
+ * Number of words in one packed debounce state: one word of latched states followed by one word
+ * per counter bit-plane.
+ */
+#define DEBOUNCE_PACKED_STATE_LEN(planes) (1 + (planes))
+
+struct zmk_debounce_packed_config {
+    /** Number of scans a switch must be pressed to latch as pressed. */
+    uint16_t debounce_press_scans;
+    /** Number of scans a switch must be released to latch as released. */
+    uint16_t debounce_release_scans;
+    /**
+     * Number of counter bit-planes. Must be at least
+     * DEBOUNCE_PACKED_PLANES(MAX(debounce_press_scans, debounce_release_scans)).
+     */
+    uint8_t planes;
+};
+
+/**
+ * Debounces up to DEBOUNCE_PACKED_WIDTH switches at once.
+ *
+ * This runs the same integrator as zmk_debounce_update(), but keeps the
+ * counters as vertical bit-slices so every switch is updated with a handful of
+ * bitwise operations per plane, and returns immediately if nothing is pressed,
+ * counting, or changing.
+ *
+ * @param state Array of DEBOUNCE_PACKED_STATE_LEN(config->planes) words. Must be
+ * zero-initialized before the first use.
+ * @param active Bit N is set if switch N is currently pressed.
+ * @param config Debounce settings.
+ *
+ * @returns a bitmask of the switches whose pressed state changed.
+ */
+uint32_t zmk_debounce_packed_update(uint32_t *state, const uint32_t active,
+                                    const struct zmk_debounce_packed_config *config);
+
+/**
+ * @returns a bitmask of the switches which are either latched as pressed or
+ * potentially pressed but not yet decided. If this is non-zero, the kscan
+ * driver should continue to poll quickly.
+ */
+uint32_t zmk_debounce_packed_get_active(const uint32_t *state,
+                                        const struct zmk_debounce_packed_config *config);
+
+/**
+ * @returns a bitmask of the switches which are latched as pressed.
+ */
+uint32_t zmk_debounce_packed_get_pressed(const uint32_t *state);
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+
+#if IS_ENABLED(CONFIG_KSCAN)
+
+/**
+ * Record the uptime at which a kscan device detected the state changes it is about to report.
+ *
+ * The kscan callback signature carries no timing information, so drivers that know when a scan
+ * happened call this immediately before invoking their callback(s) for that scan, from the same
+ * thread.
+ *
+ * @param dev The kscan device reporting the changes.
+ * @param timestamp Uptime in milliseconds of the scan that detected the changes.
+ */
+void zmk_kscan_event_time_set(const struct device *dev, int64_t timestamp);
+
+/**
+ * Get the detection time of the change currently being reported by a kscan device.
+ *
+ * Intended to be called from within a kscan callback. If the device did not record a detection
+ * time, the current uptime is returned instead.
+ *
+ * @param dev The kscan device that invoked the callback.
+ */
+int64_t zmk_kscan_event_time_get(const struct device *dev);
+
+#else
+
+static inline void zmk_kscan_event_time_set(const struct device *dev, int64_t timestamp) {}
+
+static inline int64_t zmk_kscan_event_time_get(const struct device *dev) { return k_uptime_get(); }
+
+#endif // IS_ENABLED(CONFIG_KSCAN)
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/device.h>
+#include <zephyr/sys/slist.h>
+
+struct zmk_kscan_scan_rate_stats {
+    /** Number of scans over the last full second. */
+    uint32_t scans_per_second;
+    /** Total number of scans. */
+    uint32_t scans;
+    /** Number of scans which found no key pressed or debouncing. */
+    uint32_t idle_scans;
+    /** Number of times the driver left idle because a key became active. */
+    uint32_t wakeups;
+};
+
+/**
+ * Scan scheduler state for one kscan device.
+ *
+ * While a key is active, the driver scans at its burst period. Once all keys are
+ * released, it keeps scanning at the burst period for
+ * CONFIG_ZMK_KSCAN_SCAN_RATE_BURST_MS, then doubles the period on each scan, up
+ * to its idle period, for CONFIG_ZMK_KSCAN_SCAN_RATE_DECAY_MS. After that it
+ * returns to waiting for an interrupt or polling at its idle period.
+ */
+struct zmk_kscan_scan_rate {
+    sys_snode_t node;
+    const struct device *dev;
+    /** Timestamp of the last scan which found an active key. */
+    int64_t last_active_time;
+    /** Start of the current scans-per-second window. */
+    int64_t window_start;
+    uint32_t window_scans;
+    int32_t period_ms;
+    bool idle;
+    struct zmk_kscan_scan_rate_stats stats;
+};
+
+/**
+ * Initialize a scan scheduler and register it so its statistics can be found
+ * with zmk_kscan_scan_rate_get_stats().
+ */
+void zmk_kscan_scan_rate_init(struct zmk_kscan_scan_rate *rate, const struct device *dev);
+
+/**
+ * Record a completed scan and pick the time until the next one.
+ *
+ * @param rate The scheduler for the device which scanned.
+ * @param scan_time Timestamp of the scan.
+ * @param active Whether any key is pressed or not yet debounced.
+ * @param burst_period_ms Time between scans while keys are active.
+ * @param idle_period_ms The slowest period to decay to before returning to idle.
+ *
+ * @returns the time in milliseconds until the next scan, or 0 if the driver
+ * should return to idle.
+ */
+int32_t zmk_kscan_scan_rate_update(struct zmk_kscan_scan_rate *rate, int64_t scan_time,
+                                   bool active, int32_t burst_period_ms, int32_t idle_period_ms);
+
+/**
+ * Get the scan statistics for a kscan device.
+ *
+ * @retval 0 on success.
+ * @retval -ENODEV if the device does not use the scan scheduler.
+ */
+int zmk_kscan_scan_rate_get_stats(const struct device *dev,
+                                  struct zmk_kscan_scan_rate_stats *stats);
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <zmk/cobs.h>
+
+struct cobs_writer {
+    struct ring_buf *buf;
+    uint8_t *dst;
+    uint32_t avail;
+    uint32_t written;
+};
+
+// Encodes straight into the buffer's storage, so frames are never assembled anywhere else.
+static void cobs_write(struct cobs_writer *w, uint8_t byte) {
+    if (w->avail == 0) {
+        w->avail = ring_buf_put_claim(w->buf, &w->dst, UINT32_MAX);
+    }
+
+    *w->dst++ = byte;
+    w->avail--;
+    w->written++;
+}
+
+struct cobs_source {
+    const uint8_t *head;
+    size_t head_len;
+    const uint8_t *tail;
+};
+
+static inline uint8_t source_byte(const struct cobs_source *src, size_t i) {
+    return i < src->head_len ? src->head[i] : src->tail[i - src->head_len];
+}
+
+int zmk_cobs_put(struct ring_buf *buf, const uint8_t *head, size_t head_len, const uint8_t *tail,
+                 size_t tail_len) {
+    const struct cobs_source src = {.head = head, .head_len = head_len, .tail = tail};
+    const size_t len = head_len + tail_len;
+
+    if (ring_buf_space_get(buf) < ZMK_COBS_ENCODED_LEN_MAX(len)) {
+        return -ENOSPC;
+    }
+
+    struct cobs_writer w = {.buf = buf};
+    size_t i = 0;
+
+    while (true) {
+        size_t run = 0;
+        while (i + run < len && run < ZMK_COBS_MAX_RUN && source_byte(&src, i + run) != 0) {
+            run++;
+        }
+
+        cobs_write(&w, run + 1);
+        for (size_t j = 0; j < run; j++) {
+            cobs_write(&w, source_byte(&src, i + j));
+        }
+
+        i += run;
+        if (i == len) {
+            break;
+        }
+
+        // Shorter runs end at a zero, which the next code byte stands in for.
+        if (run < ZMK_COBS_MAX_RUN) {
+            i++;
+        }
+    }
+
+    cobs_write(&w, ZMK_COBS_DELIMITER);
+    ring_buf_put_finish(buf, w.written);
+
+    return 0;
+}
+
+int zmk_cobs_find_frame(struct ring_buf *buf, size_t *frame_len) {
+    size_t scanned = 0;
+    int ret = -EAGAIN;
+    uint8_t *data;
+    uint32_t claim_len;
+
+    while ((claim_len = ring_buf_get_claim(buf, &data, UINT32_MAX)) > 0) {
+        const uint8_t *delimiter = memchr(data, ZMK_COBS_DELIMITER, claim_len);
+        if (delimiter) {
+            *frame_len = scanned + (delimiter - data);
+            ret = 0;
+            break;
+        }
+
+        scanned += claim_len;
+    }
+
+    // Only looking, nothing is consumed yet.
+    ring_buf_get_finish(buf, 0);
+
+    return ret;
+}
+
+int zmk_cobs_decode(uint8_t *frame, size_t len) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < len) {
+        uint8_t code = frame[in++];
+        if (code == ZMK_COBS_DELIMITER || in + code - 1 > len) {
+            return -EINVAL;
+        }
+
+        memmove(frame + out, frame + in, code - 1);
+        in += code - 1;
+        out += code - 1;
+
+        if (code <= ZMK_COBS_MAX_RUN && in < len) {
+            frame[out++] = 0;
+        }
+    }
+
+    return out;
+}
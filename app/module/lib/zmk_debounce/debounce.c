@@ -27,15 +27,19 @@ static void decrement_counter(struct zmk_debounce_state *state, const int elapse
     }
 }
 
-void zmk_debounce_update(struct zmk_debounce_state *state, const bool active, const int elapsed_ms,
-                         const struct zmk_debounce_config *config) {
+static void flip_state(struct zmk_debounce_state *state) {
+    state->pressed = !state->pressed;
+    state->counter = 0;
+    state->changed = true;
+}
+
+static void update_integrator(struct zmk_debounce_state *state, const bool active,
+                              const int elapsed_ms, const struct zmk_debounce_config *config) {
     // This uses a variation of the integrator debouncing described at
     // https://www.kennethkuhn.com/electronics/debounce.c
     // Every update where "active" does not match the current state, we increment
     // a counter, otherwise we decrement it. When the counter reaches a
     // threshold, the state flips and we reset the counter.
-    state->changed = false;
-
     if (active == state->pressed) {
         decrement_counter(state, elapsed_ms);
         return;
@@ -48,9 +52,124 @@ void zmk_debounce_update(struct zmk_debounce_state *state, const bool active, co
         return;
     }
 
-    state->pressed = !state->pressed;
-    state->counter = 0;
-    state->changed = true;
+    flip_state(state);
+}
+
+static void update_eager(struct zmk_debounce_state *state, const bool active, const int elapsed_ms,
+                         const struct zmk_debounce_config *config) {
+    // The counter holds the time remaining before the switch may change again.
+    decrement_counter(state, elapsed_ms);
+
+    if (active == state->pressed || state->counter > 0) {
+        return;
+    }
+
+    flip_state(state);
+    state->counter = state->pressed ? config->debounce_press_ms : config->debounce_release_ms;
+}
+
+static void update_eager_press(struct zmk_debounce_state *state, const bool active,
+                               const int elapsed_ms, const struct zmk_debounce_config *config) {
+    if (!state->pressed) {
+        if (active) {
+            flip_state(state);
+        }
+        return;
+    }
+
+    // Any pressed reading restarts the release timer, so only an uninterrupted
+    // release is latched. This also rides out the bounce that follows a press.
+    if (active) {
+        state->counter = 0;
+        return;
+    }
+
+    if (state->counter < config->debounce_release_ms) {
+        increment_counter(state, elapsed_ms);
+        return;
+    }
+
+    flip_state(state);
+}
+
+// For ZMK_DEBOUNCE_DEFER_ROW, each switch's counter holds its two most recent
+// readings, and zmk_debounce_update_row() decides when to latch them.
+#define READING_LATEST BIT(0)
+#define READING_PREVIOUS BIT(1)
+
+static void update_defer_row(struct zmk_debounce_state *state, const bool active) {
+    state->counter = ((state->counter << 1) & READING_PREVIOUS) | (active ? READING_LATEST : 0);
+}
+
+void zmk_debounce_update(struct zmk_debounce_state *state, const bool active, const int elapsed_ms,
+                         const struct zmk_debounce_config *config) {
+    state->changed = false;
+
+    switch (config->algorithm) {
+    case ZMK_DEBOUNCE_INTEGRATOR:
+        update_integrator(state, active, elapsed_ms, config);
+        break;
+    case ZMK_DEBOUNCE_EAGER:
+        update_eager(state, active, elapsed_ms, config);
+        break;
+    case ZMK_DEBOUNCE_EAGER_PRESS:
+        update_eager_press(state, active, elapsed_ms, config);
+        break;
+    case ZMK_DEBOUNCE_DEFER_ROW:
+        update_defer_row(state, active);
+        break;
+    }
+}
+
+void zmk_debounce_update_row(struct zmk_debounce_state *row, struct zmk_debounce_state *states,
+                             const size_t len, const size_t stride, const int elapsed_ms,
+                             const struct zmk_debounce_config *config) {
+    if (config->algorithm != ZMK_DEBOUNCE_DEFER_ROW) {
+        return;
+    }
+
+    // The row's "pressed" flag is set while its timer is running, and its
+    // counter holds the time remaining before the row latches.
+    bool reading_changed = false;
+    bool pending = false;
+
+    for (size_t i = 0; i < len; i++) {
+        const struct zmk_debounce_state *state = &states[i * stride];
+        const bool latest = state->counter & READING_LATEST;
+        const bool previous = state->counter & READING_PREVIOUS;
+
+        reading_changed = reading_changed || latest != previous;
+        pending = pending || latest != state->pressed;
+    }
+
+    if (!pending) {
+        row->pressed = false;
+        row->counter = 0;
+        return;
+    }
+
+    if (reading_changed || !row->pressed) {
+        row->pressed = true;
+        row->counter = MAX(config->debounce_press_ms, config->debounce_release_ms);
+    } else {
+        decrement_counter(row, elapsed_ms);
+    }
+
+    if (row->counter > 0) {
+        return;
+    }
+
+    row->pressed = false;
+
+    for (size_t i = 0; i < len; i++) {
+        struct zmk_debounce_state *state = &states[i * stride];
+        const bool latest = state->counter & READING_LATEST;
+
+        if (latest != state->pressed) {
+            state->pressed = latest;
+            state->changed = true;
+        }
+    }
 }
 
 bool zmk_debounce_is_active(const struct zmk_debounce_state *state) {
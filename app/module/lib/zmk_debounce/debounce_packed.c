@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zmk/debounce.h>
+
+// state[0] holds the latched state of each switch. state[1 + i] holds bit i of
+// every switch's integrator counter, so bit N across all planes forms the
+// counter for switch N.
+#define PRESSED(state) ((state)[0])
+#define PLANES(state) (&(state)[1])
+
+static uint32_t get_counting(const uint32_t *planes, const uint8_t count) {
+    uint32_t counting = 0;
+
+    for (int i = 0; i < count; i++) {
+        counting |= planes[i];
+    }
+
+    return counting;
+}
+
+static uint32_t get_counter_equals(const uint32_t *planes, const uint8_t count,
+                                   const uint32_t value) {
+    uint32_t equal = UINT32_MAX;
+
+    for (int i = 0; i < count; i++) {
+        equal &= (value & BIT(i)) ? planes[i] : ~planes[i];
+    }
+
+    return equal;
+}
+
+uint32_t zmk_debounce_packed_update(uint32_t *state, const uint32_t active,
+                                    const struct zmk_debounce_packed_config *config) {
+    uint32_t *planes = PLANES(state);
+    const uint32_t pressed = PRESSED(state);
+    const uint32_t mismatch = active ^ pressed;
+    const uint32_t counting = get_counting(planes, config->planes);
+
+    if (!mismatch && !counting) {
+        return 0;
+    }
+
+    // A counter never exceeds the threshold for its switch's current state, so
+    // "counter >= threshold" is the same as "counter == threshold".
+    const uint32_t at_threshold =
+        (pressed & get_counter_equals(planes, config->planes, config->debounce_release_scans)) |
+        (~pressed & get_counter_equals(planes, config->planes, config->debounce_press_scans));
+
+    const uint32_t flip = mismatch & at_threshold;
+
+    // Switches which don't match their latched state count up until they reach
+    // the threshold. Switches which match count back down to zero. The two sets
+    // are disjoint, so both ripple through the planes in one pass.
+    uint32_t carry = mismatch & ~at_threshold;
+    uint32_t borrow = ~mismatch & counting;
+
+    for (int i = 0; i < config->planes; i++) {
+        const uint32_t plane = planes[i];
+
+        planes[i] = (plane ^ carry ^ borrow) & ~flip;
+        carry &= plane;
+        borrow &= ~plane;
+    }
+
+    PRESSED(state) = pressed ^ flip;
+
+    return flip;
+}
+
+uint32_t zmk_debounce_packed_get_active(const uint32_t *state,
+                                        const struct zmk_debounce_packed_config *config) {
+    return PRESSED(state) | get_counting(PLANES(state), config->planes);
+}
+
+uint32_t zmk_debounce_packed_get_pressed(const uint32_t *state) { return PRESSED(state); }
@@ -61,7 +61,13 @@ echo "Running $testcase:"
 shopt -s nullglob
 for file in $(pwd)/$testcase/peripheral*.overlay ; do
     pn=$(basename -s .overlay ${file})
-    west build -d build/${testcase%%/}_${pn}/ -b nrf52_bsim -- -DZMK_CONFIG="$(pwd)/$testcase" -DEXTRA_DTC_OVERLAY_FILE="${file}" > /dev/null 2>&1
+    # A peripheral*.conf next to the overlay applies only to that peripheral, e.g. to test
+    # halves running different firmware.
+    peripheral_cmake_args=""
+    if [ -e "$(pwd)/$testcase/${pn}.conf" ]; then
+        peripheral_cmake_args="-DEXTRA_CONF_FILE=$(pwd)/$testcase/${pn}.conf"
+    fi
+    west build -d build/${testcase%%/}_${pn}/ -b nrf52_bsim -- -DZMK_CONFIG="$(pwd)/$testcase" -DEXTRA_DTC_OVERLAY_FILE="${file}" ${peripheral_cmake_args} > /dev/null 2>&1
 
     if [ $? -gt 0 ]; then
         echo "FAILED: $testcase peripheral ${pn} did not build" | tee -a ./build/tests/pass-fail.log
@@ -6,6 +6,7 @@
 
 #include <zephyr/device.h>
 #include <zephyr/init.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/sys/crc.h>
 #include <zephyr/sys/util_macro.h>
 #include <string.h>
@@ -24,6 +25,7 @@
 #include <drivers/behavior.h>
 #include <zmk/behavior.h>
 #include <zmk/hid.h>
+#include <zmk/latency_trace.h>
 #include <zmk/matrix.h>
 
 #include <zmk/events/position_state_changed.h>
@@ -35,11 +37,16 @@ const struct device *zmk_behavior_get_binding(const char *name) {
     return behavior_get_binding(name);
 }
 
+// Counts name lookups, so tests can check that key presses don't do any.
+static atomic_t name_lookups;
+
 const struct device *z_impl_behavior_get_binding(const char *name) {
     if (name == NULL || name[0] == '\0') {
         return NULL;
     }
 
+    LOG_DBG("Looking up %s by name (%ld lookups)", name, atomic_inc(&name_lookups) + 1);
+
     STRUCT_SECTION_FOREACH(zmk_behavior_ref, item) {
         if (z_device_is_ready(item->device) && item->device->name == name) {
             return item->device;
@@ -55,53 +62,77 @@ const struct device *z_impl_behavior_get_binding(const char *name) {
     return NULL;
 }
 
-static int invoke_locally(struct zmk_behavior_binding *binding,
+static int invoke_locally(const struct device *behavior, struct zmk_behavior_binding *binding,
                           struct zmk_behavior_binding_event event, bool pressed) {
-    if (pressed) {
-        return behavior_keymap_binding_pressed(binding, event);
-    } else {
-        return behavior_keymap_binding_released(binding, event);
+    zmk_latency_trace_stamp(ZMK_LATENCY_TRACE_STAGE_BEHAVIOR);
+
+    const struct behavior_driver_api *api = (const struct behavior_driver_api *)behavior->api;
+    behavior_keymap_binding_callback_t callback =
+        pressed ? api->binding_pressed : api->binding_released;
+
+    if (callback == NULL) {
+        return -ENOTSUP;
     }
-}
 
-int zmk_behavior_invoke_binding(const struct zmk_behavior_binding *src_binding,
-                                struct zmk_behavior_binding_event event, bool pressed) {
-    // We want to make a copy of this, since it may be converted from
-    // relative to absolute before being invoked
-    struct zmk_behavior_binding binding = *src_binding;
+    return callback(binding, event);
+}
 
-    const struct device *behavior = zmk_behavior_get_binding(binding.behavior_dev);
+int zmk_behavior_resolve_binding(const struct zmk_behavior_binding *binding,
+                                 struct zmk_behavior_resolved_binding *resolved) {
+    *resolved = (struct zmk_behavior_resolved_binding){0};
 
+    const struct device *behavior = zmk_behavior_get_binding(binding->behavior_dev);
     if (!behavior) {
-        LOG_WRN("No behavior assigned to %d on layer %d", event.position, event.layer);
-        return 1;
+        return -ENODEV;
     }
 
-    int err = behavior_keymap_binding_convert_central_state_dependent_params(&binding, event);
+    enum behavior_locality locality = BEHAVIOR_LOCALITY_CENTRAL;
+    int err = behavior_get_locality(behavior, &locality);
     if (err) {
-        LOG_ERR("Failed to convert relative to absolute behavior binding (err %d)", err);
         return err;
     }
 
-    enum behavior_locality locality = BEHAVIOR_LOCALITY_CENTRAL;
-    err = behavior_get_locality(behavior, &locality);
-    if (err) {
-        LOG_ERR("Failed to get behavior locality %d", err);
-        return err;
+    resolved->behavior = behavior;
+    resolved->locality = locality;
+
+    return 0;
+}
+
+int zmk_behavior_invoke_resolved_binding(const struct zmk_behavior_binding *src_binding,
+                                         const struct zmk_behavior_resolved_binding *resolved,
+                                         struct zmk_behavior_binding_event event, bool pressed) {
+    if (!resolved->behavior) {
+        LOG_WRN("No behavior assigned to %d on layer %d", event.position, event.layer);
+        return 1;
     }
 
-    switch (locality) {
+    // We want to make a copy of this, since it may be converted from
+    // relative to absolute before being invoked
+    struct zmk_behavior_binding binding = *src_binding;
+
+    const struct behavior_driver_api *api =
+        (const struct behavior_driver_api *)resolved->behavior->api;
+
+    if (api->binding_convert_central_state_dependent_params != NULL) {
+        int err = api->binding_convert_central_state_dependent_params(&binding, event);
+        if (err) {
+            LOG_ERR("Failed to convert relative to absolute behavior binding (err %d)", err);
+            return err;
+        }
+    }
+
+    switch ((enum behavior_locality)resolved->locality) {
     case BEHAVIOR_LOCALITY_CENTRAL:
-        return invoke_locally(&binding, event, pressed);
+        return invoke_locally(resolved->behavior, &binding, event, pressed);
     case BEHAVIOR_LOCALITY_EVENT_SOURCE:
 #if IS_ENABLED(CONFIG_ZMK_SPLIT) && IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
         if (event.source == ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL) {
-            return invoke_locally(&binding, event, pressed);
+            return invoke_locally(resolved->behavior, &binding, event, pressed);
         } else {
             return zmk_split_central_invoke_behavior(event.source, &binding, event, pressed);
         }
 #else
-        return invoke_locally(&binding, event, pressed);
+        return invoke_locally(resolved->behavior, &binding, event, pressed);
 #endif
     case BEHAVIOR_LOCALITY_GLOBAL:
 #if IS_ENABLED(CONFIG_ZMK_SPLIT) && IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
@@ -109,12 +140,25 @@ int zmk_behavior_invoke_binding(const struct zmk_behavior_binding *src_binding,
             zmk_split_central_invoke_behavior(i, &binding, event, pressed);
         }
 #endif
-        return invoke_locally(&binding, event, pressed);
+        return invoke_locally(resolved->behavior, &binding, event, pressed);
     }
 
     return -ENOTSUP;
 }
 
+int zmk_behavior_invoke_binding(const struct zmk_behavior_binding *src_binding,
+                                struct zmk_behavior_binding_event event, bool pressed) {
+    struct zmk_behavior_resolved_binding resolved;
+
+    int err = zmk_behavior_resolve_binding(src_binding, &resolved);
+    if (err && err != -ENODEV) {
+        LOG_ERR("Failed to get behavior locality %d", err);
+        return err;
+    }
+
+    return zmk_behavior_invoke_resolved_binding(src_binding, &resolved, event, pressed);
+}
+
 #if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_METADATA)
 
 int zmk_behavior_get_empty_param_metadata(const struct device *dev,
@@ -266,6 +310,12 @@ zmk_behavior_local_id_t zmk_behavior_get_local_id(const char *name) {
         return UINT16_MAX;
     }
 
+    STRUCT_SECTION_FOREACH(zmk_behavior_local_id_map, item) {
+        if (z_device_is_ready(item->device) && item->device->name == name) {
+            return item->local_id;
+        }
+    }
+
     STRUCT_SECTION_FOREACH(zmk_behavior_local_id_map, item) {
         if (z_device_is_ready(item->device) && strcmp(item->device->name, name) == 0) {
             return item->local_id;
@@ -275,10 +325,63 @@ zmk_behavior_local_id_t zmk_behavior_get_local_id(const char *name) {
     return UINT16_MAX;
 }
 
+STRUCT_SECTION_START_EXTERN(zmk_behavior_local_id_map);
+
+// Once local IDs are assigned, the map is sorted by them so lookups by ID can binary search.
+static bool local_id_map_sorted;
+
+static void sort_local_id_map(void) {
+    struct zmk_behavior_local_id_map *map = STRUCT_SECTION_START(zmk_behavior_local_id_map);
+    size_t count;
+
+    STRUCT_SECTION_COUNT(zmk_behavior_local_id_map, &count);
+
+    // Insertion sort is stable, so behaviors sharing an ID keep the order the scan used to see.
+    for (size_t i = 1; i < count; i++) {
+        struct zmk_behavior_local_id_map item = map[i];
+        size_t j = i;
+
+        for (; j > 0 && map[j - 1].local_id > item.local_id; j--) {
+            map[j] = map[j - 1];
+        }
+
+        map[j] = item;
+    }
+
+    local_id_map_sorted = true;
+}
+
 const char *zmk_behavior_find_behavior_name_from_local_id(zmk_behavior_local_id_t local_id) {
-    STRUCT_SECTION_FOREACH(zmk_behavior_local_id_map, item) {
-        if (z_device_is_ready(item->device) && item->local_id == local_id) {
-            return item->device->name;
+    if (!local_id_map_sorted) {
+        STRUCT_SECTION_FOREACH(zmk_behavior_local_id_map, item) {
+            if (z_device_is_ready(item->device) && item->local_id == local_id) {
+                return item->device->name;
+            }
+        }
+
+        return NULL;
+    }
+
+    const struct zmk_behavior_local_id_map *map = STRUCT_SECTION_START(zmk_behavior_local_id_map);
+    size_t count;
+
+    STRUCT_SECTION_COUNT(zmk_behavior_local_id_map, &count);
+
+    // Find the first entry with the ID, then the first of those that is ready.
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (map[mid].local_id < local_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (; lo < count && map[lo].local_id == local_id; lo++) {
+        if (z_device_is_ready(map[lo].device)) {
+            return map[lo].device->name;
         }
     }
 
@@ -292,6 +395,8 @@ static int behavior_local_id_init(void) {
         item->local_id = crc16_ansi(item->device->name, strlen(item->device->name));
     }
 
+    sort_local_id_map();
+
     return 0;
 }
 
@@ -329,6 +434,8 @@ static int behavior_handle_set(const char *name, size_t len, settings_read_cb re
         name[len] = '\0';
         STRUCT_SECTION_FOREACH(zmk_behavior_local_id_map, item) {
             if (strcmp(name, item->device->name) == 0) {
+                // The map is sorted again once the IDs are committed.
+                local_id_map_sorted = false;
                 item->local_id = local_id;
                 largest_local_id = MAX(largest_local_id, local_id);
                 return 0;
@@ -364,6 +471,8 @@ static int behavior_handle_commit(void) {
         settings_save_one(setting_name, device_name, strlen(device_name));
     }
 
+    sort_local_id_map();
+
     return 0;
 }
 
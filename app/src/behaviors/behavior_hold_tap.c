@@ -6,6 +6,8 @@
 
 #define DT_DRV_COMPAT zmk_behavior_hold_tap
 
+#include <string.h>
+
 #include <zephyr/device.h>
 #include <drivers/behavior.h>
 #include <zmk/keys.h>
@@ -106,6 +108,34 @@ enum captured_event_tag {
     ET_CODE_CHANGED,
 };
 
+#if IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+
+// With the event arena, captured events stay in their arena block and only the handle is queued.
+struct captured_event {
+    enum captured_event_tag tag;
+    zmk_event_t *event;
+};
+
+static int init_capture(struct captured_event *capture, const zmk_event_t *eh) {
+    capture->event = zmk_event_arena_capture(eh);
+    return capture->event != NULL ? 0 : -ENOMEM;
+}
+
+static zmk_event_t *captured_header(struct captured_event *ev) { return ev->event; }
+
+static const struct zmk_position_state_changed *
+captured_position(const struct captured_event *ev) {
+    return as_zmk_position_state_changed(ev->event);
+}
+
+static const struct zmk_keycode_state_changed *captured_keycode(const struct captured_event *ev) {
+    return as_zmk_keycode_state_changed(ev->event);
+}
+
+static void release_capture(struct captured_event *ev) { zmk_event_arena_unref(ev->event); }
+
+#else
+
 union captured_event_data {
     struct zmk_position_state_changed_event position;
     struct zmk_keycode_state_changed_event keycode;
@@ -116,7 +146,54 @@ struct captured_event {
     union captured_event_data data;
 };
 
+static int init_capture(struct captured_event *capture, const zmk_event_t *eh) {
+    if (capture->tag == ET_POS_CHANGED) {
+        capture->data.position =
+            copy_raised_zmk_position_state_changed(as_zmk_position_state_changed(eh));
+    } else {
+        capture->data.keycode =
+            copy_raised_zmk_keycode_state_changed(as_zmk_keycode_state_changed(eh));
+    }
+    return 0;
+}
+
+static zmk_event_t *captured_header(struct captured_event *ev) {
+    return ev->tag == ET_POS_CHANGED ? &ev->data.position.header : &ev->data.keycode.header;
+}
+
+static const struct zmk_position_state_changed *
+captured_position(const struct captured_event *ev) {
+    return &ev->data.position.data;
+}
+
+static const struct zmk_keycode_state_changed *captured_keycode(const struct captured_event *ev) {
+    return &ev->data.keycode.data;
+}
+
+static void release_capture(struct captured_event *ev) {}
+
+#endif // IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+
+// Captured events are kept in a FIFO. Events captured for the undecided hold-tap occupy
+// [0, captured_write). While a replay is running, each replay pass owns a contiguous range of
+// events that still have to be raised again, located after the events it has re-captured.
+// Free slots are tagged ET_NONE.
 struct captured_event captured_events[ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS] = {};
+static uint8_t captured_write;
+static uint8_t captured_count;
+
+// Number of captured key-down events per position, covering [0, captured_write) only.
+static uint8_t captured_keydowns[ZMK_KEYMAP_LEN];
+
+// A replay pass raises the events in [next, end). Passes nest when a replayed event decides
+// a hold-tap that was created earlier in the same replay.
+struct replay_pass {
+    uint8_t next;
+    uint8_t end;
+    struct replay_pass *parent;
+};
+
+static struct replay_pass *current_replay_pass = NULL;
 
 // Keep track of which key was tapped most recently for the standard, if it is a hold-tap
 // a position, will be given, if not it will just be INT32_MIN
@@ -150,32 +227,74 @@ static bool is_quick_tap(struct active_hold_tap *hold_tap) {
     }
 }
 
-static int capture_event(struct captured_event *data) {
-    for (int i = 0; i < ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS; i++) {
-        if (captured_events[i].tag == ET_NONE) {
-            captured_events[i] = *data;
-            return 0;
-        }
+static void count_captured_keydown(const struct captured_event *ev) {
+    if (ev->tag != ET_POS_CHANGED) {
+        return;
+    }
+
+    const struct zmk_position_state_changed *position = captured_position(ev);
+    if (position->state && position->position < ZMK_KEYMAP_LEN) {
+        captured_keydowns[position->position]++;
     }
-    return -ENOMEM;
 }
 
-static bool have_captured_keydown_event(uint32_t position) {
-    for (int i = 0; i < ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS; i++) {
-        struct captured_event *ev = &captured_events[i];
-        if (ev->tag == ET_NONE) {
-            return false;
-        }
+// Moves the events waiting to be replayed from index up to the next free slot by one.
+static int make_room_at(uint8_t index) {
+    uint8_t free_slot = index;
+    while (free_slot < ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS &&
+           captured_events[free_slot].tag != ET_NONE) {
+        free_slot++;
+    }
 
-        if (ev->tag != ET_POS_CHANGED) {
-            continue;
+    // captured_count guarantees a free slot somewhere, and replay passes only ever leave them
+    // behind the events they still have to raise.
+    __ASSERT(free_slot < ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS,
+             "No free captured event slot after %d", index);
+    if (free_slot == ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS) {
+        return -ENOMEM;
+    }
+
+    memmove(&captured_events[index + 1], &captured_events[index],
+            (free_slot - index) * sizeof(struct captured_event));
+    captured_events[index].tag = ET_NONE;
+
+    for (struct replay_pass *pass = current_replay_pass; pass != NULL; pass = pass->parent) {
+        if (pass->next >= index && pass->next < free_slot) {
+            pass->next++;
+            pass->end++;
         }
+    }
 
-        if (ev->data.position.data.position == position && ev->data.position.data.state) {
-            return true;
+    return 0;
+}
+
+static int capture_event(enum captured_event_tag tag, const zmk_event_t *eh) {
+    if (captured_count >= ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS) {
+        return -ENOMEM;
+    }
+
+    // Only happens when a single replayed event causes more than one capture.
+    if (captured_events[captured_write].tag != ET_NONE) {
+        int err = make_room_at(captured_write);
+        if (err < 0) {
+            return err;
         }
     }
-    return false;
+
+    struct captured_event data = {.tag = tag};
+    int ret = init_capture(&data, eh);
+    if (ret < 0) {
+        return ret;
+    }
+
+    captured_events[captured_write++] = data;
+    captured_count++;
+    count_captured_keydown(&data);
+    return 0;
+}
+
+static bool have_captured_keydown_event(uint32_t position) {
+    return position < ZMK_KEYMAP_LEN && captured_keydowns[position] > 0;
 }
 
 const struct zmk_listener zmk_listener_behavior_hold_tap;
@@ -185,62 +304,58 @@ static void release_captured_events() {
         return;
     }
 
-    // We use a trick to prevent copying the captured_events array.
+    // Replay the events captured so far in the order they happened.
     //
-    // Events for different mod-tap instances are separated by a NULL pointer.
+    // A replayed event may start a new undecided hold-tap. The events after it are then
+    // captured again into the front of the queue, ahead of the events this pass has not
+    // reached yet, so no copy of the queue is needed.
     //
-    // The first event popped will never be caught by the next active hold-tap
-    // because to start capturing a mod-tap-key-down event must first completely
-    // go through the events queue.
+    // If a replayed event decides that new hold-tap, the nested call only replays what the
+    // new hold-tap captured and returns, after which this pass continues where it stopped.
     //
     // Example of this release process;
-    // [mt2_down, k1_down, k1_up, mt2_up, null, ...]
+    // [mt2_down, k1_down, k1_up, mt2_up] pass: [0, 4)
     //  ^
-    // mt2_down position event isn't captured because no hold-tap is active.
-    // mt2_down behavior event is handled, now we have an undecided hold-tap
-    // [null, k1_down, k1_up, mt2_up, null, ...]
-    //        ^
-    // k1_down  is captured by the mt2 mod-tap
-    // !note that searches for find_captured_keydown_event by the mt2 behavior will stop at the
-    // first null encountered [mt1_down, null, k1_up, mt2_up, null, ...]
-    //                  ^
-    // k1_up event is captured by the new hold-tap:
-    // [k1_down, k1_up, null, mt2_up, null, ...]
-    //                        ^
-    // mt2_up event is not captured but causes release of mt2 behavior
-    // [k1_down, k1_up, null, null, null, ...]
-    // now mt2 will start releasing it's own captured positions.
-    for (int i = 0; i < ZMK_BHV_HOLD_TAP_MAX_CAPTURED_EVENTS; i++) {
-        struct captured_event *captured_event = &captured_events[i];
-        enum captured_event_tag tag = captured_event->tag;
-
-        if (tag == ET_NONE) {
-            return;
-        }
-
-        captured_events[i].tag = ET_NONE;
-        if (undecided_hold_tap != NULL) {
-            k_msleep(10);
-        }
-
-        switch (tag) {
+    // mt2_down isn't captured because no hold-tap is active, now we have an undecided hold-tap
+    // [k1_down, -, k1_up, mt2_up] pass: [2, 4)
+    // k1_down is captured by mt2 into the first slot
+    // [k1_down, k1_up, -, mt2_up] pass: [3, 4)
+    // k1_up is captured by mt2 as well, as its key-down was captured
+    // [k1_down, k1_up, -, -] pass: [4, 4)
+    // mt2_up is not captured but decides mt2, which replays [0, 2) in a nested pass.
+    struct replay_pass pass = {.next = 0, .end = captured_write, .parent = current_replay_pass};
+    current_replay_pass = &pass;
+    captured_write = 0;
+    memset(captured_keydowns, 0, sizeof(captured_keydowns));
+
+    while (pass.next < pass.end) {
+        // The slot may be reused by captures while the event is raised, so take a copy of it.
+        struct captured_event captured_event = captured_events[pass.next];
+        captured_events[pass.next++].tag = ET_NONE;
+        captured_count--;
+
+        switch (captured_event.tag) {
         case ET_CODE_CHANGED:
             LOG_DBG("Releasing mods changed event 0x%02X %s",
-                    captured_event->data.keycode.data.keycode,
-                    (captured_event->data.keycode.data.state ? "pressed" : "released"));
-            ZMK_EVENT_RAISE_AT(captured_event->data.keycode, behavior_hold_tap);
+                    captured_keycode(&captured_event)->keycode,
+                    (captured_keycode(&captured_event)->state ? "pressed" : "released"));
             break;
         case ET_POS_CHANGED:
             LOG_DBG("Releasing key position event for position %d %s",
-                    captured_event->data.position.data.position,
-                    (captured_event->data.position.data.state ? "pressed" : "released"));
-            ZMK_EVENT_RAISE_AT(captured_event->data.position, behavior_hold_tap);
+                    captured_position(&captured_event)->position,
+                    (captured_position(&captured_event)->state ? "pressed" : "released"));
             break;
         default:
             LOG_ERR("Unhandled captured event type");
-            break;
+            continue;
         }
+
+        zmk_event_manager_raise_at(captured_header(&captured_event),
+                                   &zmk_listener_behavior_hold_tap);
+        release_capture(&captured_event);
     }
+
+    current_replay_pass = pass.parent;
 }
 
 static struct active_hold_tap *find_hold_tap(uint32_t position) {
@@ -776,11 +891,17 @@ static int position_state_changed_listener(const zmk_event_t *eh) {
 
     LOG_DBG("%d capturing %d %s event", undecided_hold_tap->position, ev->position,
             ev->state ? "down" : "up");
-    struct captured_event capture = {
-        .tag = ET_POS_CHANGED,
-        .data = {.position = copy_raised_zmk_position_state_changed(ev)},
-    };
-    capture_event(&capture);
+    if (capture_event(ET_POS_CHANGED, eh) < 0) {
+        // Rather than dropping the event, decide now so the events captured before it are replayed
+        // first, then let it bubble after them.
+        LOG_WRN("%d unable to capture %d, deciding early", undecided_hold_tap->position,
+                ev->position);
+        decide_hold_tap(undecided_hold_tap, ev->state ? HT_OTHER_KEY_DOWN : HT_OTHER_KEY_UP);
+        if (undecided_hold_tap != NULL) {
+            decide_hold_tap(undecided_hold_tap, HT_TIMER_EVENT);
+        }
+        return ZMK_EV_EVENT_BUBBLE;
+    }
     decide_hold_tap(undecided_hold_tap, ev->state ? HT_OTHER_KEY_DOWN : HT_OTHER_KEY_UP);
     return ZMK_EV_EVENT_CAPTURED;
 }
@@ -813,9 +934,11 @@ static int keycode_state_changed_listener(const zmk_event_t *eh) {
     // if a undecided_hold_tap is active.
     LOG_DBG("%d capturing 0x%02X %s event", undecided_hold_tap->position, ev->keycode,
             ev->state ? "down" : "up");
-    struct captured_event capture = {
-        .tag = ET_CODE_CHANGED, .data = {.keycode = copy_raised_zmk_keycode_state_changed(ev)}};
-    capture_event(&capture);
+    if (capture_event(ET_CODE_CHANGED, eh) < 0) {
+        LOG_WRN("%d unable to capture 0x%02X, letting it bubble", undecided_hold_tap->position,
+                ev->keycode);
+        return ZMK_EV_EVENT_BUBBLE;
+    }
     return ZMK_EV_EVENT_CAPTURED;
 }
 
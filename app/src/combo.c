@@ -50,72 +50,119 @@ struct combo_cfg {
     int16_t key_position_len;
     int16_t require_prior_idle_ms;
     int32_t timeout_ms;
-    uint32_t layer_mask;
+    zmk_keymap_layers_state_t layer_mask;
     struct zmk_behavior_binding behavior;
     // if slow release is set, the combo releases when the last key is released.
     // otherwise, the combo releases when the first key is released.
     bool slow_release;
 };
 
+#if IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+
+// With the event arena, captured key presses stay in their arena block and are kept by handle.
+typedef struct zmk_position_state_changed_event *pressed_key_t;
+
+static inline struct zmk_position_state_changed_event *pressed_key_event(pressed_key_t *key) {
+    return *key;
+}
+
+static bool store_pressed_key(pressed_key_t *key, const zmk_event_t *eh) {
+    zmk_event_t *captured = zmk_event_arena_capture(eh);
+    if (captured == NULL) {
+        return false;
+    }
+
+    *key = CONTAINER_OF(captured, struct zmk_position_state_changed_event, header);
+    return true;
+}
+
+static void unref_pressed_key(struct zmk_position_state_changed_event *ev) {
+    zmk_event_arena_unref(&ev->header);
+}
+
+#else
+
+typedef struct zmk_position_state_changed_event pressed_key_t;
+
+static inline struct zmk_position_state_changed_event *pressed_key_event(pressed_key_t *key) {
+    return key;
+}
+
+static bool store_pressed_key(pressed_key_t *key, const zmk_event_t *eh) {
+    *key = copy_raised_zmk_position_state_changed(as_zmk_position_state_changed(eh));
+    return true;
+}
+
+static void unref_pressed_key(struct zmk_position_state_changed_event *ev) {}
+
+#endif // IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+
 struct active_combo {
     uint16_t combo_idx;
     // key_positions_pressed is filled with key_positions when the combo is pressed.
     // The keys are removed from this array when they are released.
     // Once this array is empty, the behavior is released.
     uint16_t key_positions_pressed_count;
-    struct zmk_position_state_changed_event key_positions_pressed[MAX_COMBO_KEYS];
+    pressed_key_t key_positions_pressed[MAX_COMBO_KEYS];
 };
 
-#define PROP_BIT_AT_IDX(n, prop, idx) BIT(DT_PROP_BY_IDX(n, prop, idx))
-
-#define NODE_PROP_BITMASK(n, prop)                                                                 \
-    COND_CODE_1(DT_NODE_HAS_PROP(n, prop),                                                         \
-                (DT_FOREACH_PROP_ELEM_SEP(n, prop, PROP_BIT_AT_IDX, (|))), (0))
-
-#define GET_KEY_POSITION_MASK_PORTION(idx, n) ((NODE_PROP_BITMASK(n, key_positions) >> idx) & 0xFF)
-
-#define COMBO_INST(n, positions)                                                                   \
-    COND_CODE_1(IS_EQ(DT_PROP_LEN(n, key_positions), positions),                                   \
-                (                                                                                  \
-                    {                                                                              \
-                        .timeout_ms = DT_PROP(n, timeout_ms),                                      \
-                        .require_prior_idle_ms = DT_PROP(n, require_prior_idle_ms),                \
-                        .key_positions = DT_PROP(n, key_positions),                                \
-                        .key_position_len = DT_PROP_LEN(n, key_positions),                         \
-                        .behavior = ZMK_KEYMAP_EXTRACT_BINDING(0, n),                              \
-                        .slow_release = DT_PROP(n, slow_release),                                  \
-                        .layer_mask = NODE_PROP_BITMASK(n, layers),                                \
-                    }, ),                                                                          \
-                ())
-
-#define COMBO_CONFIGS_WITH_MATCHING_POSITIONS_LEN(positions, _ignore)                              \
-    DT_INST_FOREACH_CHILD_VARGS(0, COMBO_INST, positions)
-
-// We do some magic here to generate the `combos` array by "key position length", looping
-// by key position length and on each iteration, only include entries where the `key-positions`
-// length matches.
-// Doing so allows our bitmasks to be "shorted key positions list first" when searching for matches.
-// `20` is chosen as a reasonable limit, since the theoretical maximum number of keys you might
-// reasonably press simultaneously with 10 fingers is 20 keys, two keys per finger.
-static const struct combo_cfg combos[] = {
-    LISTIFY(20, COMBO_CONFIGS_WITH_MATCHING_POSITIONS_LEN, (), 0)};
+#define LAYER_BIT_AT_IDX(n, prop, idx) ZMK_KEYMAP_LAYERS_STATE_BIT(DT_PROP_BY_IDX(n, prop, idx))
+
+#define NODE_LAYERS_BITMASK(n)                                                                     \
+    COND_CODE_1(DT_NODE_HAS_PROP(n, layers),                                                       \
+                (DT_FOREACH_PROP_ELEM_SEP(n, layers, LAYER_BIT_AT_IDX, (|))), (0))
+
+#define COMBO_INST(n)                                                                              \
+    {                                                                                              \
+        .timeout_ms = DT_PROP(n, timeout_ms),                                                      \
+        .require_prior_idle_ms = DT_PROP(n, require_prior_idle_ms),                                \
+        .key_positions = DT_PROP(n, key_positions),                                                \
+        .key_position_len = DT_PROP_LEN(n, key_positions),                                         \
+        .behavior = ZMK_KEYMAP_EXTRACT_BINDING(0, n),                                              \
+        .slow_release = DT_PROP(n, slow_release),                                                  \
+        .layer_mask = NODE_LAYERS_BITMASK(n),                                                      \
+    }
+
+// The combos, in devicetree order. Everything else refers to combos by their index in
+// combo_order, which sorts them shortest key positions list first.
+static const struct combo_cfg combos[] = {DT_INST_FOREACH_CHILD_SEP(0, COMBO_INST, (, ))};
 
 #define COMBO_ONE(n) +1
 
 #define COMBO_CHILDREN_COUNT (0 DT_INST_FOREACH_CHILD(0, COMBO_ONE))
 
+#define COMBO_KEY_POSITIONS_LEN(n) +DT_PROP_LEN(n, key_positions)
+
+#define COMBO_KEY_POSITIONS_TOTAL (0 DT_INST_FOREACH_CHILD(0, COMBO_KEY_POSITIONS_LEN))
+
+BUILD_ASSERT(COMBO_KEY_POSITIONS_TOTAL <= UINT16_MAX, "Too many combo key positions");
+
 // We need at least 4 bytes to avoid alignment issues
 #define BYTES_FOR_COMBOS_MASK DIV_ROUND_UP(COMBO_CHILDREN_COUNT, 32)
 
 uint8_t pressed_keys_count = 0;
 // set of keys pressed
-struct zmk_position_state_changed_event pressed_keys[MAX_COMBO_KEYS] = {};
+pressed_key_t pressed_keys[MAX_COMBO_KEYS] = {};
 // the set of candidate combos based on the currently pressed_keys
 uint32_t candidates[BYTES_FOR_COMBOS_MASK];
 // the last candidate that was completely pressed
 int16_t fully_pressed_combo = INT16_MAX;
-// a lookup dict that maps a key position to all combos on that position
-uint32_t combo_lookup[ZMK_KEYMAP_LEN][BYTES_FOR_COMBOS_MASK] = {};
+// indexes into combos, sorted shortest key positions list first, then by devicetree order
+static uint16_t combo_order[ARRAY_SIZE(combos)];
+// a compressed sparse row lookup from a key position to all combos on that position:
+// the combos on position p are position_combos[position_combos_start[p]] up to (not including)
+// position_combos[position_combos_start[p + 1]].
+static uint16_t position_combos_start[ZMK_KEYMAP_LEN + 1];
+static uint16_t position_combos[COMBO_KEY_POSITIONS_TOTAL];
+// the set of combos enabled on each layer
+static uint32_t layer_combos[ZMK_KEYMAP_LAYERS_LEN][BYTES_FOR_COMBOS_MASK];
+// the set of combos that have a require-prior-idle-ms and need checking against the last tap
+static uint32_t idle_combos[BYTES_FOR_COMBOS_MASK];
+// combo indexes sorted by timeout, shortest first
+static uint16_t combos_by_timeout[ARRAY_SIZE(combos)];
+// all candidates before this index into combos_by_timeout have timed out or were filtered out.
+// Candidates only ever get removed while keys are pressed, so this only moves forward.
+static size_t timeout_cursor;
 // combos that have been activated and still have (some) keys pressed
 // this array is always contiguous from 0.
 struct active_combo active_combos[CONFIG_ZMK_COMBO_MAX_PRESSED_COMBOS] = {};
@@ -135,24 +182,102 @@ static void store_last_tapped(int64_t timestamp) {
     }
 }
 
-// Store the combo key pointer in the combos array, one pointer for each key position
-// The combos are sorted shortest-first, then by virtual-key-position.
+static inline const struct combo_cfg *combo_at(size_t index) {
+    return &combos[combo_order[index]];
+}
+
+static bool combo_active_on_layer(const struct combo_cfg *combo, uint8_t layer) {
+    if (!combo->layer_mask) {
+        return true;
+    }
+
+    return zmk_keymap_layers_state_test(combo->layer_mask, layer);
+}
+
+// Sort the combos shortest-first, keeping devicetree order for combos of the same length, so that
+// the first candidate in a bitmask is always the shortest one.
+static void sort_combos(void) {
+    uint16_t len_start[MAX_COMBO_KEYS + 1] = {0};
+
+    for (size_t i = 0; i < ARRAY_SIZE(combos); i++) {
+        len_start[combos[i].key_position_len]++;
+    }
+
+    for (size_t len = 0, start = 0; len <= MAX_COMBO_KEYS; len++) {
+        uint16_t count = len_start[len];
+        len_start[len] = start;
+        start += count;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(combos); i++) {
+        combo_order[len_start[combos[i].key_position_len]++] = i;
+    }
+}
+
+// Build the position to combo lookup. Filling it back to front leaves each start index pointing
+// at the first entry for its position, and the combos on each position in ascending order.
+static void build_position_combos(void) {
+    for (size_t i = 0; i < ARRAY_SIZE(combos); i++) {
+        for (size_t kp = 0; kp < combos[i].key_position_len; kp++) {
+            position_combos_start[combos[i].key_positions[kp]]++;
+        }
+    }
+
+    for (size_t pos = 0, end = 0; pos < ZMK_KEYMAP_LEN; pos++) {
+        end += position_combos_start[pos];
+        position_combos_start[pos] = end;
+    }
+    position_combos_start[ZMK_KEYMAP_LEN] = COMBO_KEY_POSITIONS_TOTAL;
+
+    for (int index = ARRAY_SIZE(combos) - 1; index >= 0; index--) {
+        const struct combo_cfg *combo = combo_at(index);
+        for (size_t kp = 0; kp < combo->key_position_len; kp++) {
+            position_combos[--position_combos_start[combo->key_positions[kp]]] = index;
+        }
+    }
+}
+
 static int initialize_combo(size_t index) {
-    const struct combo_cfg *new_combo = &combos[index];
+    const struct combo_cfg *new_combo = combo_at(index);
+
+    for (uint8_t layer = 0; layer < ZMK_KEYMAP_LAYERS_LEN; layer++) {
+        if (combo_active_on_layer(new_combo, layer)) {
+            sys_bitfield_set_bit((mem_addr_t)&layer_combos[layer], index);
+        }
+    }
+
+    if (new_combo->require_prior_idle_ms > 0) {
+        sys_bitfield_set_bit((mem_addr_t)&idle_combos, index);
+    }
 
-    for (size_t kp = 0; kp < new_combo->key_position_len; kp++) {
-        sys_bitfield_set_bit((mem_addr_t)&combo_lookup[new_combo->key_positions[kp]], index);
+    // Insertion sort, keeping combos with equal timeouts in index order.
+    size_t pos = index;
+    for (; pos > 0 && combo_at(combos_by_timeout[pos - 1])->timeout_ms > new_combo->timeout_ms;
+         pos--) {
+        combos_by_timeout[pos] = combos_by_timeout[pos - 1];
     }
+    combos_by_timeout[pos] = index;
 
     return 0;
 }
 
-static bool combo_active_on_layer(const struct combo_cfg *combo, uint8_t layer) {
-    if (!combo->layer_mask) {
-        return true;
+static inline int first_candidate(void) {
+    for (int i = 0; i < BYTES_FOR_COMBOS_MASK; i++) {
+        if (candidates[i]) {
+            return i * 32 + find_lsb_set(candidates[i]) - 1;
+        }
+    }
+
+    return -ENOENT;
+}
+
+static inline int count_candidates(void) {
+    int count = 0;
+    for (int i = 0; i < BYTES_FOR_COMBOS_MASK; i++) {
+        count += popcount(candidates[i]);
     }
 
-    return combo->layer_mask & BIT(layer);
+    return count;
 }
 
 static bool is_quick_tap(const struct combo_cfg *combo, int64_t timestamp) {
@@ -160,60 +285,65 @@ static bool is_quick_tap(const struct combo_cfg *combo, int64_t timestamp) {
 }
 
 static int setup_candidates_for_first_keypress(int32_t position, int64_t timestamp) {
-    int number_of_combo_candidates = 0;
     uint8_t highest_active_layer = zmk_keymap_highest_layer_active();
 
-    for (size_t i = 0; i < ARRAY_SIZE(combos); i++) {
-        if (sys_bitfield_test_bit((mem_addr_t)&combo_lookup[position], i)) {
-            const struct combo_cfg *combo = &combos[i];
-            if (combo_active_on_layer(combo, highest_active_layer) &&
-                !is_quick_tap(combo, timestamp)) {
-                sys_bitfield_set_bit((mem_addr_t)&candidates, i);
-                number_of_combo_candidates++;
-            }
-            // LOG_DBG("combo timeout %d %d %d", position, i, candidates[i].timeout_at);
+    if (highest_active_layer >= ZMK_KEYMAP_LAYERS_LEN) {
+        return 0;
+    }
+
+    memset(candidates, 0, BYTES_FOR_COMBOS_MASK * sizeof(uint32_t));
+
+    int number_of_combo_candidates = 0;
+    for (int i = position_combos_start[position]; i < position_combos_start[position + 1]; i++) {
+        uint16_t combo_idx = position_combos[i];
+        if (!sys_bitfield_test_bit((mem_addr_t)&layer_combos[highest_active_layer], combo_idx)) {
+            continue;
+        }
+
+        if (sys_bitfield_test_bit((mem_addr_t)&idle_combos, combo_idx) &&
+            is_quick_tap(combo_at(combo_idx), timestamp)) {
+            continue;
         }
+
+        sys_bitfield_set_bit((mem_addr_t)&candidates, combo_idx);
+        number_of_combo_candidates++;
     }
 
+    timeout_cursor = 0;
+
     return number_of_combo_candidates;
 }
 
-static inline uint8_t zero_one_or_more_bits(uint32_t field) {
-    if (field == 0) {
-        return 0;
-    }
-    if ((field & (field - 1)) == 0) {
-        return 1;
+static int filter_candidates(int32_t position) {
+    uint32_t position_mask[BYTES_FOR_COMBOS_MASK] = {0};
+    for (int i = position_combos_start[position]; i < position_combos_start[position + 1]; i++) {
+        sys_bitfield_set_bit((mem_addr_t)&position_mask, position_combos[i]);
     }
-    return 2;
-}
 
-static int filter_candidates(int32_t position) {
-    int matches = 0;
     for (int i = 0; i < BYTES_FOR_COMBOS_MASK; i++) {
-        candidates[i] &= combo_lookup[position][i];
-        if (matches < 2) {
-            matches += zero_one_or_more_bits(candidates[i]);
-        }
+        candidates[i] &= position_mask[i];
     }
 
+    int matches = count_candidates();
+
     LOG_DBG("combo matches after filter %d", matches);
     return matches;
 }
 
 static int64_t first_candidate_timeout() {
     if (pressed_keys_count == 0) {
-        return LONG_MAX;
+        return LLONG_MAX;
     }
 
-    int64_t first_timeout = LONG_MAX;
-    for (int i = 0; i < ARRAY_SIZE(combos); i++) {
-        if (sys_bitfield_test_bit((mem_addr_t)&candidates, i)) {
-            first_timeout = MIN(first_timeout, combos[i].timeout_ms);
+    int64_t first_pressed_at = pressed_key_event(&pressed_keys[0])->data.timestamp;
+    for (; timeout_cursor < ARRAY_SIZE(combos); timeout_cursor++) {
+        uint16_t combo_idx = combos_by_timeout[timeout_cursor];
+        if (sys_bitfield_test_bit((mem_addr_t)&candidates, combo_idx)) {
+            return first_pressed_at + combo_at(combo_idx)->timeout_ms;
         }
     }
 
-    return pressed_keys[0].data.timestamp + first_timeout;
+    return LLONG_MAX;
 }
 
 static inline bool candidate_is_completely_pressed(const struct combo_cfg *candidate) {
@@ -230,18 +360,22 @@ static int cleanup();
 static int filter_timed_out_candidates(int64_t timestamp) {
     __ASSERT(pressed_keys_count > 0, "Searching for a candidate timeout with no keys pressed");
 
-    int remaining_candidates = 0;
-    for (int i = 0; i < ARRAY_SIZE(combos); i++) {
-        if (sys_bitfield_test_bit((mem_addr_t)&candidates, i)) {
+    int64_t first_pressed_at = pressed_key_event(&pressed_keys[0])->data.timestamp;
+    for (; timeout_cursor < ARRAY_SIZE(combos); timeout_cursor++) {
+        uint16_t combo_idx = combos_by_timeout[timeout_cursor];
+        if (!sys_bitfield_test_bit((mem_addr_t)&candidates, combo_idx)) {
+            continue;
+        }
 
-            if (pressed_keys[0].data.timestamp + combos[i].timeout_ms > timestamp) {
-                remaining_candidates++;
-            } else {
-                sys_bitfield_clear_bit((mem_addr_t)&candidates, i);
-            }
+        if (first_pressed_at + combo_at(combo_idx)->timeout_ms > timestamp) {
+            break;
         }
+
+        sys_bitfield_clear_bit((mem_addr_t)&candidates, combo_idx);
     }
 
+    int remaining_candidates = count_candidates();
+
     LOG_DBG(
         "after filtering out timed out combo candidates: remaining_candidates=%d timestamp=%lld",
         remaining_candidates, timestamp);
@@ -249,12 +383,16 @@ static int filter_timed_out_candidates(int64_t timestamp) {
     return remaining_candidates;
 }
 
-static int capture_pressed_key(const struct zmk_position_state_changed *ev) {
+static int capture_pressed_key(const zmk_event_t *eh) {
     if (pressed_keys_count == MAX_COMBO_KEYS) {
         return ZMK_EV_EVENT_BUBBLE;
     }
 
-    pressed_keys[pressed_keys_count++] = copy_raised_zmk_position_state_changed(ev);
+    if (!store_pressed_key(&pressed_keys[pressed_keys_count], eh)) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    pressed_keys_count++;
     return ZMK_EV_EVENT_CAPTURED;
 }
 
@@ -264,7 +402,7 @@ static int release_pressed_keys() {
     uint8_t count = pressed_keys_count;
     pressed_keys_count = 0;
     for (int i = 0; i < count; i++) {
-        struct zmk_position_state_changed_event *ev = &pressed_keys[i];
+        struct zmk_position_state_changed_event *ev = pressed_key_event(&pressed_keys[i]);
         if (i == 0) {
             LOG_DBG("combo: releasing position event %d", ev->data.position);
             ZMK_EVENT_RELEASE(*ev);
@@ -273,6 +411,7 @@ static int release_pressed_keys() {
             LOG_DBG("combo: reraising position event %d", ev->data.position);
             ZMK_EVENT_RAISE(*ev);
         }
+        unref_pressed_key(ev);
     }
 
     return count;
@@ -308,7 +447,7 @@ static inline int release_combo_behavior(int combo_idx, const struct combo_cfg *
 
 static void move_pressed_keys_to_active_combo(struct active_combo *active_combo) {
 
-    int combo_length = MIN(pressed_keys_count, combos[active_combo->combo_idx].key_position_len);
+    int combo_length = MIN(pressed_keys_count, combo_at(active_combo->combo_idx)->key_position_len);
     for (int i = 0; i < combo_length; i++) {
         active_combo->key_positions_pressed[i] = pressed_keys[i];
     }
@@ -344,8 +483,9 @@ static void activate_combo(int combo_idx) {
         return;
     }
     move_pressed_keys_to_active_combo(active_combo);
-    press_combo_behavior(combo_idx, &combos[combo_idx],
-                         active_combo->key_positions_pressed[0].data.timestamp);
+    struct zmk_position_state_changed_event *first_key =
+        pressed_key_event(&active_combo->key_positions_pressed[0]);
+    press_combo_behavior(combo_idx, combo_at(combo_idx), first_key->data.timestamp);
 }
 
 static void deactivate_combo(int active_combo_index) {
@@ -365,22 +505,24 @@ static bool release_combo_key(int32_t position, int64_t timestamp) {
 
         bool key_released = false;
         bool all_keys_pressed = active_combo->key_positions_pressed_count ==
-                                combos[active_combo->combo_idx].key_position_len;
+                                combo_at(active_combo->combo_idx)->key_position_len;
         bool all_keys_released = true;
         for (int i = 0; i < active_combo->key_positions_pressed_count; i++) {
             if (key_released) {
                 active_combo->key_positions_pressed[i - 1] = active_combo->key_positions_pressed[i];
                 all_keys_released = false;
-            } else if (active_combo->key_positions_pressed[i].data.position != position) {
+            } else if (pressed_key_event(&active_combo->key_positions_pressed[i])->data.position !=
+                       position) {
                 all_keys_released = false;
             } else { // position matches
+                unref_pressed_key(pressed_key_event(&active_combo->key_positions_pressed[i]));
                 key_released = true;
             }
         }
 
         if (key_released) {
             active_combo->key_positions_pressed_count--;
-            const struct combo_cfg *c = &combos[active_combo->combo_idx];
+            const struct combo_cfg *c = combo_at(active_combo->combo_idx);
             if ((c->slow_release && all_keys_released) || (!c->slow_release && all_keys_pressed)) {
                 release_combo_behavior(active_combo->combo_idx, c, timestamp);
             }
@@ -431,29 +573,28 @@ static int position_state_down(const zmk_event_t *ev, struct zmk_position_state_
     }
 
     LOG_DBG("combo: capturing position event %d", data->position);
-    int ret = capture_pressed_key(data);
+    int ret = capture_pressed_key(ev);
     update_timeout_task();
 
     if (num_candidates) {
-        for (int i = 0; i < ARRAY_SIZE(combos); i++) {
-            if (sys_bitfield_test_bit((mem_addr_t)&candidates, i)) {
-                const struct combo_cfg *candidate_combo = &combos[i];
-                if (candidate_is_completely_pressed(candidate_combo)) {
-                    fully_pressed_combo = i;
-                    if (num_candidates == 1) {
-                        cleanup();
-                    }
-                }
-
-                return ret;
+        // Combos are sorted shortest first, so only the first candidate can be completely pressed.
+        int i = first_candidate();
+        if (i < 0) {
+            return -EINVAL;
+        }
+
+        if (candidate_is_completely_pressed(combo_at(i))) {
+            fully_pressed_combo = i;
+            if (num_candidates == 1) {
+                cleanup();
             }
         }
+
+        return ret;
     } else {
         cleanup();
         return ret;
     }
-
-    return -EINVAL;
 }
 
 static int position_state_up(const zmk_event_t *ev, struct zmk_position_state_changed *data) {
@@ -527,6 +668,8 @@ static int combo_init(void) {
 
     k_work_init_delayable(&timeout_task, combo_timeout_handler);
     LOG_WRN("Have %d combos!", ARRAY_SIZE(combos));
+    sort_combos();
+    build_position_combos();
     for (int i = 0; i < ARRAY_SIZE(combos); i++) {
         initialize_combo(i);
     }
@@ -12,6 +12,7 @@
 #include <zmk/ble.h>
 #include <zmk/endpoints.h>
 #include <zmk/hid.h>
+#include <zmk/latency_trace.h>
 #include <dt-bindings/zmk/hid_usage_pages.h>
 #include <zmk/usb_hid.h>
 #include <zmk/hog.h>
@@ -119,6 +120,8 @@ int zmk_endpoints_toggle_transport(void) {
 struct zmk_endpoint_instance zmk_endpoints_selected(void) { return current_instance; }
 
 static int send_keyboard_report(void) {
+    zmk_latency_trace_stamp(ZMK_LATENCY_TRACE_STAGE_TRANSPORT);
+
     switch (current_instance.transport) {
     case ZMK_TRANSPORT_USB: {
 #if IS_ENABLED(CONFIG_ZMK_USB)
@@ -153,6 +156,8 @@ static int send_keyboard_report(void) {
 }
 
 static int send_consumer_report(void) {
+    zmk_latency_trace_stamp(ZMK_LATENCY_TRACE_STAGE_TRANSPORT);
+
     switch (current_instance.transport) {
     case ZMK_TRANSPORT_USB: {
 #if IS_ENABLED(CONFIG_ZMK_USB)
@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <string.h>
+#include <zephyr/init.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
@@ -17,16 +19,24 @@ extern struct zmk_event_type *__event_type_end[];
 extern struct zmk_event_subscription __event_subscriptions_start[];
 extern struct zmk_event_subscription __event_subscriptions_end[];
 
+static inline struct zmk_event_dispatch_slot *dispatch_slot(uint8_t index) {
+    struct zmk_event_dispatch_slot *slot;
+    STRUCT_SECTION_GET(zmk_event_dispatch_slot, index, &slot);
+    return slot;
+}
+
 int zmk_event_manager_handle_from(zmk_event_t *event, uint8_t start_index) {
     int ret = 0;
-    uint8_t len = __event_subscriptions_end - __event_subscriptions_start;
-    for (int i = start_index; i < len; i++) {
-        struct zmk_event_subscription *ev_sub = __event_subscriptions_start + i;
-        if (ev_sub->event_type != event->event) {
-            continue;
-        }
+    const struct zmk_event_dispatch *dispatch = event->event->dispatch;
+    uint8_t end = dispatch->start + dispatch->len;
+
+    if (start_index < dispatch->start) {
+        start_index = dispatch->start;
+    }
+
+    for (int i = start_index; i < end; i++) {
         event->last_listener_index = i;
-        ret = ev_sub->listener->callback(event);
+        ret = dispatch_slot(i)->listener->callback(event);
         switch (ret) {
         case ZMK_EV_EVENT_BUBBLE:
             continue;
@@ -47,36 +57,188 @@ int zmk_event_manager_handle_from(zmk_event_t *event, uint8_t start_index) {
 
 int zmk_event_manager_raise(zmk_event_t *event) { return zmk_event_manager_handle_from(event, 0); }
 
-int zmk_event_manager_raise_after(zmk_event_t *event, const struct zmk_listener *listener) {
-    uint8_t len = __event_subscriptions_end - __event_subscriptions_start;
-    for (int i = 0; i < len; i++) {
-        struct zmk_event_subscription *ev_sub = __event_subscriptions_start + i;
+#define LOOKUP_EMPTY UINT8_MAX
 
-        if (ev_sub->event_type == event->event && ev_sub->listener == listener) {
-            return zmk_event_manager_handle_from(event, i + 1);
-        }
-    }
+// Two buckets per slot, so the table is never more than half full.
+static size_t lookup_len;
 
-    LOG_WRN("Unable to find where to raise this after event");
+static inline uint8_t *lookup_bucket(size_t bucket) {
+    return &dispatch_slot(bucket / 2)->lookup[bucket % 2];
+}
 
-    return -EINVAL;
+static size_t lookup_hash(const struct zmk_event_type *type, const struct zmk_listener *listener) {
+    uint32_t hash = (uint32_t)(uintptr_t)type * 2654435761U;
+    hash = (hash ^ (uint32_t)(uintptr_t)listener) * 2654435761U;
+
+    return (hash >> 16) % lookup_len;
 }
 
-int zmk_event_manager_raise_at(zmk_event_t *event, const struct zmk_listener *listener) {
-    uint8_t len = __event_subscriptions_end - __event_subscriptions_start;
-    for (int i = 0; i < len; i++) {
-        struct zmk_event_subscription *ev_sub = __event_subscriptions_start + i;
+static void lookup_insert(const struct zmk_event_type *type, uint8_t index) {
+    size_t bucket = lookup_hash(type, dispatch_slot(index)->listener);
 
-        if (ev_sub->event_type == event->event && ev_sub->listener == listener) {
-            return zmk_event_manager_handle_from(event, i);
-        }
+    while (*lookup_bucket(bucket) != LOOKUP_EMPTY) {
+        bucket = (bucket + 1) % lookup_len;
+    }
+
+    *lookup_bucket(bucket) = index;
+}
+
+static int find_listener_index(const zmk_event_t *event, const struct zmk_listener *listener) {
+    const struct zmk_event_dispatch *dispatch = event->event->dispatch;
+
+    if (lookup_len == 0) {
+        return -EINVAL;
     }
 
-    LOG_WRN("Unable to find where to raise this event");
+    // The table is never full, so the probe always ends at an empty bucket if nothing matches.
+    size_t bucket = lookup_hash(event->event, listener);
+    while (*lookup_bucket(bucket) != LOOKUP_EMPTY) {
+        uint8_t index = *lookup_bucket(bucket);
+
+        if (index >= dispatch->start && index < dispatch->start + dispatch->len &&
+            dispatch_slot(index)->listener == listener) {
+            return index;
+        }
+
+        bucket = (bucket + 1) % lookup_len;
+    }
 
     return -EINVAL;
 }
 
+int zmk_event_manager_raise_after(zmk_event_t *event, const struct zmk_listener *listener) {
+    int index = find_listener_index(event, listener);
+    if (index < 0) {
+        LOG_WRN("Unable to find where to raise this after event");
+        return index;
+    }
+
+    return zmk_event_manager_handle_from(event, index + 1);
+}
+
+int zmk_event_manager_raise_at(zmk_event_t *event, const struct zmk_listener *listener) {
+    int index = find_listener_index(event, listener);
+    if (index < 0) {
+        LOG_WRN("Unable to find where to raise this event");
+        return index;
+    }
+
+    return zmk_event_manager_handle_from(event, index);
+}
+
 int zmk_event_manager_release(zmk_event_t *event) {
     return zmk_event_manager_handle_from(event, event->last_listener_index + 1);
 }
+
+#if IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+
+zmk_event_t *zmk_event_arena_capture(const zmk_event_t *event) {
+    struct zmk_event_arena *arena = event->event->arena;
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    // Already in a block, so whoever re-raised it and this listener can share it.
+    if (event->arena_refs > 0) {
+        zmk_event_t *shared = (zmk_event_t *)event;
+        __ASSERT(shared->arena_refs < UINT8_MAX, "Too many references to a %s event",
+                 event->event->name);
+        shared->arena_refs++;
+        arena->copies_avoided++;
+        return shared;
+    }
+
+    void *block;
+    if (k_mem_slab_alloc(arena->slab, &block, K_NO_WAIT) != 0) {
+        LOG_ERR("No free %s arena blocks. Increase CONFIG_ZMK_EVENT_ARENA_BLOCKS",
+                event->event->name);
+        return NULL;
+    }
+
+    memcpy(block, event, arena->event_size);
+
+    zmk_event_t *captured = block;
+    captured->arena_refs = 1;
+    arena->copies++;
+    arena->max_used = MAX(arena->max_used, k_mem_slab_num_used_get(arena->slab));
+
+    return captured;
+}
+
+void zmk_event_arena_unref(zmk_event_t *event) {
+    const struct zmk_event_type *type = event->event;
+    struct zmk_event_arena *arena = type->arena;
+
+    __ASSERT(event->arena_refs > 0, "Releasing a %s event not owned by an arena", type->name);
+
+    if (--event->arena_refs > 0) {
+        return;
+    }
+
+    k_mem_slab_free(arena->slab, event);
+
+    if (k_mem_slab_num_used_get(arena->slab) == 0) {
+        LOG_DBG("%s arena drained: peak %u blocks (%zu bytes), %u copies, %u copies avoided",
+                type->name, arena->max_used, arena->max_used * arena->block_size,
+                arena->copies, arena->copies_avoided);
+    }
+}
+
+int zmk_event_arena_get_stats(const struct zmk_event_type *type,
+                              struct zmk_event_arena_stats *stats) {
+    const struct zmk_event_arena *arena = type->arena;
+    if (arena == NULL) {
+        return -ENOTSUP;
+    }
+
+    *stats = (struct zmk_event_arena_stats){
+        .blocks_used = k_mem_slab_num_used_get(arena->slab),
+        .blocks_max_used = arena->max_used,
+        .block_size = arena->block_size,
+        .copies = arena->copies,
+        .copies_avoided = arena->copies_avoided,
+    };
+
+    return 0;
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_EVENT_ARENA)
+
+static int zmk_event_manager_init(void) {
+    size_t subs_len = __event_subscriptions_end - __event_subscriptions_start;
+    uint8_t slot = 0;
+
+    __ASSERT(subs_len < LOOKUP_EMPTY, "Too many event subscriptions: %zu", subs_len);
+
+    // Group the listeners by event type, keeping the link order of the subscriptions for each
+    // type since that order determines which listener sees an event first.
+    for (struct zmk_event_type **type = __event_type_start; type < __event_type_end; type++) {
+        struct zmk_event_dispatch *dispatch = (*type)->dispatch;
+
+        dispatch->start = slot;
+        for (size_t i = 0; i < subs_len; i++) {
+            struct zmk_event_subscription *ev_sub = __event_subscriptions_start + i;
+            if (ev_sub->event_type == *type) {
+                dispatch_slot(slot++)->listener = ev_sub->listener;
+            }
+        }
+        dispatch->len = slot - dispatch->start;
+    }
+
+    lookup_len = subs_len * 2;
+    for (size_t i = 0; i < lookup_len; i++) {
+        *lookup_bucket(i) = LOOKUP_EMPTY;
+    }
+
+    for (struct zmk_event_type **type = __event_type_start; type < __event_type_end; type++) {
+        const struct zmk_event_dispatch *dispatch = (*type)->dispatch;
+
+        for (uint8_t i = dispatch->start; i < dispatch->start + dispatch->len; i++) {
+            lookup_insert(*type, i);
+        }
+    }
+
+    return 0;
+}
+
+SYS_INIT(zmk_event_manager_init, PRE_KERNEL_1, 0);
@@ -7,4 +7,11 @@
 #include <zephyr/kernel.h>
 #include <zmk/events/keycode_state_changed.h>
 
-ZMK_EVENT_IMPL(zmk_keycode_state_changed);
+// Only hold-taps capture keycode events.
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP)
+#define HOLD_TAP_MAX_CAPTURED CONFIG_ZMK_BEHAVIOR_HOLD_TAP_MAX_CAPTURED_EVENTS
+#else
+#define HOLD_TAP_MAX_CAPTURED 0
+#endif
+
+ZMK_EVENT_IMPL_WITH_ARENA(zmk_keycode_state_changed, HOLD_TAP_MAX_CAPTURED);
@@ -5,6 +5,27 @@
  */
 
 #include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
 #include <zmk/events/position_state_changed.h>
 
-ZMK_EVENT_IMPL(zmk_position_state_changed);
\ No newline at end of file
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_HOLD_TAP)
+#define HOLD_TAP_MAX_CAPTURED CONFIG_ZMK_BEHAVIOR_HOLD_TAP_MAX_CAPTURED_EVENTS
+#else
+#define HOLD_TAP_MAX_CAPTURED 0
+#endif
+
+#if DT_HAS_COMPAT_STATUS_OKAY(zmk_combos)
+
+#define COMBO_KEYS_BYTE_ARRAY(node_id)                                                             \
+    uint8_t _CONCAT(combo_prop_, node_id)[DT_PROP_LEN(node_id, key_positions)];
+
+// Combos hold the keys of the combo being pressed, and of each pressed combo.
+#define COMBO_MAX_CAPTURED                                                                         \
+    (sizeof(union {DT_FOREACH_CHILD(DT_INST(0, zmk_combos), COMBO_KEYS_BYTE_ARRAY)}) *             \
+     (CONFIG_ZMK_COMBO_MAX_PRESSED_COMBOS + 1))
+
+#else
+#define COMBO_MAX_CAPTURED 0
+#endif
+
+ZMK_EVENT_IMPL_WITH_ARENA(zmk_position_state_changed, HOLD_TAP_MAX_CAPTURED + COMBO_MAX_CAPTURED);
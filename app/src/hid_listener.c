@@ -15,10 +15,13 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <zmk/hid.h>
 #include <dt-bindings/zmk/hid_usage_pages.h>
 #include <zmk/endpoints.h>
+#include <zmk/latency_trace.h>
 
 static int hid_listener_keycode_pressed(const struct zmk_keycode_state_changed *ev) {
     int err, explicit_mods_changed, implicit_mods_changed;
 
+    zmk_latency_trace_stamp(ZMK_LATENCY_TRACE_STAGE_HID);
+
     if (!is_mod(ev->usage_page, ev->keycode) &&
         zmk_hid_is_pressed(ZMK_HID_USAGE(ev->usage_page, ev->keycode))) {
         LOG_DBG("unregistering usage_page 0x%02X keycode 0x%02X since it was already pressed",
@@ -58,6 +61,8 @@ static int hid_listener_keycode_pressed(const struct zmk_keycode_state_changed *
 static int hid_listener_keycode_released(const struct zmk_keycode_state_changed *ev) {
     int err, explicit_mods_changed, implicit_mods_changed;
 
+    zmk_latency_trace_stamp(ZMK_LATENCY_TRACE_STAGE_HID);
+
     LOG_DBG("usage_page 0x%02X keycode 0x%02X implicit_mods 0x%02X explicit_mods 0x%02X",
             ev->usage_page, ev->keycode, ev->implicit_modifiers, ev->explicit_modifiers);
     err = zmk_hid_release(ZMK_HID_USAGE(ev->usage_page, ev->keycode));
@@ -6,6 +6,7 @@
 
 #include <zephyr/settings/settings.h>
 #include <zephyr/init.h>
+#include <string.h>
 
 #include <zephyr/logging/log.h>
 
@@ -285,22 +286,72 @@ K_THREAD_STACK_DEFINE(hog_q_stack, CONFIG_ZMK_BLE_THREAD_STACK_SIZE);
 
 struct k_work_q hog_work_q;
 
-K_MSGQ_DEFINE(zmk_hog_keyboard_msgq, sizeof(struct zmk_hid_keyboard_report_body),
-              CONFIG_ZMK_BLE_KEYBOARD_REPORT_QUEUE_SIZE, 4);
+#define KEYBOARD_QUEUE_SIZE CONFIG_ZMK_BLE_KEYBOARD_REPORT_QUEUE_SIZE
+
+// Keyboard reports waiting to be notified, oldest first. The input path only ever appends to or
+// rewrites the newest report under the lock, so it never waits on the BLE stack. The notify work
+// hands reports to the stack straight from this queue.
+static struct k_spinlock keyboard_queue_lock;
+static struct zmk_hid_keyboard_report_body keyboard_queue[KEYBOARD_QUEUE_SIZE];
+static size_t keyboard_queue_head;
+static size_t keyboard_queue_len;
+// Set while the oldest report is being notified, so it is neither rewritten nor dropped.
+static bool keyboard_queue_head_busy;
+// The last report handed to the BLE stack.
+static struct zmk_hid_keyboard_report_body keyboard_last_sent;
+static struct zmk_hog_report_stats keyboard_stats;
+
+static inline struct zmk_hid_keyboard_report_body *keyboard_queue_at(size_t idx) {
+    return &keyboard_queue[(keyboard_queue_head + idx) % KEYBOARD_QUEUE_SIZE];
+}
+
+static inline void keyboard_queue_pop(void) {
+    keyboard_queue_head = (keyboard_queue_head + 1) % KEYBOARD_QUEUE_SIZE;
+    keyboard_queue_len--;
+}
+
+// A pending report can be replaced by the next one if that loses no key or modifier edge: the keys
+// stay the same across all three reports, and no modifier changes from prev to pending and then
+// changes again from pending to next. Modifier changes only become simultaneous.
+static bool keyboard_report_supersedes(const struct zmk_hid_keyboard_report_body *prev,
+                                       const struct zmk_hid_keyboard_report_body *pending,
+                                       const struct zmk_hid_keyboard_report_body *next) {
+    if (memcmp(pending->keys, next->keys, sizeof(next->keys)) != 0 ||
+        memcmp(prev->keys, pending->keys, sizeof(pending->keys)) != 0) {
+        return false;
+    }
+
+    return ((prev->modifiers ^ pending->modifiers) & (pending->modifiers ^ next->modifiers)) == 0;
+}
 
 void send_keyboard_report_callback(struct k_work *work) {
-    struct zmk_hid_keyboard_report_body report;
+    struct bt_conn *conn = NULL;
 
-    while (k_msgq_get(&zmk_hog_keyboard_msgq, &report, K_NO_WAIT) == 0) {
-        struct bt_conn *conn = zmk_ble_active_profile_conn();
+    while (true) {
+        k_spinlock_key_t key = k_spin_lock(&keyboard_queue_lock);
+        if (keyboard_queue_len == 0) {
+            k_spin_unlock(&keyboard_queue_lock, key);
+            break;
+        }
+        struct zmk_hid_keyboard_report_body *report = keyboard_queue_at(0);
+        keyboard_queue_head_busy = true;
+        k_spin_unlock(&keyboard_queue_lock, key);
+
+        // Look the connection up once for the whole batch, so the reports go out back to back.
         if (conn == NULL) {
-            return;
+            conn = zmk_ble_active_profile_conn();
+            if (conn == NULL) {
+                key = k_spin_lock(&keyboard_queue_lock);
+                keyboard_queue_head_busy = false;
+                k_spin_unlock(&keyboard_queue_lock, key);
+                return;
+            }
         }
 
         struct bt_gatt_notify_params notify_params = {
             .attr = &hog_svc.attrs[5],
-            .data = &report,
-            .len = sizeof(report),
+            .data = report,
+            .len = sizeof(*report),
         };
 
         int err = bt_gatt_notify_cb(conn, &notify_params);
@@ -310,6 +361,17 @@ void send_keyboard_report_callback(struct k_work *work) {
             LOG_DBG("Error notifying %d", err);
         }
 
+        key = k_spin_lock(&keyboard_queue_lock);
+        if (!err) {
+            keyboard_stats.sent++;
+        }
+        keyboard_last_sent = *report;
+        keyboard_queue_head_busy = false;
+        keyboard_queue_pop();
+        k_spin_unlock(&keyboard_queue_lock, key);
+    }
+
+    if (conn != NULL) {
         bt_conn_unref(conn);
     }
 }
@@ -317,26 +379,57 @@ void send_keyboard_report_callback(struct k_work *work) {
 K_WORK_DEFINE(hog_keyboard_work, send_keyboard_report_callback);
 
 int zmk_hog_send_keyboard_report(struct zmk_hid_keyboard_report_body *report) {
-    int err = k_msgq_put(&zmk_hog_keyboard_msgq, report, K_MSEC(100));
-    if (err) {
-        switch (err) {
-        case -EAGAIN: {
-            LOG_WRN("Keyboard message queue full, popping first message and queueing again");
-            struct zmk_hid_keyboard_report_body discarded_report;
-            k_msgq_get(&zmk_hog_keyboard_msgq, &discarded_report, K_NO_WAIT);
-            return zmk_hog_send_keyboard_report(report);
+    k_spinlock_key_t key = k_spin_lock(&keyboard_queue_lock);
+
+    // The newest queued report may only be rewritten if it isn't already being notified.
+    size_t first_mutable = keyboard_queue_head_busy ? 1 : 0;
+
+    if (keyboard_queue_len > first_mutable) {
+        struct zmk_hid_keyboard_report_body *pending = keyboard_queue_at(keyboard_queue_len - 1);
+        const struct zmk_hid_keyboard_report_body *prev =
+            keyboard_queue_len > 1 ? keyboard_queue_at(keyboard_queue_len - 2)
+                                   : &keyboard_last_sent;
+
+        if (memcmp(pending, report, sizeof(*report)) == 0) {
+            keyboard_stats.coalesced++;
+            k_spin_unlock(&keyboard_queue_lock, key);
+            return 0;
         }
-        default:
-            LOG_WRN("Failed to queue keyboard report to send (%d)", err);
-            return err;
+
+        if (keyboard_report_supersedes(prev, pending, report)) {
+            *pending = *report;
+            keyboard_stats.coalesced++;
+            k_spin_unlock(&keyboard_queue_lock, key);
+            return 0;
+        }
+    }
+
+    if (keyboard_queue_len == KEYBOARD_QUEUE_SIZE) {
+        // Drop the oldest report that isn't being notified.
+        LOG_WRN("Keyboard report queue full, dropping oldest report");
+        keyboard_stats.dropped++;
+        for (size_t i = first_mutable; i < keyboard_queue_len - 1; i++) {
+            *keyboard_queue_at(i) = *keyboard_queue_at(i + 1);
         }
+        keyboard_queue_len--;
     }
 
+    *keyboard_queue_at(keyboard_queue_len) = *report;
+    keyboard_queue_len++;
+
+    k_spin_unlock(&keyboard_queue_lock, key);
+
     k_work_submit_to_queue(&hog_work_q, &hog_keyboard_work);
 
     return 0;
 };
 
+void zmk_hog_get_keyboard_report_stats(struct zmk_hog_report_stats *stats) {
+    k_spinlock_key_t key = k_spin_lock(&keyboard_queue_lock);
+    *stats = keyboard_stats;
+    k_spin_unlock(&keyboard_queue_lock, key);
+}
+
 K_MSGQ_DEFINE(zmk_hog_consumer_msgq, sizeof(struct zmk_hid_consumer_report_body),
               CONFIG_ZMK_BLE_CONSUMER_REPORT_QUEUE_SIZE, 4);
 
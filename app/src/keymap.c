@@ -5,7 +5,10 @@
  */
 
 #include <drivers/behavior.h>
+#include <zephyr/kernel.h>
 #include <zephyr/sys/util.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
 #include <zephyr/settings/settings.h>
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
@@ -13,6 +16,7 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <zmk/stdlib.h>
 #include <zmk/behavior.h>
 #include <zmk/keymap.h>
+#include <zmk/latency_trace.h>
 #include <zmk/physical_layouts.h>
 #include <zmk/matrix.h>
 #include <zmk/sensors.h>
@@ -34,6 +38,10 @@ static zmk_keymap_layer_id_t _zmk_keymap_layer_default = 0;
 
 #endif
 
+BUILD_ASSERT(ZMK_KEYMAP_LAYERS_LEN <= ZMK_KEYMAP_LAYERS_STATE_MAX_LEN,
+             "Too many keymap layers for the layer state, enable "
+             "CONFIG_ZMK_KEYMAP_LAYER_STATE_64_BIT for up to 64 layers");
+
 #define TRANSFORMED_LAYER(node)                                                                    \
     {COND_CODE_1(DT_NODE_HAS_PROP(node, bindings),                                                 \
                  (LISTIFY(DT_PROP_LEN(node, bindings), ZMK_KEYMAP_EXTRACT_BINDING, (, ), node)),   \
@@ -64,7 +72,7 @@ static zmk_keymap_layer_id_t _zmk_keymap_layer_default = 0;
 // When a behavior handles a key position "down" event, we record the layer state
 // here so that even if that layer is deactivated before the "up", event, we
 // still send the release event to the behavior in that layer also.
-static uint32_t zmk_keymap_active_behavior_layer[ZMK_KEYMAP_LEN];
+static zmk_keymap_layers_state_t zmk_keymap_active_behavior_layer[ZMK_KEYMAP_LEN];
 
 #if IS_ENABLED(CONFIG_ZMK_KEYMAP_LAYER_REORDERING)
 
@@ -84,6 +92,26 @@ static uint8_t keymap_layer_orders[ZMK_KEYMAP_LAYERS_LEN];
 KEYMAP_VAR(zmk_keymap, COND_CODE_1(IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE), (), (const)),
            IS_ENABLED(CONFIG_ZMK_STUDIO))
 
+// The behavior device and locality for each binding in zmk_keymap, so key presses don't have to
+// look up behaviors by name. Must be updated whenever zmk_keymap changes.
+static struct zmk_behavior_resolved_binding resolved_keymap[ZMK_KEYMAP_LAYERS_LEN][ZMK_KEYMAP_LEN];
+
+static void resolve_binding(zmk_keymap_layer_id_t layer_id, uint32_t key_position) {
+    int ret = zmk_behavior_resolve_binding(&zmk_keymap[layer_id][key_position],
+                                           &resolved_keymap[layer_id][key_position]);
+    if (ret < 0 && ret != -ENODEV) {
+        LOG_WRN("Failed to resolve binding on layer %d at %d (%d)", layer_id, key_position, ret);
+    }
+}
+
+static void resolve_keymap(void) {
+    for (int l = 0; l < ZMK_KEYMAP_LAYERS_LEN; l++) {
+        for (int k = 0; k < ZMK_KEYMAP_LEN; k++) {
+            resolve_binding(l, k);
+        }
+    }
+}
+
 #if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE)
 
 KEYMAP_VAR(zmk_stock_keymap, const, 0)
@@ -91,7 +119,7 @@ KEYMAP_VAR(zmk_stock_keymap, const, 0)
 static char zmk_keymap_layer_names[ZMK_KEYMAP_LAYERS_LEN][CONFIG_ZMK_KEYMAP_LAYER_NAME_MAX_LEN] = {
     DT_INST_FOREACH_CHILD_SEP(0, LAYER_NAME, (, ))};
 
-static uint32_t changed_layer_names = 0;
+static zmk_keymap_layers_state_t changed_layer_names = 0;
 
 #else
 
@@ -147,7 +175,7 @@ static inline int set_layer_state(zmk_keymap_layer_id_t layer_id, bool state) {
     }
 
     zmk_keymap_layers_state_t old_state = _zmk_keymap_layer_state;
-    WRITE_BIT(_zmk_keymap_layer_state, layer_id, state);
+    zmk_keymap_layers_state_write(&_zmk_keymap_layer_state, layer_id, state);
     // Don't send state changes unless there was an actual change
     if (old_state != _zmk_keymap_layer_state) {
         LOG_DBG("layer_changed: layer %d state %d", layer_id, state);
@@ -174,7 +202,7 @@ bool zmk_keymap_layer_active_with_state(zmk_keymap_layer_id_t layer,
                                         zmk_keymap_layers_state_t state_to_test) {
     // The default layer is assumed to be ALWAYS ACTIVE so we include an || here to ensure nobody
     // breaks up that assumption by accident
-    return (state_to_test & (BIT(layer))) == (BIT(layer)) || layer == _zmk_keymap_layer_default;
+    return zmk_keymap_layers_state_test(state_to_test, layer) || layer == _zmk_keymap_layer_default;
 };
 
 bool zmk_keymap_layer_active(zmk_keymap_layer_id_t layer) {
@@ -257,6 +285,250 @@ zmk_keymap_get_layer_binding_at_idx(zmk_keymap_layer_id_t layer_id, uint8_t bind
     return &zmk_keymap[layer_id][mapped_idx];
 }
 
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_EFFECTIVE_BINDING_CACHE)
+
+#define EFFECTIVE_LAYER_NONE UINT8_MAX
+
+// For one layer state, the index of the highest active layer whose binding at each stock key
+// position isn't &trans, so position events can skip the transparent bindings above it.
+struct effective_keymap {
+    zmk_keymap_layers_state_t state;
+    uint32_t last_used;
+    bool valid;
+    uint8_t layer_idx[ZMK_KEYMAP_LEN];
+};
+
+// Releases are dispatched with the layer state from when the key was pressed, so a few recently
+// used layer states are kept instead of only the current one.
+static struct effective_keymap effective_keymaps[CONFIG_ZMK_KEYMAP_EFFECTIVE_BINDING_CACHE_SIZE];
+static uint32_t effective_keymap_clock;
+
+static bool is_transparent_binding(zmk_keymap_layer_id_t layer_id, uint32_t key_position) {
+#if DT_HAS_COMPAT_STATUS_OKAY(zmk_behavior_transparent)
+    return resolved_keymap[layer_id][key_position].behavior ==
+           DEVICE_DT_GET(DT_INST(0, zmk_behavior_transparent));
+#else
+    return false;
+#endif
+}
+
+static uint8_t find_effective_layer_idx(zmk_keymap_layers_state_t state, int from_idx,
+                                        uint32_t key_position) {
+    int default_idx = LAYER_ID_TO_INDEX(_zmk_keymap_layer_default);
+
+    for (int layer_idx = from_idx; layer_idx >= default_idx; layer_idx--) {
+        zmk_keymap_layer_id_t layer_id = LAYER_INDEX_TO_ID(layer_idx);
+
+        if (layer_id == ZMK_KEYMAP_LAYER_ID_INVAL) {
+            continue;
+        }
+        if (zmk_keymap_layer_active_with_state(layer_id, state) &&
+            !is_transparent_binding(layer_id, key_position)) {
+            return layer_idx;
+        }
+    }
+
+    return EFFECTIVE_LAYER_NONE;
+}
+
+static void build_effective_keymap(struct effective_keymap *keymap) {
+    for (int k = 0; k < ZMK_KEYMAP_LEN; k++) {
+        keymap->layer_idx[k] =
+            find_effective_layer_idx(keymap->state, ZMK_KEYMAP_LAYERS_LEN - 1, k);
+    }
+}
+
+// Derives keymap from base, whose layer state differs only in whether layer_id is active.
+static void derive_effective_keymap(struct effective_keymap *keymap,
+                                    const struct effective_keymap *base,
+                                    zmk_keymap_layer_id_t layer_id) {
+    uint8_t changed_idx = LAYER_ID_TO_INDEX(layer_id);
+    bool activated = zmk_keymap_layers_state_test(keymap->state, layer_id);
+
+    // The default layer is always active, and layers not in the order are never looked at.
+    if (layer_id == _zmk_keymap_layer_default || changed_idx == ZMK_KEYMAP_LAYER_ID_INVAL) {
+        if (keymap != base) {
+            memcpy(keymap->layer_idx, base->layer_idx, sizeof(keymap->layer_idx));
+        }
+        return;
+    }
+
+    for (int k = 0; k < ZMK_KEYMAP_LEN; k++) {
+        uint8_t base_idx = base->layer_idx[k];
+
+        if (activated) {
+            bool above = base_idx == EFFECTIVE_LAYER_NONE || base_idx < changed_idx;
+            if (above && !is_transparent_binding(layer_id, k)) {
+                base_idx = changed_idx;
+            }
+        } else if (base_idx == changed_idx) {
+            base_idx = find_effective_layer_idx(keymap->state, changed_idx - 1, k);
+        }
+
+        keymap->layer_idx[k] = base_idx;
+    }
+}
+
+static const struct effective_keymap *get_effective_keymap(zmk_keymap_layers_state_t state) {
+    struct effective_keymap *victim = &effective_keymaps[0];
+    const struct effective_keymap *base = NULL;
+
+    for (int i = 0; i < ARRAY_SIZE(effective_keymaps); i++) {
+        struct effective_keymap *keymap = &effective_keymaps[i];
+
+        if (!keymap->valid) {
+            victim = keymap;
+            continue;
+        }
+
+        if (keymap->state == state) {
+            LOG_DBG("Hit for layer state 0x%llx", (unsigned long long)state);
+            keymap->last_used = ++effective_keymap_clock;
+            return keymap;
+        }
+
+        zmk_keymap_layers_state_t diff = keymap->state ^ state;
+        if ((diff & (diff - 1)) == 0 && (!base || keymap->last_used > base->last_used)) {
+            base = keymap;
+        }
+
+        if (victim->valid && keymap->last_used < victim->last_used) {
+            victim = keymap;
+        }
+    }
+
+    // Deriving may read from the entry being replaced, which is safe since each position only
+    // depends on its own previous value.
+    zmk_keymap_layer_id_t changed_layer = ZMK_KEYMAP_LAYER_ID_INVAL;
+    if (base) {
+        for (int l = 0; l < ZMK_KEYMAP_LAYERS_LEN; l++) {
+            if ((base->state ^ state) == ZMK_KEYMAP_LAYERS_STATE_BIT(l)) {
+                changed_layer = l;
+                break;
+            }
+        }
+    }
+
+    victim->state = state;
+    victim->valid = true;
+    victim->last_used = ++effective_keymap_clock;
+
+    if (changed_layer != ZMK_KEYMAP_LAYER_ID_INVAL) {
+        LOG_DBG("Derived layer state 0x%llx by toggling layer %d", (unsigned long long)state,
+                changed_layer);
+        derive_effective_keymap(victim, base, changed_layer);
+    } else {
+        LOG_DBG("Built layer state 0x%llx", (unsigned long long)state);
+        build_effective_keymap(victim);
+    }
+
+    return victim;
+}
+
+static void invalidate_effective_keymaps(void) {
+    LOG_DBG("Dropped all cached layer states");
+
+    for (int i = 0; i < ARRAY_SIZE(effective_keymaps); i++) {
+        effective_keymaps[i].valid = false;
+    }
+}
+
+static void refresh_effective_keymaps_at(uint32_t key_position) {
+    LOG_DBG("Refreshed position %d in cached layer states", key_position);
+
+    for (int i = 0; i < ARRAY_SIZE(effective_keymaps); i++) {
+        struct effective_keymap *keymap = &effective_keymaps[i];
+
+        if (keymap->valid) {
+            keymap->layer_idx[key_position] =
+                find_effective_layer_idx(keymap->state, ZMK_KEYMAP_LAYERS_LEN - 1, key_position);
+        }
+    }
+}
+
+// Returns the layer index to start looking for a binding at, or a negative value if every
+// active layer is transparent at the position.
+static int effective_layer_start_idx(uint32_t position, zmk_keymap_layers_state_t state) {
+    const uint32_t *pos_map;
+    int ret = zmk_physical_layouts_get_selected_to_stock_position_map(&pos_map);
+
+    if (ret < 0 || position >= ret || pos_map[position] >= ZMK_KEYMAP_LEN) {
+        return ZMK_KEYMAP_LAYERS_LEN - 1;
+    }
+
+    uint8_t layer_idx = get_effective_keymap(state)->layer_idx[pos_map[position]];
+
+    return layer_idx == EFFECTIVE_LAYER_NONE ? -1 : layer_idx;
+}
+
+#else
+
+static inline void invalidate_effective_keymaps(void) {}
+
+static inline void refresh_effective_keymaps_at(uint32_t key_position) {}
+
+static inline int effective_layer_start_idx(uint32_t position, zmk_keymap_layers_state_t state) {
+    return ZMK_KEYMAP_LAYERS_LEN - 1;
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_EFFECTIVE_BINDING_CACHE)
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL)
+
+// The journal holds the changes for revisions (change_journal_start, keymap_revision], with the
+// change for a revision stored at the revision modulo the journal size.
+static struct zmk_keymap_change change_journal[CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL_SIZE];
+static uint32_t change_journal_start;
+static uint32_t keymap_revision;
+
+// Inline like the stubs below, since which callers exist depends on the keymap options.
+static inline void record_change(enum zmk_keymap_change_type type, zmk_keymap_layer_id_t layer_id,
+                                 uint32_t key_position) {
+    keymap_revision++;
+    change_journal[keymap_revision % CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL_SIZE] =
+        (struct zmk_keymap_change){
+            .type = type,
+            .layer_id = layer_id,
+            .key_position = key_position,
+        };
+
+    if (keymap_revision - change_journal_start > CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL_SIZE) {
+        change_journal_start = keymap_revision - CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL_SIZE;
+    }
+}
+
+// Used when the whole keymap is reloaded, so earlier revisions can only be synced in full.
+static inline void record_reload(void) {
+    keymap_revision++;
+    change_journal_start = keymap_revision;
+}
+
+uint32_t zmk_keymap_get_revision(void) { return keymap_revision; }
+
+int zmk_keymap_foreach_change_since(uint32_t revision, zmk_keymap_change_cb cb, void *user_data) {
+    if (revision < change_journal_start || revision > keymap_revision) {
+        return -ENOENT;
+    }
+
+    for (uint32_t r = revision + 1; r <= keymap_revision; r++) {
+        int ret = cb(&change_journal[r % CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL_SIZE], user_data);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+#else
+
+static inline void record_change(enum zmk_keymap_change_type type,
+                                 zmk_keymap_layer_id_t layer_id, uint32_t key_position) {}
+
+static inline void record_reload(void) {}
+
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL)
+
 #if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE)
 
 #define PENDING_ARRAY_SIZE DIV_ROUND_UP(ZMK_KEYMAP_LEN, 8)
@@ -302,6 +574,9 @@ int zmk_keymap_set_layer_binding_at_idx(zmk_keymap_layer_id_t layer_id, uint8_t
 
     // TODO: Need a mutex to protect access to the keymap data?
     memcpy(&zmk_keymap[layer_id][storage_binding_idx], &binding, sizeof(binding));
+    resolve_binding(layer_id, storage_binding_idx);
+    refresh_effective_keymaps_at(storage_binding_idx);
+    record_change(ZMK_KEYMAP_CHANGE_BINDING, layer_id, storage_binding_idx);
 
     return 0;
 }
@@ -346,24 +621,29 @@ int zmk_keymap_move_layer(zmk_keymap_layer_index_t start_idx, zmk_keymap_layer_i
         keymap_layer_orders[dest_idx] = val;
     }
 
+    invalidate_effective_keymaps();
+    record_change(ZMK_KEYMAP_CHANGE_LAYER_ORDER, keymap_layer_orders[dest_idx], 0);
+
     return 0;
 }
 
 int zmk_keymap_add_layer(void) {
-    uint32_t seen_layer_ids = 0;
+    zmk_keymap_layers_state_t seen_layer_ids = 0;
     LOG_HEXDUMP_DBG(keymap_layer_orders, ZMK_KEYMAP_LAYERS_LEN, "Order");
 
     for (int index = 0; index < ZMK_KEYMAP_LAYERS_LEN; index++) {
         zmk_keymap_layer_id_t id = LAYER_INDEX_TO_ID(index);
 
         if (id != ZMK_KEYMAP_LAYER_ID_INVAL) {
-            WRITE_BIT(seen_layer_ids, id, 1);
+            zmk_keymap_layers_state_write(&seen_layer_ids, id, true);
             continue;
         }
 
         for (int candidate_id = 0; candidate_id < ZMK_KEYMAP_LAYERS_LEN; candidate_id++) {
-            if (!(seen_layer_ids & BIT(candidate_id))) {
+            if (!zmk_keymap_layers_state_test(seen_layer_ids, candidate_id)) {
                 keymap_layer_orders[index] = candidate_id;
+                invalidate_effective_keymaps();
+                record_change(ZMK_KEYMAP_CHANGE_LAYER_ORDER, candidate_id, 0);
                 return index;
             }
         }
@@ -379,7 +659,9 @@ int zmk_keymap_remove_layer(zmk_keymap_layer_index_t index) {
         return -EINVAL;
     }
 
-    LOG_DBG("Removing layer index %d which is ID %d", index, keymap_layer_orders[index]);
+    zmk_keymap_layer_id_t removed_id = keymap_layer_orders[index];
+
+    LOG_DBG("Removing layer index %d which is ID %d", index, removed_id);
     LOG_HEXDUMP_DBG(keymap_layer_orders, ZMK_KEYMAP_LAYERS_LEN, "Order");
 
     while (index < ZMK_KEYMAP_LAYERS_LEN - 1) {
@@ -391,6 +673,9 @@ int zmk_keymap_remove_layer(zmk_keymap_layer_index_t index) {
 
     LOG_HEXDUMP_DBG(keymap_layer_orders, ZMK_KEYMAP_LAYERS_LEN, "Order");
 
+    invalidate_effective_keymaps();
+    record_change(ZMK_KEYMAP_CHANGE_LAYER_ORDER, removed_id, 0);
+
     return 0;
 }
 
@@ -404,6 +689,9 @@ int zmk_keymap_restore_layer(zmk_keymap_layer_id_t id, zmk_keymap_layer_index_t
 
     keymap_layer_orders[at_index] = id;
 
+    invalidate_effective_keymaps();
+    record_change(ZMK_KEYMAP_CHANGE_LAYER_ORDER, id, 0);
+
     return 0;
 }
 
@@ -421,7 +709,8 @@ int zmk_keymap_set_layer_name(zmk_keymap_layer_id_t id, const char *name, size_t
         zmk_keymap_layer_names[id][size] = 0;
     }
 
-    WRITE_BIT(changed_layer_names, id, 1);
+    zmk_keymap_layers_state_write(&changed_layer_names, id, true);
+    record_change(ZMK_KEYMAP_CHANGE_LAYER_NAME, id, 0);
 
     return 0;
 }
@@ -481,6 +770,275 @@ int zmk_keymap_check_unsaved_changes(void) {
 #define LAYER_NAME_SETTINGS_KEY "keymap/l_n/%d"
 #define LAYER_BINDING_SETTINGS_KEY "keymap/l/%d/%d"
 
+static void set_binding_from_setting(zmk_keymap_layer_id_t layer_id, uint32_t key_position,
+                                     const struct zmk_behavior_binding_setting *setting) {
+    const char *name = zmk_behavior_find_behavior_name_from_local_id(setting->behavior_local_id);
+
+    if (!name) {
+        LOG_WRN("Loaded device %d from settings but no device found by that local ID",
+                setting->behavior_local_id);
+    }
+
+    zmk_keymap[layer_id][key_position] = (struct zmk_behavior_binding){
+#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_LOCAL_IDS_IN_BINDINGS)
+        .local_id = setting->behavior_local_id,
+#endif
+        .behavior_dev = name,
+        .param1 = setting->param1,
+        .param2 = setting->param2,
+    };
+}
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+
+#define LAYER_BLOB_SETTINGS_KEY "keymap/lb/%d"
+#define LAYER_BLOB_VERSION 1
+
+struct layer_blob_header {
+    uint8_t version;
+    uint8_t reserved;
+    // Little endian, CRC-16/CCITT of everything after the header.
+    uint16_t crc;
+    uint16_t bindings_len;
+} __packed;
+
+// Each binding that differs from the stock keymap is stored as its key position and behavior
+// local ID (little endian), one byte holding the byte length of each param, and then the params
+// with their zero high bytes trimmed.
+#define LAYER_BLOB_BINDING_MAX_SIZE (2 + 2 + 1 + 4 + 4)
+#define LAYER_BLOB_MAX_SIZE                                                                        \
+    (sizeof(struct layer_blob_header) + ZMK_KEYMAP_LEN * LAYER_BLOB_BINDING_MAX_SIZE)
+
+// Loads are serialized by the settings subsystem, which holds its own lock while calling the
+// handler. Saves come from both the Studio RPC thread and the legacy migration work, and take
+// layer_blob_save_lock, which is never held while loading.
+static uint8_t layer_blob_load_buf[LAYER_BLOB_MAX_SIZE];
+static uint8_t layer_blob_save_buf[LAYER_BLOB_MAX_SIZE];
+static K_MUTEX_DEFINE(layer_blob_save_lock);
+
+// Layers with a blob loaded from settings, which take precedence over per-key entries.
+static zmk_keymap_layers_state_t blob_layers;
+// Layers with per-key entries in settings, which get migrated to blobs after loading.
+static zmk_keymap_layers_state_t legacy_binding_layers;
+
+static bool is_stock_binding(zmk_keymap_layer_id_t layer_id, uint32_t key_position) {
+    const struct zmk_behavior_binding *binding = &zmk_keymap[layer_id][key_position];
+    const struct zmk_behavior_binding *stock = &zmk_stock_keymap[layer_id][key_position];
+
+    if (binding->param1 != stock->param1 || binding->param2 != stock->param2) {
+        return false;
+    }
+
+    if (!binding->behavior_dev || !stock->behavior_dev) {
+        return binding->behavior_dev == stock->behavior_dev;
+    }
+
+    return strcmp(binding->behavior_dev, stock->behavior_dev) == 0;
+}
+
+static uint8_t put_param(uint8_t *buf, uint32_t param) {
+    uint8_t len = 0;
+
+    while (param) {
+        buf[len++] = param & 0xFF;
+        param >>= 8;
+    }
+
+    return len;
+}
+
+static uint32_t get_param(const uint8_t *buf, uint8_t len) {
+    uint32_t param = 0;
+
+    for (int i = len - 1; i >= 0; i--) {
+        param = (param << 8) | buf[i];
+    }
+
+    return param;
+}
+
+static size_t encode_layer_blob(zmk_keymap_layer_id_t layer_id) {
+    uint8_t *pos = layer_blob_save_buf + sizeof(struct layer_blob_header);
+    uint16_t bindings_len = 0;
+
+    for (int k = 0; k < ZMK_KEYMAP_LEN; k++) {
+        if (is_stock_binding(layer_id, k)) {
+            continue;
+        }
+
+        const struct zmk_behavior_binding *binding = &zmk_keymap[layer_id][k];
+
+        sys_put_le16(k, pos);
+        sys_put_le16(zmk_behavior_get_local_id(binding->behavior_dev), pos + 2);
+
+        uint8_t *sizes = pos + 4;
+        pos += 5;
+
+        uint8_t param1_len = put_param(pos, binding->param1);
+        pos += param1_len;
+        uint8_t param2_len = put_param(pos, binding->param2);
+        pos += param2_len;
+
+        *sizes = param1_len | (param2_len << 4);
+        bindings_len++;
+    }
+
+    size_t payload_len = pos - (layer_blob_save_buf + sizeof(struct layer_blob_header));
+    struct layer_blob_header *header = (struct layer_blob_header *)layer_blob_save_buf;
+
+    header->version = LAYER_BLOB_VERSION;
+    header->reserved = 0;
+    header->crc = sys_cpu_to_le16(
+        crc16_ccitt(0, layer_blob_save_buf + sizeof(struct layer_blob_header), payload_len));
+    header->bindings_len = sys_cpu_to_le16(bindings_len);
+
+    return sizeof(struct layer_blob_header) + payload_len;
+}
+
+static int save_layer_blob(zmk_keymap_layer_id_t layer_id) {
+    char setting_name[14];
+    sprintf(setting_name, LAYER_BLOB_SETTINGS_KEY, layer_id);
+
+    k_mutex_lock(&layer_blob_save_lock, K_FOREVER);
+
+    size_t len = encode_layer_blob(layer_id);
+    const struct layer_blob_header *header = (const struct layer_blob_header *)layer_blob_save_buf;
+    uint16_t bindings_len = sys_le16_to_cpu(header->bindings_len);
+
+    int ret;
+    if (bindings_len == 0) {
+        ret = settings_delete(setting_name);
+    } else {
+        ret = settings_save_one(setting_name, layer_blob_save_buf, len);
+    }
+
+    if (ret >= 0) {
+        zmk_keymap_layers_state_write(&blob_layers, layer_id, bindings_len != 0);
+    }
+
+    k_mutex_unlock(&layer_blob_save_lock);
+
+    if (ret < 0) {
+        LOG_ERR("Failed to save keymap layer %d (%d)", layer_id, ret);
+        return ret;
+    }
+
+    LOG_DBG("Saved %d changed bindings on layer %d in %zu bytes", bindings_len, layer_id, len);
+    return 0;
+}
+
+static void reset_layer_to_stock(zmk_keymap_layer_id_t layer_id) {
+    for (int k = 0; k < ZMK_KEYMAP_LEN; k++) {
+        zmk_keymap[layer_id][k] = zmk_stock_keymap[layer_id][k];
+    }
+}
+
+static int decode_layer_blob(zmk_keymap_layer_id_t layer_id, const uint8_t *pos, size_t len,
+                             uint16_t bindings_len) {
+    const uint8_t *end = pos + len;
+
+    for (int i = 0; i < bindings_len; i++) {
+        if (end - pos < 5) {
+            return -EBADMSG;
+        }
+
+        uint16_t key_position = sys_get_le16(pos);
+        uint8_t param1_len = pos[4] & 0x0F;
+        uint8_t param2_len = pos[4] >> 4;
+
+        if (key_position >= ZMK_KEYMAP_LEN || param1_len > 4 || param2_len > 4 ||
+            end - pos < 5 + param1_len + param2_len) {
+            return -EBADMSG;
+        }
+
+        struct zmk_behavior_binding_setting setting = {
+            .behavior_local_id = sys_get_le16(pos + 2),
+            .param1 = get_param(pos + 5, param1_len),
+            .param2 = get_param(pos + 5 + param1_len, param2_len),
+        };
+
+        set_binding_from_setting(layer_id, key_position, &setting);
+        pos += 5 + param1_len + param2_len;
+    }
+
+    return 0;
+}
+
+static int load_layer_blob(zmk_keymap_layer_id_t layer_id, size_t len, settings_read_cb read_cb,
+                           void *cb_arg) {
+    const size_t header_len = sizeof(struct layer_blob_header);
+
+    if (len < header_len || len > sizeof(layer_blob_load_buf)) {
+        LOG_ERR("Invalid keymap layer %d setting size %zu", layer_id, len);
+        return -EINVAL;
+    }
+
+    int ret = read_cb(cb_arg, layer_blob_load_buf, len);
+    if (ret < (int)len) {
+        LOG_ERR("Failed to read keymap layer %d from settings (err %d)", layer_id, ret);
+        return ret < 0 ? ret : -EIO;
+    }
+
+    const struct layer_blob_header *header = (const struct layer_blob_header *)layer_blob_load_buf;
+    if (header->version != LAYER_BLOB_VERSION) {
+        LOG_WRN("Unsupported keymap layer %d setting version %d", layer_id, header->version);
+        return -ENOTSUP;
+    }
+
+    if (crc16_ccitt(0, layer_blob_load_buf + header_len, len - header_len) !=
+        sys_le16_to_cpu(header->crc)) {
+        LOG_ERR("Keymap layer %d setting failed its CRC check", layer_id);
+        return -EBADMSG;
+    }
+
+    // The blob only holds bindings that differ from the stock keymap, and replaces any per-key
+    // entries loaded for this layer.
+    reset_layer_to_stock(layer_id);
+
+    ret = decode_layer_blob(layer_id, layer_blob_load_buf + header_len, len - header_len,
+                            sys_le16_to_cpu(header->bindings_len));
+    if (ret < 0) {
+        LOG_ERR("Invalid bindings in keymap layer %d setting (%d)", layer_id, ret);
+        reset_layer_to_stock(layer_id);
+        return ret;
+    }
+
+    zmk_keymap_layers_state_write(&blob_layers, layer_id, true);
+
+    return 0;
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+
+// Only layers with pending changes are written again.
+static int save_bindings(void) {
+    for (int l = 0; l < ZMK_KEYMAP_LAYERS_LEN; l++) {
+        uint8_t *pending = zmk_keymap_layer_pending_changes[l];
+        bool changed = false;
+
+        for (int i = 0; i < PENDING_ARRAY_SIZE; i++) {
+            changed |= pending[i] != 0;
+        }
+
+        if (!changed) {
+            continue;
+        }
+
+        int ret = save_layer_blob(l);
+        if (ret < 0) {
+            return ret;
+        }
+
+        memset(pending, 0, PENDING_ARRAY_SIZE);
+    }
+
+    return 0;
+}
+
+#else
+
 static int save_bindings(void) {
     for (int l = 0; l < ZMK_KEYMAP_LAYERS_LEN; l++) {
         uint8_t *pending = zmk_keymap_layer_pending_changes[l];
@@ -526,6 +1084,8 @@ static int save_bindings(void) {
     return 0;
 }
 
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+
 #if IS_ENABLED(CONFIG_ZMK_KEYMAP_LAYER_REORDERING)
 static int save_layer_orders(void) {
     int ret = settings_save_one(LAYER_ORDER_SETTINGS_KEY, keymap_layer_orders,
@@ -541,7 +1101,7 @@ static int save_layer_orders(void) {
 
 static int save_layer_names(void) {
     for (int id = 0; id < ZMK_KEYMAP_LAYERS_LEN; id++) {
-        if (changed_layer_names & BIT(id)) {
+        if (zmk_keymap_layers_state_test(changed_layer_names, id)) {
             char setting_name[14];
             sprintf(setting_name, LAYER_NAME_SETTINGS_KEY, id);
             int ret = settings_save_one(setting_name, zmk_keymap_layer_names[id],
@@ -595,13 +1155,21 @@ static void reload_from_stock_keymap(void) {
             zmk_keymap[l][k] = zmk_stock_keymap[l][k];
         }
     }
+
+    resolve_keymap();
+    invalidate_effective_keymaps();
 }
 
 int zmk_keymap_discard_changes(void) {
     load_stock_keymap_layer_ordering();
     reload_from_stock_keymap();
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+    blob_layers = 0;
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
 
     int ret = settings_load_subtree("keymap");
+    record_reload();
+
     if (ret >= 0) {
         changed_layer_names = 0;
 
@@ -641,7 +1209,7 @@ static int keymap_track_changed_bindings(const char *key, size_t len, settings_r
 int zmk_keymap_reset_settings(void) {
     settings_delete(LAYER_ORDER_SETTINGS_KEY);
 
-    uint8_t zmk_keymap_layer_changes[ZMK_KEYMAP_LAYERS_LEN][PENDING_ARRAY_SIZE];
+    uint8_t zmk_keymap_layer_changes[ZMK_KEYMAP_LAYERS_LEN][PENDING_ARRAY_SIZE] = {0};
 
     settings_load_subtree_direct("keymap", keymap_track_changed_bindings,
                                  &zmk_keymap_layer_changes);
@@ -651,6 +1219,12 @@ int zmk_keymap_reset_settings(void) {
         sprintf(layer_name_setting_name, LAYER_NAME_SETTINGS_KEY, l);
         settings_delete(layer_name_setting_name);
 
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+        char layer_blob_setting_name[14];
+        sprintf(layer_blob_setting_name, LAYER_BLOB_SETTINGS_KEY, l);
+        settings_delete(layer_blob_setting_name);
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+
         uint8_t *changes = zmk_keymap_layer_changes[l];
 
         for (int k = 0; k < ZMK_KEYMAP_LEN; k++) {
@@ -671,10 +1245,53 @@ int zmk_keymap_reset_settings(void) {
     load_stock_keymap_layer_ordering();
 
     reload_from_stock_keymap();
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+    blob_layers = 0;
+    // The per-key entries were deleted above, so there is nothing left to migrate.
+    legacy_binding_layers = 0;
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+    record_reload();
 
     return 0;
 }
 
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+
+// Rewrites layers loaded from per-key entries as blobs, then deletes those entries. If this is
+// interrupted, the blobs take precedence on the next load and the migration runs again.
+static void migrate_legacy_bindings(struct k_work *work) {
+    for (int l = 0; l < ZMK_KEYMAP_LAYERS_LEN; l++) {
+        if (!zmk_keymap_layers_state_test(legacy_binding_layers, l)) {
+            continue;
+        }
+
+        int ret = save_layer_blob(l);
+        if (ret < 0) {
+            return;
+        }
+    }
+
+    uint8_t legacy_changes[ZMK_KEYMAP_LAYERS_LEN][PENDING_ARRAY_SIZE] = {0};
+    settings_load_subtree_direct("keymap", keymap_track_changed_bindings, &legacy_changes);
+
+    for (int l = 0; l < ZMK_KEYMAP_LAYERS_LEN; l++) {
+        for (int k = 0; k < ZMK_KEYMAP_LEN; k++) {
+            if (legacy_changes[l][k / 8] & BIT(k % 8)) {
+                char setting_name[20];
+                sprintf(setting_name, LAYER_BINDING_SETTINGS_KEY, l, k);
+                settings_delete(setting_name);
+            }
+        }
+    }
+
+    LOG_INF("Migrated keymap bindings from per-key settings to layer blobs");
+    legacy_binding_layers = 0;
+}
+
+static K_WORK_DEFINE(migrate_legacy_bindings_work, migrate_legacy_bindings);
+
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+
 #else
 
 int zmk_keymap_save_changes(void) { return -ENOTSUP; }
@@ -689,6 +1306,14 @@ int zmk_keymap_apply_position_state(uint8_t source, zmk_keymap_layer_id_t layer_
                                     uint32_t position, bool pressed, int64_t timestamp) {
     const struct zmk_behavior_binding *binding =
         zmk_keymap_get_layer_binding_at_idx(layer_id, position);
+    if (!binding) {
+        return 1;
+    }
+
+    // The binding may have been mapped to a different stock key position, so find the resolved
+    // binding by its offset in the layer.
+    const struct zmk_behavior_resolved_binding *resolved =
+        &resolved_keymap[layer_id][binding - zmk_keymap[layer_id]];
     struct zmk_behavior_binding_event event = {
         .layer = layer_id,
         .position = position,
@@ -701,7 +1326,7 @@ int zmk_keymap_apply_position_state(uint8_t source, zmk_keymap_layer_id_t layer_
     LOG_DBG("layer_id: %d position: %d, binding name: %s", layer_id, position,
             binding->behavior_dev);
 
-    return zmk_behavior_invoke_binding(binding, event, pressed);
+    return zmk_behavior_invoke_resolved_binding(binding, resolved, event, pressed);
 }
 
 int zmk_keymap_position_state_changed(uint8_t source, uint32_t position, bool pressed,
@@ -711,7 +1336,8 @@ int zmk_keymap_position_state_changed(uint8_t source, uint32_t position, bool pr
     }
 
     // We use int here to be sure we don't loop layer_idx back to UINT8_MAX
-    for (int layer_idx = ZMK_KEYMAP_LAYERS_LEN - 1;
+    for (int layer_idx =
+             effective_layer_start_idx(position, zmk_keymap_active_behavior_layer[position]);
          layer_idx >= LAYER_ID_TO_INDEX(_zmk_keymap_layer_default); layer_idx--) {
         zmk_keymap_layer_id_t layer_id = LAYER_INDEX_TO_ID(layer_idx);
 
@@ -803,6 +1429,7 @@ int zmk_keymap_sensor_event(uint8_t sensor_index,
 int keymap_listener(const zmk_event_t *eh) {
     const struct zmk_position_state_changed *pos_ev;
     if ((pos_ev = as_zmk_position_state_changed(eh)) != NULL) {
+        zmk_latency_trace_stamp(ZMK_LATENCY_TRACE_STAGE_DISPATCH);
         return zmk_keymap_position_state_changed(pos_ev->source, pos_ev->position, pos_ev->state,
                                                  pos_ev->timestamp);
     }
@@ -853,7 +1480,21 @@ static int keymap_handle_set(const char *name, size_t len, settings_read_cb read
         }
 
         zmk_keymap_layer_names[layer][ret] = 0;
-    } else if (settings_name_steq(name, "l", &next) && next) {
+    }
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+    else if (settings_name_steq(name, "lb", &next) && next) {
+        char *endptr;
+        zmk_keymap_layer_id_t layer = strtoul(next, &endptr, 10);
+
+        if (*endptr != '\0' || layer >= ZMK_KEYMAP_LAYERS_LEN) {
+            LOG_WRN("Invalid layer number: %s", next);
+            return -EINVAL;
+        }
+
+        return load_layer_blob(layer, len, read_cb, cb_arg);
+    }
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+    else if (settings_name_steq(name, "l", &next) && next) {
         char *endptr;
         uint8_t layer = strtoul(next, &endptr, 10);
         if (*endptr != '/') {
@@ -884,6 +1525,14 @@ static int keymap_handle_set(const char *name, size_t len, settings_read_cb read
             return -EINVAL;
         }
 
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+        zmk_keymap_layers_state_write(&legacy_binding_layers, layer, true);
+
+        if (zmk_keymap_layers_state_test(blob_layers, layer)) {
+            return 0;
+        }
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+
         struct zmk_behavior_binding_setting binding_setting = {0};
         int err = read_cb(cb_arg, &binding_setting, len);
         if (err <= 0) {
@@ -891,22 +1540,7 @@ static int keymap_handle_set(const char *name, size_t len, settings_read_cb read
             return err;
         }
 
-        const char *name =
-            zmk_behavior_find_behavior_name_from_local_id(binding_setting.behavior_local_id);
-
-        if (!name) {
-            LOG_WRN("Loaded device %d from settings but no device found by that local ID",
-                    binding_setting.behavior_local_id);
-        }
-
-        zmk_keymap[layer][key_position] = (struct zmk_behavior_binding){
-#if IS_ENABLED(CONFIG_ZMK_BEHAVIOR_LOCAL_IDS_IN_BINDINGS)
-            .local_id = binding_setting.behavior_local_id,
-#endif
-            .behavior_dev = name,
-            .param1 = binding_setting.param1,
-            .param2 = binding_setting.param2,
-        };
+        set_binding_from_setting(layer, key_position, &binding_setting);
     }
 #if IS_ENABLED(CONFIG_ZMK_KEYMAP_LAYER_REORDERING)
     else if (settings_name_steq(name, "layer_order", &next) && !next) {
@@ -947,6 +1581,16 @@ static int keymap_handle_commit(void) {
     }
 #endif
 
+    resolve_keymap();
+    invalidate_effective_keymaps();
+    record_reload();
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+    if (legacy_binding_layers) {
+        k_work_submit(&migrate_legacy_bindings_work);
+    }
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_SETTINGS_STORAGE_LAYER_BLOBS)
+
     return 0;
 }
 
@@ -961,6 +1605,8 @@ int keymap_init(void) {
 #endif
 #if IS_ENABLED(CONFIG_ZMK_STUDIO)
     reload_from_stock_keymap();
+#else
+    resolve_keymap();
 #endif
 
     return 0;
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(zmk_latency_trace, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/latency_trace.h>
+
+#define STAGE_NOT_REACHED UINT32_MAX
+
+#define RING_SIZE CONFIG_ZMK_LATENCY_TRACE_RING_SIZE
+
+struct trace_record {
+    // Cycles from the kscan callback to each stage, STAGE_NOT_REACHED if never stamped.
+    uint32_t stage_cycles[ZMK_LATENCY_TRACE_STAGE_COUNT];
+};
+
+// Records are only produced from the thread draining the kscan queue, so the ring has a single
+// writer. Readers copy samples out without locking; a sample overwritten mid-copy only skews a
+// single data point in the aggregate.
+static struct trace_record ring[RING_SIZE];
+static atomic_t ring_head = ATOMIC_INIT(0);
+
+// Scratch space for sorting one stage's samples, kept off the caller's stack since the ring can
+// be large.
+static uint32_t sorted_samples[RING_SIZE];
+static K_MUTEX_DEFINE(sorted_samples_lock);
+
+static struct {
+    bool active;
+    uint32_t start;
+    // Stages are only stamped from the thread processing the change, so work done for other
+    // changes on other threads isn't attributed to it.
+    k_tid_t thread;
+    struct trace_record record;
+} in_flight;
+
+static const char *const stage_names[] = {
+    [ZMK_LATENCY_TRACE_STAGE_KSCAN] = "kscan",
+    [ZMK_LATENCY_TRACE_STAGE_MSGQ_DRAIN] = "msgq-drain",
+    [ZMK_LATENCY_TRACE_STAGE_DISPATCH] = "dispatch",
+    [ZMK_LATENCY_TRACE_STAGE_BEHAVIOR] = "behavior",
+    [ZMK_LATENCY_TRACE_STAGE_HID] = "hid",
+    [ZMK_LATENCY_TRACE_STAGE_TRANSPORT] = "transport",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(stage_names) == ZMK_LATENCY_TRACE_STAGE_COUNT,
+             "Every latency trace stage needs a name");
+
+void zmk_latency_trace_begin(uint32_t kscan_cycles) {
+    in_flight.active = true;
+    in_flight.start = kscan_cycles;
+    in_flight.thread = k_current_get();
+
+    for (int i = 0; i < ZMK_LATENCY_TRACE_STAGE_COUNT; i++) {
+        in_flight.record.stage_cycles[i] = STAGE_NOT_REACHED;
+    }
+
+    in_flight.record.stage_cycles[ZMK_LATENCY_TRACE_STAGE_KSCAN] = 0;
+    zmk_latency_trace_stamp(ZMK_LATENCY_TRACE_STAGE_MSGQ_DRAIN);
+}
+
+void zmk_latency_trace_stamp(enum zmk_latency_trace_stage stage) {
+    if (!in_flight.active || k_current_get() != in_flight.thread) {
+        return;
+    }
+
+    if (in_flight.record.stage_cycles[stage] == STAGE_NOT_REACHED) {
+        in_flight.record.stage_cycles[stage] = zmk_latency_trace_now() - in_flight.start;
+    }
+}
+
+void zmk_latency_trace_end(void) {
+    if (!in_flight.active) {
+        return;
+    }
+
+    in_flight.active = false;
+
+    atomic_val_t head = atomic_get(&ring_head);
+    ring[head % RING_SIZE] = in_flight.record;
+    atomic_inc(&ring_head);
+}
+
+void zmk_latency_trace_reset(void) { atomic_set(&ring_head, 0); }
+
+static void sort_samples(uint32_t *samples, size_t len) {
+    for (size_t i = 1; i < len; i++) {
+        uint32_t val = samples[i];
+        size_t j = i;
+        for (; j > 0 && samples[j - 1] > val; j--) {
+            samples[j] = samples[j - 1];
+        }
+        samples[j] = val;
+    }
+}
+
+int zmk_latency_trace_get_stats(enum zmk_latency_trace_stage stage,
+                                struct zmk_latency_trace_stats *stats) {
+    if (stage >= ZMK_LATENCY_TRACE_STAGE_COUNT) {
+        return -EINVAL;
+    }
+
+    uint32_t *samples = sorted_samples;
+    size_t len = 0;
+
+    k_mutex_lock(&sorted_samples_lock, K_FOREVER);
+
+    size_t available = MIN(atomic_get(&ring_head), RING_SIZE);
+
+    for (size_t i = 0; i < available; i++) {
+        uint32_t cycles = ring[i].stage_cycles[stage];
+        if (cycles != STAGE_NOT_REACHED) {
+            samples[len++] = cycles;
+        }
+    }
+
+    *stats = (struct zmk_latency_trace_stats){.samples = len};
+
+    if (len == 0) {
+        k_mutex_unlock(&sorted_samples_lock);
+        return 0;
+    }
+
+    sort_samples(samples, len);
+
+    stats->min_us = k_cyc_to_us_near32(samples[0]);
+    stats->p50_us = k_cyc_to_us_near32(samples[(len - 1) / 2]);
+    stats->p99_us = k_cyc_to_us_near32(samples[((len - 1) * 99) / 100]);
+    stats->max_us = k_cyc_to_us_near32(samples[len - 1]);
+
+    k_mutex_unlock(&sorted_samples_lock);
+    return 0;
+}
+
+void zmk_latency_trace_log_dump(void) {
+    LOG_INF("Key latency over the last %d position changes (us since kscan):",
+            (int)MIN(atomic_get(&ring_head), RING_SIZE));
+
+    for (int i = ZMK_LATENCY_TRACE_STAGE_MSGQ_DRAIN; i < ZMK_LATENCY_TRACE_STAGE_COUNT; i++) {
+        struct zmk_latency_trace_stats stats;
+        zmk_latency_trace_get_stats(i, &stats);
+
+        LOG_INF("%-10s n=%d min=%d p50=%d p99=%d max=%d", stage_names[i], stats.samples,
+                stats.min_us, stats.p50_us, stats.p99_us, stats.max_us);
+    }
+}
+
+#if CONFIG_ZMK_LATENCY_TRACE_LOG_INTERVAL_SEC > 0
+
+static void latency_trace_log_work_cb(struct k_work *work) {
+    zmk_latency_trace_log_dump();
+    k_work_schedule((struct k_work_delayable *)work,
+                    K_SECONDS(CONFIG_ZMK_LATENCY_TRACE_LOG_INTERVAL_SEC));
+}
+
+static K_WORK_DELAYABLE_DEFINE(latency_trace_log_work, latency_trace_log_work_cb);
+
+static int zmk_latency_trace_init(void) {
+    k_work_schedule(&latency_trace_log_work, K_SECONDS(CONFIG_ZMK_LATENCY_TRACE_LOG_INTERVAL_SEC));
+    return 0;
+}
+
+SYS_INIT(zmk_latency_trace_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#endif // CONFIG_ZMK_LATENCY_TRACE_LOG_INTERVAL_SEC > 0
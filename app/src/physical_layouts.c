@@ -18,6 +18,8 @@
 
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/kscan_event_time.h>
+#include <zmk/latency_trace.h>
 #include <zmk/matrix.h>
 #include <zmk/physical_layouts.h>
 #include <zmk/event_manager.h>
@@ -171,6 +173,10 @@ struct zmk_kscan_event {
     uint32_t row;
     uint32_t column;
     uint32_t state;
+    int64_t timestamp;
+#if IS_ENABLED(CONFIG_ZMK_LATENCY_TRACE)
+    uint32_t trace_cycles;
+#endif
 };
 
 static struct zmk_kscan_msg_processor {
@@ -189,7 +195,12 @@ static void zmk_physical_layout_kscan_callback(const struct device *dev, uint32_
     struct zmk_kscan_event ev = {
         .row = row,
         .column = column,
-        .state = (pressed ? ZMK_KSCAN_EVENT_STATE_PRESSED : ZMK_KSCAN_EVENT_STATE_RELEASED)};
+        .state = (pressed ? ZMK_KSCAN_EVENT_STATE_PRESSED : ZMK_KSCAN_EVENT_STATE_RELEASED),
+        .timestamp = zmk_kscan_event_time_get(dev),
+#if IS_ENABLED(CONFIG_ZMK_LATENCY_TRACE)
+        .trace_cycles = zmk_latency_trace_now(),
+#endif
+    };
 
     k_msgq_put(&physical_layouts_kscan_msgq, &ev, K_NO_WAIT);
     k_work_submit(&msg_processor.work);
@@ -211,11 +222,15 @@ static void zmk_physical_layouts_kscan_process_msgq(struct k_work *item) {
 
         LOG_DBG("Row: %d, col: %d, position: %d, pressed: %s", ev.row, ev.column, position,
                 (pressed ? "true" : "false"));
+#if IS_ENABLED(CONFIG_ZMK_LATENCY_TRACE)
+        zmk_latency_trace_begin(ev.trace_cycles);
+#endif
         raise_zmk_position_state_changed(
             (struct zmk_position_state_changed){.source = ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL,
                                                 .state = pressed,
                                                 .position = position,
-                                                .timestamp = k_uptime_get()});
+                                                .timestamp = ev.timestamp});
+        zmk_latency_trace_end();
     }
 }
 
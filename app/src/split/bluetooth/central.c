@@ -36,7 +36,7 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 static int start_scanning(void);
 
-#define POSITION_STATE_DATA_LEN 16
+#define POSITION_STATE_DATA_LEN ZMK_SPLIT_POS_STATE_LEN
 
 enum peripheral_slot_state {
     PERIPHERAL_SLOT_STATE_OPEN,
@@ -44,6 +44,15 @@ enum peripheral_slot_state {
     PERIPHERAL_SLOT_STATE_CONNECTED,
 };
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+
+struct peripheral_behavior_local_id {
+    zmk_behavior_local_id_t central;
+    zmk_behavior_local_id_t peripheral;
+};
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+
 struct peripheral_slot {
     enum peripheral_slot_state state;
     struct bt_conn *conn;
@@ -60,6 +69,29 @@ struct peripheral_slot {
     uint16_t update_hid_indicators;
 #endif // IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_HID_INDICATORS)
     uint16_t selected_physical_layout_handle;
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+    uint16_t clock_handle;
+    struct bt_gatt_read_params clock_read_params;
+    bool clock_read_pending;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+    uint16_t run_behavior_by_id_handle;
+    struct bt_gatt_read_params behavior_local_ids_read_params;
+    struct peripheral_behavior_local_id
+        behavior_local_ids[CONFIG_ZMK_SPLIT_BLE_CENTRAL_BEHAVIOR_LOCAL_IDS_MAX];
+    uint8_t behavior_local_ids_len;
+    // The table entry being read, which may span several reads.
+    uint8_t behavior_local_id_entry[sizeof(zmk_behavior_local_id_t) +
+                                    ZMK_SPLIT_BEHAVIOR_LOCAL_ID_NAME_MAX_LEN];
+    uint8_t behavior_local_id_entry_len;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+    struct bt_gatt_subscribe_params delta_subscribe_params;
+    struct bt_gatt_read_params position_state_read_params;
+    uint8_t delta_seq;
+    bool delta_synced;
+    bool position_state_read_pending;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
     uint8_t position_state[POSITION_STATE_DATA_LEN];
     uint8_t changed_positions[POSITION_STATE_DATA_LEN];
 };
@@ -211,11 +243,25 @@ int release_peripheral_slot(int index) {
 
     // Clean up previously discovered handles;
     slot->subscribe_params.value_handle = 0;
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+    slot->run_behavior_by_id_handle = 0;
+    slot->behavior_local_ids_len = 0;
+    slot->behavior_local_id_entry_len = 0;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+    slot->delta_subscribe_params.value_handle = 0;
+    slot->delta_synced = false;
+    slot->position_state_read_pending = false;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
     slot->run_behavior_handle = 0;
     slot->selected_physical_layout_handle = 0;
 #if IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_HID_INDICATORS)
     slot->update_hid_indicators = 0;
 #endif // IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_HID_INDICATORS)
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+    slot->clock_handle = 0;
+    slot->clock_read_pending = false;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
 
     return 0;
 }
@@ -271,18 +317,22 @@ static uint8_t split_central_sensor_notify_func(struct bt_conn *conn,
         return BT_GATT_ITER_STOP;
     }
 
-    struct sensor_event sensor_event;
+    struct sensor_event sensor_event = {0};
     memcpy(&sensor_event, data, MIN(length, sizeof(sensor_event)));
     if (sensor_event.channel_data_size != 1) {
         return BT_GATT_ITER_STOP;
     }
 
+    // Peripherals that predate event timestamps leave it out, which reads as "no timestamp".
+    uint16_t timestamp = sys_le16_to_cpu(sensor_event.timestamp);
+
     struct peripheral_event_wrapper event_wrapper = {
         .source = peripheral_slot_index_for_conn(conn),
         .event = {.type = ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_SENSOR_EVENT,
                   .data = {.sensor_event = {
                                .channel_data = sensor_event.channel_data[0],
                                .sensor_index = sensor_event.sensor_index,
+                               .timestamp = timestamp,
                            }}}};
 
     k_msgq_put(&peripheral_event_msgq, &event_wrapper, K_NO_WAIT);
@@ -337,6 +387,39 @@ static uint8_t peripheral_input_event_notify_cb(struct bt_conn *conn,
 
 #endif
 
+static void raise_position_event(struct bt_conn *conn, uint32_t position, bool pressed,
+                                 uint16_t timestamp) {
+    struct peripheral_event_wrapper ev = {
+        .source = peripheral_slot_index_for_conn(conn),
+        .event = {.type = ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_KEY_POSITION_EVENT,
+                  .data = {.key_position_event = {
+                               .position = position,
+                               .pressed = pressed,
+                               .timestamp = timestamp,
+                           }}}};
+    k_msgq_put(&peripheral_event_msgq, &ev, K_NO_WAIT);
+    k_work_submit(&peripheral_event_work);
+}
+
+static void apply_position_state(struct bt_conn *conn, struct peripheral_slot *slot,
+                                 const uint8_t *state, uint16_t timestamp) {
+    for (int i = 0; i < POSITION_STATE_DATA_LEN; i++) {
+        slot->changed_positions[i] = state[i] ^ slot->position_state[i];
+        slot->position_state[i] = state[i];
+    }
+    LOG_HEXDUMP_DBG(slot->position_state, POSITION_STATE_DATA_LEN, "data");
+
+    for (int i = 0; i < POSITION_STATE_DATA_LEN; i++) {
+        for (int j = 0; j < 8; j++) {
+            if (slot->changed_positions[i] & BIT(j)) {
+                uint32_t position = (i * 8) + j;
+                bool pressed = slot->position_state[i] & BIT(j);
+                raise_position_event(conn, position, pressed, timestamp);
+            }
+        }
+    }
+}
+
 static uint8_t split_central_notify_func(struct bt_conn *conn,
                                          struct bt_gatt_subscribe_params *params, const void *data,
                                          uint16_t length) {
@@ -355,33 +438,141 @@ static uint8_t split_central_notify_func(struct bt_conn *conn,
 
     LOG_DBG("[NOTIFICATION] data %p length %u", data, length);
 
-    for (int i = 0; i < POSITION_STATE_DATA_LEN; i++) {
-        slot->changed_positions[i] = ((uint8_t *)data)[i] ^ slot->position_state[i];
-        slot->position_state[i] = ((uint8_t *)data)[i];
+    if (length < POSITION_STATE_DATA_LEN) {
+        LOG_WRN("Ignoring position state notify with insufficient data length (%d)", length);
+        return BT_GATT_ITER_CONTINUE;
     }
-    LOG_HEXDUMP_DBG(slot->position_state, POSITION_STATE_DATA_LEN, "data");
 
-    for (int i = 0; i < POSITION_STATE_DATA_LEN; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (slot->changed_positions[i] & BIT(j)) {
-                uint32_t position = (i * 8) + j;
-                bool pressed = slot->position_state[i] & BIT(j);
-                struct peripheral_event_wrapper ev = {
-                    .source = peripheral_slot_index_for_conn(conn),
-                    .event = {.type = ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_KEY_POSITION_EVENT,
-                              .data = {.key_position_event = {
-                                           .position = position,
-                                           .pressed = pressed,
-                                       }}}};
-                k_msgq_put(&peripheral_event_msgq, &ev, K_NO_WAIT);
-                k_work_submit(&peripheral_event_work);
-            }
+    uint16_t timestamp = ZMK_SPLIT_TRANSPORT_TIMESTAMP_NONE;
+    if (length >= sizeof(struct zmk_split_position_state_payload)) {
+        timestamp = sys_get_le16(
+            (uint8_t *)data + offsetof(struct zmk_split_position_state_payload, timestamp));
+    }
+
+    apply_position_state(conn, slot, data, timestamp);
+
+    return BT_GATT_ITER_CONTINUE;
+}
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+
+static uint8_t split_central_position_state_read_func(struct bt_conn *conn, uint8_t err,
+                                                      struct bt_gatt_read_params *params,
+                                                      const void *data, uint16_t length) {
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+
+    if (!slot) {
+        LOG_ERR("No peripheral state found for connection");
+        return BT_GATT_ITER_STOP;
+    }
+
+    slot->position_state_read_pending = false;
+
+    if (err > 0) {
+        LOG_ERR("Error during reading peripheral position state: %u", err);
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (!data || length < POSITION_STATE_DATA_LEN) {
+        return BT_GATT_ITER_STOP;
+    }
+
+    LOG_DBG("Resynchronized position state from peripheral");
+    apply_position_state(conn, slot, data, ZMK_SPLIT_TRANSPORT_TIMESTAMP_NONE);
+    slot->delta_synced = true;
+
+    return BT_GATT_ITER_STOP;
+}
+
+static void resync_position_state(struct peripheral_slot *slot) {
+    if (slot->position_state_read_pending || slot->subscribe_params.value_handle == 0) {
+        // Fall back to waiting for the next keyframe.
+        return;
+    }
+
+    slot->position_state_read_params.func = split_central_position_state_read_func;
+    slot->position_state_read_params.handle_count = 1;
+    slot->position_state_read_params.single.handle = slot->subscribe_params.value_handle;
+    slot->position_state_read_params.single.offset = 0;
+
+    int err = bt_gatt_read(slot->conn, &slot->position_state_read_params);
+    if (err < 0) {
+        LOG_WRN("Failed to read the peripheral position state (err %d)", err);
+        return;
+    }
+
+    slot->position_state_read_pending = true;
+}
+
+static uint8_t split_central_delta_notify_func(struct bt_conn *conn,
+                                               struct bt_gatt_subscribe_params *params,
+                                               const void *data, uint16_t length) {
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+
+    if (slot == NULL) {
+        LOG_ERR("No peripheral state found for connection");
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    if (!data) {
+        LOG_DBG("[UNSUBSCRIBED]");
+        params->value_handle = 0U;
+        return BT_GATT_ITER_STOP;
+    }
+
+    LOG_DBG("[DELTA NOTIFICATION] data %p length %u", data, length);
+
+    const size_t header_len = offsetof(struct zmk_split_position_delta_payload, data);
+    if (length < header_len || length > sizeof(struct zmk_split_position_delta_payload)) {
+        LOG_WRN("Ignoring position delta notify with invalid data length (%d)", length);
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    struct zmk_split_position_delta_payload payload;
+    memcpy(&payload, data, length);
+
+    uint16_t timestamp = sys_le16_to_cpu(payload.timestamp);
+    size_t count = length - header_len;
+
+    if (payload.flags & ZMK_SPLIT_POSITION_DELTA_FLAG_KEYFRAME) {
+        if (count < POSITION_STATE_DATA_LEN) {
+            LOG_WRN("Ignoring position keyframe with insufficient data length (%d)", length);
+            return BT_GATT_ITER_CONTINUE;
         }
+
+        apply_position_state(conn, slot, payload.data, timestamp);
+        slot->delta_synced = true;
+        slot->delta_seq = payload.seq;
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    if (!slot->delta_synced || payload.seq != (uint8_t)(slot->delta_seq + 1)) {
+        // Deltas carry the new state of each position, so this one still applies, but any
+        // changes in the ones we missed need the full state.
+        LOG_WRN("Missed position deltas before %u, resynchronizing", payload.seq);
+        resync_position_state(slot);
+    }
+
+    slot->delta_seq = payload.seq;
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t position = payload.data[i] & ZMK_SPLIT_POSITION_DELTA_POSITION_MASK;
+        bool pressed = payload.data[i] & ZMK_SPLIT_POSITION_DELTA_PRESSED;
+
+        if (position >= POSITION_STATE_DATA_LEN * 8 ||
+            !(slot->position_state[position / 8] & BIT(position % 8)) == !pressed) {
+            continue;
+        }
+
+        WRITE_BIT(slot->position_state[position / 8], position % 8, pressed);
+        raise_position_event(conn, position, pressed, timestamp);
     }
 
     return BT_GATT_ITER_CONTINUE;
 }
 
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+
 #if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_BATTERY_LEVEL_FETCHING)
 
 static uint8_t split_central_battery_level_notify_func(struct bt_conn *conn,
@@ -468,6 +659,184 @@ static uint8_t split_central_battery_level_read_func(struct bt_conn *conn, uint8
 
 #endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_BATTERY_LEVEL_FETCHING) */
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+
+static uint8_t split_central_clock_read_func(struct bt_conn *conn, uint8_t err,
+                                             struct bt_gatt_read_params *params, const void *data,
+                                             uint16_t length) {
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+
+    if (!slot) {
+        LOG_ERR("No peripheral state found for connection");
+        return BT_GATT_ITER_STOP;
+    }
+
+    slot->clock_read_pending = false;
+
+    if (err > 0) {
+        LOG_ERR("Error during reading peripheral clock: %u", err);
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (!data) {
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (length < sizeof(uint32_t)) {
+        LOG_WRN("Ignoring peripheral clock read with insufficient data length (%d)", length);
+        return BT_GATT_ITER_STOP;
+    }
+
+    struct peripheral_event_wrapper ev = {
+        .source = peripheral_slot_index_for_conn(conn),
+        .event = {.type = ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_CLOCK_SYNC_EVENT,
+                  .data = {.clock_sync_event = {
+                               .uptime = sys_get_le32(data),
+                           }}}};
+
+    k_msgq_put(&peripheral_event_msgq, &ev, K_NO_WAIT);
+    k_work_submit(&peripheral_event_work);
+
+    return BT_GATT_ITER_STOP;
+}
+
+static int read_peripheral_clock(struct peripheral_slot *slot) {
+    if (slot->clock_handle == 0) {
+        // Peripherals running older firmware don't expose their clock.
+        return -ENOTSUP;
+    }
+
+    if (slot->clock_read_pending) {
+        // The read params are still owned by the stack until the previous read completes.
+        return -EBUSY;
+    }
+
+    slot->clock_read_params.func = split_central_clock_read_func;
+    slot->clock_read_params.handle_count = 1;
+    slot->clock_read_params.single.handle = slot->clock_handle;
+    slot->clock_read_params.single.offset = 0;
+
+    slot->clock_read_pending = true;
+
+    int err = bt_gatt_read(slot->conn, &slot->clock_read_params);
+    if (err < 0) {
+        LOG_WRN("Failed to read the peripheral clock (err %d)", err);
+        slot->clock_read_pending = false;
+    }
+
+    return err;
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+
+static void add_peripheral_behavior_local_id(struct peripheral_slot *slot, const uint8_t *entry) {
+    const char *name = (const char *)entry + sizeof(zmk_behavior_local_id_t);
+    zmk_behavior_local_id_t central_id = zmk_behavior_get_local_id(name);
+
+    if (central_id == UINT16_MAX) {
+        LOG_DBG("Peripheral behavior %s isn't on the central", name);
+        return;
+    }
+
+    if (slot->behavior_local_ids_len == ARRAY_SIZE(slot->behavior_local_ids)) {
+        LOG_WRN("No room for the local ID of peripheral behavior %s, it will be invoked by name",
+                name);
+        return;
+    }
+
+    slot->behavior_local_ids[slot->behavior_local_ids_len].central = central_id;
+    slot->behavior_local_ids[slot->behavior_local_ids_len].peripheral = sys_get_le16(entry);
+    slot->behavior_local_ids_len++;
+}
+
+static uint8_t split_central_behavior_local_ids_read_func(struct bt_conn *conn, uint8_t err,
+                                                          struct bt_gatt_read_params *params,
+                                                          const void *data, uint16_t length) {
+    if (err > 0) {
+        LOG_ERR("Error during reading peripheral behavior local IDs: %u", err);
+        return BT_GATT_ITER_STOP;
+    }
+
+    struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+
+    if (!slot) {
+        LOG_ERR("No peripheral state found for connection");
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (!data) {
+        LOG_DBG("Read %d peripheral behavior local IDs", slot->behavior_local_ids_len);
+        return BT_GATT_ITER_STOP;
+    }
+
+    for (uint16_t i = 0; i < length; i++) {
+        uint8_t byte = ((const uint8_t *)data)[i];
+
+        // Names too long for the entry buffer are skipped, and those behaviors are invoked by name.
+        if (slot->behavior_local_id_entry_len < sizeof(slot->behavior_local_id_entry)) {
+            slot->behavior_local_id_entry[slot->behavior_local_id_entry_len] = byte;
+        }
+        slot->behavior_local_id_entry_len = MIN(slot->behavior_local_id_entry_len + 1, UINT8_MAX);
+
+        if (byte != '\0' || slot->behavior_local_id_entry_len <= sizeof(zmk_behavior_local_id_t)) {
+            continue;
+        }
+
+        if (slot->behavior_local_id_entry_len <= sizeof(slot->behavior_local_id_entry)) {
+            add_peripheral_behavior_local_id(slot, slot->behavior_local_id_entry);
+        }
+        slot->behavior_local_id_entry_len = 0;
+    }
+
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static int read_peripheral_behavior_local_ids(struct bt_conn *conn, struct peripheral_slot *slot,
+                                              uint16_t handle) {
+    slot->behavior_local_ids_len = 0;
+    slot->behavior_local_id_entry_len = 0;
+
+    slot->behavior_local_ids_read_params.func = split_central_behavior_local_ids_read_func;
+    slot->behavior_local_ids_read_params.handle_count = 1;
+    slot->behavior_local_ids_read_params.single.handle = handle;
+    slot->behavior_local_ids_read_params.single.offset = 0;
+
+    int err = bt_gatt_read(conn, &slot->behavior_local_ids_read_params);
+    if (err < 0) {
+        LOG_WRN("Failed to read the peripheral behavior local IDs (err %d)", err);
+    }
+
+    return err;
+}
+
+static int run_peripheral_behavior_by_id(struct peripheral_slot *slot,
+                                         const struct zmk_split_run_behavior_data *data,
+                                         zmk_behavior_local_id_t central_id) {
+    if (!slot->run_behavior_by_id_handle) {
+        return -ENOTSUP;
+    }
+
+    for (int i = 0; i < slot->behavior_local_ids_len; i++) {
+        if (slot->behavior_local_ids[i].central != central_id) {
+            continue;
+        }
+
+        struct zmk_split_run_behavior_by_id_payload payload = {
+            .data = *data,
+            .behavior_local_id = sys_cpu_to_le16(slot->behavior_local_ids[i].peripheral),
+        };
+
+        return bt_gatt_write_without_response(slot->conn, slot->run_behavior_by_id_handle,
+                                              &payload, sizeof(payload), true);
+    }
+
+    return -ENOENT;
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+
 static int split_central_subscribe(struct bt_conn *conn, struct bt_gatt_subscribe_params *params) {
     atomic_set(params->flags, BT_GATT_SUBSCRIBE_FLAG_NO_RESUB);
     int err = bt_gatt_subscribe(conn, params);
@@ -531,6 +900,14 @@ static uint8_t split_central_chrc_discovery_func(struct bt_conn *conn,
                                                  struct bt_gatt_discover_params *params) {
     if (!attr) {
         LOG_DBG("Discover complete");
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+        struct peripheral_slot *slot = peripheral_slot_for_conn(conn);
+        if (slot != NULL && slot->subscribe_params.value_handle &&
+            !slot->delta_subscribe_params.value_handle) {
+            LOG_DBG("Peripheral has no position delta characteristic, using the bitmap");
+            split_central_subscribe(conn, &slot->subscribe_params);
+        }
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
         return BT_GATT_ITER_STOP;
     }
 
@@ -558,7 +935,22 @@ static uint8_t split_central_chrc_discovery_func(struct bt_conn *conn,
             slot->subscribe_params.value_handle = bt_gatt_attr_value_handle(attr);
             slot->subscribe_params.notify = split_central_notify_func;
             slot->subscribe_params.value = BT_GATT_CCC_NOTIFY;
+            // With position deltas, this is only subscribed once discovery completes without
+            // finding the delta characteristic.
+#if !IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
             split_central_subscribe(conn, &slot->subscribe_params);
+#endif // !IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+        } else if (bt_uuid_cmp(chrc_uuid,
+                               BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_POSITION_DELTA_UUID)) == 0) {
+            LOG_DBG("Found position delta characteristic");
+            slot->delta_subscribe_params.disc_params = &slot->sub_discover_params;
+            slot->delta_subscribe_params.end_handle = slot->discover_params.end_handle;
+            slot->delta_subscribe_params.value_handle = bt_gatt_attr_value_handle(attr);
+            slot->delta_subscribe_params.notify = split_central_delta_notify_func;
+            slot->delta_subscribe_params.value = BT_GATT_CCC_NOTIFY;
+            split_central_subscribe(conn, &slot->delta_subscribe_params);
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
 #if ZMK_KEYMAP_HAS_SENSORS
         } else if (bt_uuid_cmp(chrc_uuid,
                                BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_SENSOR_STATE_UUID)) == 0) {
@@ -600,6 +992,16 @@ static uint8_t split_central_chrc_discovery_func(struct bt_conn *conn,
             slot->discover_params.uuid = NULL;
             slot->discover_params.start_handle = attr->handle + 2;
             slot->run_behavior_handle = bt_gatt_attr_value_handle(attr);
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+        } else if (!bt_uuid_cmp(chrc_uuid,
+                                BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_BEHAVIOR_LOCAL_IDS_UUID))) {
+            LOG_DBG("Found behavior local IDs characteristic");
+            read_peripheral_behavior_local_ids(conn, slot, bt_gatt_attr_value_handle(attr));
+        } else if (!bt_uuid_cmp(chrc_uuid,
+                                BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_RUN_BEHAVIOR_BY_ID_UUID))) {
+            LOG_DBG("Found run behavior by ID handle");
+            slot->run_behavior_by_id_handle = bt_gatt_attr_value_handle(attr);
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
         } else if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
                                 BT_UUID_DECLARE_128(ZMK_SPLIT_BT_SELECT_PHYS_LAYOUT_UUID))) {
             LOG_DBG("Found select physical layout handle");
@@ -611,6 +1013,12 @@ static uint8_t split_central_chrc_discovery_func(struct bt_conn *conn,
             LOG_DBG("Found update HID indicators handle");
             slot->update_hid_indicators = bt_gatt_attr_value_handle(attr);
 #endif // IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_HID_INDICATORS)
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+        } else if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
+                                BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_CLOCK_UUID))) {
+            LOG_DBG("Found clock handle");
+            slot->clock_handle = bt_gatt_attr_value_handle(attr);
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
 #if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_BATTERY_LEVEL_FETCHING)
         } else if (!bt_uuid_cmp(((struct bt_gatt_chrc *)attr->user_data)->uuid,
                                 BT_UUID_BAS_BATTERY_LEVEL)) {
@@ -682,10 +1090,21 @@ static uint8_t split_central_chrc_discovery_func(struct bt_conn *conn,
 #if ZMK_KEYMAP_HAS_SENSORS
     subscribed = subscribed && slot->sensor_subscribe_params.value_handle;
 #endif /* ZMK_KEYMAP_HAS_SENSORS */
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+    // Peripherals without behavior local IDs run discovery to the end.
+    subscribed = subscribed && slot->run_behavior_by_id_handle;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+    // Peripherals without deltas run discovery to the end, which then falls back to the bitmap.
+    subscribed = subscribed && slot->delta_subscribe_params.value_handle;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
 
 #if IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_HID_INDICATORS)
     subscribed = subscribed && slot->update_hid_indicators;
 #endif // IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_HID_INDICATORS)
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+    subscribed = subscribed && slot->clock_handle;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
 #if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_BATTERY_LEVEL_FETCHING)
     subscribed = subscribed && slot->batt_lvl_subscribe_params.value_handle;
 #endif /* IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_BATTERY_LEVEL_FETCHING) */
@@ -1035,6 +1454,21 @@ void split_central_split_run_callback(struct k_work *work) {
                     .source = payload_wrapper.cmd.data.invoke_behavior.event_source,
                     .state = payload_wrapper.cmd.data.invoke_behavior.state ? 1 : 0,
                 }};
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+            // Peripherals that didn't share a local ID for the behavior fall back to its name.
+            int by_id_err = run_peripheral_behavior_by_id(
+                &peripherals[payload_wrapper.source], &payload.data,
+                payload_wrapper.cmd.data.invoke_behavior.behavior_local_id);
+            if (by_id_err != -ENOTSUP && by_id_err != -ENOENT) {
+                if (by_id_err) {
+                    LOG_ERR("Failed to write the behavior by ID characteristic (err %d)",
+                            by_id_err);
+                }
+                break;
+            }
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+
             const size_t payload_dev_size = sizeof(payload.behavior_dev);
             if (strlcpy(payload.behavior_dev, payload_wrapper.cmd.data.invoke_behavior.behavior_dev,
                         payload_dev_size) >= payload_dev_size) {
@@ -1080,6 +1514,11 @@ void split_central_split_run_callback(struct k_work *work) {
             }
             break;
 #endif // IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_HID_INDICATORS)
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+        case ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SYNC_CLOCK:
+            read_peripheral_clock(&peripherals[payload_wrapper.source]);
+            break;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
         default:
             LOG_WRN("Unsupported wrapped central command type %d", payload_wrapper.cmd.type);
             return;
@@ -1161,6 +1600,9 @@ static int split_central_bt_send_command(uint8_t source,
     }
 
     switch (cmd.type) {
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+    case ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SYNC_CLOCK:
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
     case ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SET_HID_INDICATORS:
     case ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SET_PHYSICAL_LAYOUT:
     case ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_INVOKE_BEHAVIOR: {
@@ -47,7 +47,7 @@ static void split_svc_sensor_state_ccc(const struct bt_gatt_attr *attr, uint16_t
 }
 #endif /* ZMK_KEYMAP_HAS_SENSORS */
 
-#define POS_STATE_LEN 16
+#define POS_STATE_LEN ZMK_SPLIT_POS_STATE_LEN
 
 static uint8_t num_of_positions = ZMK_KEYMAP_LEN;
 static uint8_t position_state[POS_STATE_LEN];
@@ -64,6 +64,54 @@ static ssize_t split_svc_run_behavior(struct bt_conn *conn, const struct bt_gatt
                                       const void *buf, uint16_t len, uint16_t offset,
                                       uint8_t flags);
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+
+// Copies the part of src, which sits at *pos in the full value, that overlaps the range being read.
+static void behavior_local_ids_copy(void *buf, uint16_t len, uint16_t offset, size_t *written,
+                                    size_t *pos, const void *src, size_t src_len) {
+    if (*pos + src_len > offset && *written < len) {
+        size_t start = offset > *pos ? offset - *pos : 0;
+        size_t count = MIN(src_len - start, len - *written);
+
+        memcpy((uint8_t *)buf + *written, (const uint8_t *)src + start, count);
+        *written += count;
+    }
+
+    *pos += src_len;
+}
+
+static ssize_t split_svc_behavior_local_ids(struct bt_conn *conn, const struct bt_gatt_attr *attrs,
+                                            void *buf, uint16_t len, uint16_t offset) {
+    // The table is generated as it is read, so it never has to fit in memory at once.
+    size_t pos = 0;
+    size_t written = 0;
+
+    STRUCT_SECTION_FOREACH(zmk_behavior_local_id_map, item) {
+        if (!z_device_is_ready(item->device)) {
+            continue;
+        }
+
+        uint8_t id[sizeof(zmk_behavior_local_id_t)];
+        sys_put_le16(item->local_id, id);
+
+        behavior_local_ids_copy(buf, len, offset, &written, &pos, id, sizeof(id));
+        behavior_local_ids_copy(buf, len, offset, &written, &pos, item->device->name,
+                                strlen(item->device->name) + 1);
+    }
+
+    if (offset > pos) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    return written;
+}
+
+static ssize_t split_svc_run_behavior_by_id(struct bt_conn *conn, const struct bt_gatt_attr *attrs,
+                                            const void *buf, uint16_t len, uint16_t offset,
+                                            uint8_t flags);
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+
 static ssize_t split_svc_num_of_positions(struct bt_conn *conn, const struct bt_gatt_attr *attrs,
                                           void *buf, uint16_t len, uint16_t offset) {
     return bt_gatt_attr_read(conn, attrs, buf, len, offset, attrs->user_data, sizeof(uint8_t));
@@ -73,6 +121,31 @@ static void split_svc_pos_state_ccc(const struct bt_gatt_attr *attr, uint16_t va
     LOG_DBG("value %d", value);
 }
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+
+BUILD_ASSERT(POS_STATE_LEN * 8 <= ZMK_SPLIT_POSITION_DELTA_POSITION_MASK + 1,
+             "Position deltas can only address 128 positions");
+
+static bool position_delta_enabled;
+static bool position_delta_keyframe_needed;
+
+static void split_svc_pos_delta_ccc(const struct bt_gatt_attr *attr, uint16_t value) {
+    LOG_DBG("value %d", value);
+
+    position_delta_enabled = (value == BT_GATT_CCC_NOTIFY);
+    // A newly subscribed central starts from the full state.
+    position_delta_keyframe_needed = true;
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+
+static ssize_t split_svc_clock(struct bt_conn *conn, const struct bt_gatt_attr *attrs, void *buf,
+                               uint16_t len, uint16_t offset) {
+    uint32_t uptime = sys_cpu_to_le32(k_uptime_get_32());
+
+    return bt_gatt_attr_read(conn, attrs, buf, len, offset, &uptime, sizeof(uptime));
+}
+
 #if IS_ENABLED(CONFIG_ZMK_SPLIT_PERIPHERAL_HID_INDICATORS)
 
 static zmk_hid_indicators_t hid_indicators = 0;
@@ -203,20 +276,168 @@ BT_GATT_SERVICE_DEFINE(
                            BT_GATT_CHRC_WRITE | BT_GATT_CHRC_READ,
                            BT_GATT_PERM_WRITE_ENCRYPT | BT_GATT_PERM_READ_ENCRYPT,
                            split_svc_get_selected_phys_layout, split_svc_select_phys_layout,
-                           NULL), );
+                           NULL),
+    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_CLOCK_UUID), BT_GATT_CHRC_READ,
+                           BT_GATT_PERM_READ_ENCRYPT, split_svc_clock, NULL, NULL),
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_BEHAVIOR_LOCAL_IDS_UUID),
+                           BT_GATT_CHRC_READ, BT_GATT_PERM_READ_ENCRYPT,
+                           split_svc_behavior_local_ids, NULL, NULL),
+    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_RUN_BEHAVIOR_BY_ID_UUID),
+                           BT_GATT_CHRC_WRITE_WITHOUT_RESP, BT_GATT_PERM_WRITE_ENCRYPT, NULL,
+                           split_svc_run_behavior_by_id, NULL),
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+// Kept last, so the attribute indexes used for notifications above don't move.
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+    BT_GATT_CHARACTERISTIC(BT_UUID_DECLARE_128(ZMK_SPLIT_BT_CHAR_POSITION_DELTA_UUID),
+                           BT_GATT_CHRC_NOTIFY, BT_GATT_PERM_READ_ENCRYPT, NULL, NULL, NULL),
+    BT_GATT_CCC(split_svc_pos_delta_ccc, BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT),
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+);
 
 K_THREAD_STACK_DEFINE(service_q_stack, CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_STACK_SIZE);
 
 struct k_work_q service_work_q;
 
-K_MSGQ_DEFINE(position_state_msgq, sizeof(char[POS_STATE_LEN]),
+K_MSGQ_DEFINE(position_state_msgq, sizeof(struct zmk_split_position_state_payload),
               CONFIG_ZMK_SPLIT_BLE_PERIPHERAL_POSITION_QUEUE_SIZE, 4);
 
+// Changes from the same scan pass are merged into one pending notification, until a position
+// changes a second time, since the central only sees the resulting bitmap. The lock keeps the
+// pending notification and the queue ordered with respect to each other: while a replaced
+// pending notification is still being queued, the newer one isn't sent.
+static struct k_spinlock position_state_lock;
+static struct zmk_split_position_state_payload pending_position_state;
+static uint8_t pending_changes[POS_STATE_LEN];
+static bool position_state_pending;
+static uint8_t position_state_queueing;
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+
+// Only touched from the notification work queue.
+static uint8_t position_delta_sent_state[POS_STATE_LEN];
+static uint8_t position_delta_seq;
+static uint8_t position_delta_since_keyframe;
+
+#if defined(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTA_TEST_DROP_INTERVAL)
+
+// Lets bsim tests exercise the central's recovery from lost notifications: the dropped delta is
+// treated as sent, so the central sees a gap in the sequence numbers.
+static bool drop_position_delta(bool keyframe) {
+    const int interval = CONFIG_ZMK_SPLIT_BLE_POSITION_DELTA_TEST_DROP_INTERVAL;
+
+    if (interval > 0 && !keyframe && position_delta_seq % interval == interval - 1) {
+        LOG_DBG("Dropping position delta %d", position_delta_seq);
+        return true;
+    }
+
+    return false;
+}
+
+#else
+
+static inline bool drop_position_delta(bool keyframe) { return false; }
+
+#endif // defined(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTA_TEST_DROP_INTERVAL)
+
+static void notify_position_delta(const struct zmk_split_position_state_payload *state) {
+    if (!position_delta_enabled) {
+        return;
+    }
+
+    struct zmk_split_position_delta_payload payload = {
+        .seq = position_delta_seq,
+        .timestamp = state->timestamp,
+    };
+    size_t len = 0;
+
+    bool keyframe = position_delta_keyframe_needed ||
+                    position_delta_since_keyframe >=
+                        CONFIG_ZMK_SPLIT_BLE_POSITION_DELTA_KEYFRAME_INTERVAL;
+
+    for (int i = 0; i < POS_STATE_LEN && !keyframe; i++) {
+        uint8_t changed = state->state[i] ^ position_delta_sent_state[i];
+
+        while (changed) {
+            int bit = find_lsb_set(changed) - 1;
+            changed &= ~BIT(bit);
+
+            // Past this size the bitmap is smaller, so send a keyframe instead.
+            if (len == sizeof(payload.data)) {
+                keyframe = true;
+                break;
+            }
+
+            bool pressed = state->state[i] & BIT(bit);
+            payload.data[len++] = (i * 8 + bit) | (pressed ? ZMK_SPLIT_POSITION_DELTA_PRESSED : 0);
+        }
+    }
+
+    if (keyframe) {
+        payload.flags = ZMK_SPLIT_POSITION_DELTA_FLAG_KEYFRAME;
+        memcpy(payload.data, state->state, sizeof(payload.data));
+        len = sizeof(payload.data);
+    }
+
+    if (!drop_position_delta(keyframe)) {
+        size_t size = offsetof(struct zmk_split_position_delta_payload, data) + len;
+
+        // The delta characteristic's value attribute is the last but one, ahead of its CCC.
+        int err = bt_gatt_notify(NULL, &split_svc.attrs[split_svc.attr_count - 2], &payload, size);
+        if (err) {
+            // Nothing was sent, so the next delta is taken against the same state and covers
+            // this change as well.
+            LOG_DBG("Error notifying position delta %d", err);
+            return;
+        }
+
+        LOG_DBG("Sent position %s %d in %zu bytes", keyframe ? "keyframe" : "delta", payload.seq,
+                size);
+    }
+
+    memcpy(position_delta_sent_state, state->state, sizeof(position_delta_sent_state));
+    position_delta_seq++;
+
+    if (keyframe) {
+        position_delta_keyframe_needed = false;
+        position_delta_since_keyframe = 0;
+    } else {
+        position_delta_since_keyframe++;
+    }
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+
 void send_position_state_callback(struct k_work *work) {
-    uint8_t state[POS_STATE_LEN];
+    struct zmk_split_position_state_payload payload;
+
+    while (true) {
+        bool found = true;
+
+        k_spinlock_key_t key = k_spin_lock(&position_state_lock);
+        if (k_msgq_get(&position_state_msgq, &payload, K_NO_WAIT) < 0) {
+            found = position_state_pending && position_state_queueing == 0;
+            if (found) {
+                payload = pending_position_state;
+                position_state_pending = false;
+                memset(pending_changes, 0, sizeof(pending_changes));
+            }
+        }
+        k_spin_unlock(&position_state_lock, key);
+
+        if (!found) {
+            break;
+        }
 
-    while (k_msgq_get(&position_state_msgq, &state, K_NO_WAIT) == 0) {
-        int err = bt_gatt_notify(NULL, &split_svc.attrs[1], &state, sizeof(state));
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+        // A central taking deltas only reads the bitmap to resynchronize, so it isn't notified.
+        if (position_delta_enabled) {
+            notify_position_delta(&payload);
+            continue;
+        }
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_POSITION_DELTAS)
+
+        int err = bt_gatt_notify(NULL, &split_svc.attrs[1], &payload, sizeof(payload));
         if (err) {
             LOG_DBG("Error notifying %d", err);
         }
@@ -225,35 +446,66 @@ void send_position_state_callback(struct k_work *work) {
 
 K_WORK_DEFINE(service_position_notify_work, send_position_state_callback);
 
-int send_position_state() {
-    int err = k_msgq_put(&position_state_msgq, position_state, K_MSEC(100));
+static void queue_position_state(const struct zmk_split_position_state_payload *state) {
+    int err = k_msgq_put(&position_state_msgq, state, K_NO_WAIT);
+    if (err == -ENOMSG) {
+        LOG_WRN("Position state message queue full, popping first message and queueing again");
+        struct zmk_split_position_state_payload discarded_payload;
+        k_msgq_get(&position_state_msgq, &discarded_payload, K_NO_WAIT);
+        err = k_msgq_put(&position_state_msgq, state, K_NO_WAIT);
+    }
+
     if (err) {
-        switch (err) {
-        case -EAGAIN: {
-            LOG_WRN("Position state message queue full, popping first message and queueing again");
-            uint8_t discarded_state[POS_STATE_LEN];
-            k_msgq_get(&position_state_msgq, &discarded_state, K_NO_WAIT);
-            return send_position_state();
-        }
-        default:
-            LOG_WRN("Failed to queue position state to send (%d)", err);
-            return err;
-        }
+        LOG_WRN("Failed to queue position state to send (%d)", err);
     }
+}
 
-    k_work_submit_to_queue(&service_work_q, &service_position_notify_work);
+static int send_position_state(uint8_t position, bool pressed, uint16_t timestamp) {
+    if (position >= POS_STATE_LEN * 8) {
+        return -EINVAL;
+    }
 
-    return 0;
-}
+    struct zmk_split_position_state_payload replaced;
+    bool replace = false;
 
-static int zmk_split_bt_position_pressed(uint8_t position) {
-    WRITE_BIT(position_state[position / 8], position % 8, true);
-    return send_position_state();
-}
+    k_spinlock_key_t key = k_spin_lock(&position_state_lock);
+
+    if (position_state_pending &&
+        (pending_position_state.timestamp != sys_cpu_to_le16(timestamp) ||
+         (pending_changes[position / 8] & BIT(position % 8)))) {
+        replaced = pending_position_state;
+        replace = true;
+        position_state_queueing++;
+        position_state_pending = false;
+        memset(pending_changes, 0, sizeof(pending_changes));
+    }
+
+    bool batched = position_state_pending;
+
+    WRITE_BIT(position_state[position / 8], position % 8, pressed);
+    WRITE_BIT(pending_changes[position / 8], position % 8, true);
+
+    memcpy(pending_position_state.state, position_state, sizeof(pending_position_state.state));
+    pending_position_state.timestamp = sys_cpu_to_le16(timestamp);
+    position_state_pending = true;
 
-static int zmk_split_bt_position_released(uint8_t position) {
-    WRITE_BIT(position_state[position / 8], position % 8, false);
-    return send_position_state();
+    k_spin_unlock(&position_state_lock, key);
+
+    if (replace) {
+        queue_position_state(&replaced);
+
+        key = k_spin_lock(&position_state_lock);
+        position_state_queueing--;
+        k_spin_unlock(&position_state_lock, key);
+    }
+
+    if (batched) {
+        LOG_DBG("Batched position %d with the pending position state", position);
+    }
+
+    k_work_submit_to_queue(&service_work_q, &service_position_notify_work);
+
+    return 0;
 }
 
 #if ZMK_KEYMAP_HAS_SENSORS
@@ -295,13 +547,14 @@ int send_sensor_state(struct sensor_event ev) {
 
 static int zmk_split_bt_sensor_triggered(uint8_t sensor_index,
                                          const struct zmk_sensor_channel_data channel_data[],
-                                         size_t channel_data_size) {
+                                         size_t channel_data_size, uint16_t timestamp) {
     if (channel_data_size > ZMK_SENSOR_EVENT_MAX_CHANNELS) {
         return -EINVAL;
     }
 
-    struct sensor_event ev =
-        (struct sensor_event){.sensor_index = sensor_index, .channel_data_size = channel_data_size};
+    struct sensor_event ev = (struct sensor_event){.sensor_index = sensor_index,
+                                                   .channel_data_size = channel_data_size,
+                                                   .timestamp = sys_cpu_to_le16(timestamp)};
     memcpy(ev.channel_data, channel_data,
            channel_data_size * sizeof(struct zmk_sensor_channel_data));
     return send_sensor_state(ev);
@@ -346,16 +599,14 @@ SYS_INIT(service_init, APPLICATION, CONFIG_ZMK_BLE_INIT_PRIORITY);
 static int zmk_peripheral_ble_report_event(const struct zmk_split_transport_peripheral_event *ev) {
     switch (ev->type) {
     case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_KEY_POSITION_EVENT:
-        if (ev->data.key_position_event.pressed) {
-            zmk_split_bt_position_pressed(ev->data.key_position_event.position);
-        } else {
-            zmk_split_bt_position_released(ev->data.key_position_event.position);
-        }
-        break;
+        return send_position_state(ev->data.key_position_event.position,
+                                   ev->data.key_position_event.pressed,
+                                   ev->data.key_position_event.timestamp);
 #if ZMK_KEYMAP_HAS_SENSORS
     case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_SENSOR_EVENT:
         zmk_split_bt_sensor_triggered(ev->data.sensor_event.sensor_index,
-                                      &ev->data.sensor_event.channel_data, 1);
+                                      &ev->data.sensor_event.channel_data, 1,
+                                      ev->data.sensor_event.timestamp);
 
         break;
 #endif
@@ -415,6 +666,9 @@ static ssize_t split_svc_run_behavior(struct bt_conn *conn, const struct bt_gatt
                          .param2 = payload->data.param2,
                          .position = payload->data.position,
                          .state = payload->data.state,
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+                         .behavior_local_id = UINT16_MAX,
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
                      }}};
 
         const size_t payload_dev_size = sizeof(cmd.data.invoke_behavior.behavior_dev);
@@ -436,4 +690,43 @@ static ssize_t split_svc_run_behavior(struct bt_conn *conn, const struct bt_gatt
     }
 
     return len;
-}
\ No newline at end of file
+}
+
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+
+static ssize_t split_svc_run_behavior_by_id(struct bt_conn *conn, const struct bt_gatt_attr *attrs,
+                                            const void *buf, uint16_t len, uint16_t offset,
+                                            uint8_t flags) {
+    struct zmk_split_run_behavior_by_id_payload payload;
+
+    if (offset != 0 || len != sizeof(payload)) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    memcpy(&payload, buf, len);
+
+    struct zmk_split_transport_central_command cmd = {
+        .type = ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_INVOKE_BEHAVIOR,
+        .data = {.invoke_behavior = {
+                     .param1 = payload.data.param1,
+                     .param2 = payload.data.param2,
+                     .position = payload.data.position,
+                     .state = payload.data.state,
+                     .behavior_local_id = sys_le16_to_cpu(payload.behavior_local_id),
+                 }}};
+
+    LOG_DBG("Local ID %d with params %d %d: pressed? %d",
+            cmd.data.invoke_behavior.behavior_local_id, cmd.data.invoke_behavior.param1,
+            cmd.data.invoke_behavior.param2, cmd.data.invoke_behavior.state);
+
+    int err = zmk_split_transport_peripheral_command_handler(&bt_peripheral, cmd);
+
+    if (err) {
+        LOG_ERR("Failed to invoke behavior with local ID %d: %d",
+                cmd.data.invoke_behavior.behavior_local_id, err);
+    }
+
+    return len;
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
\ No newline at end of file
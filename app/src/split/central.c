@@ -12,6 +12,7 @@
 #include <zmk/hid_indicators_types.h>
 #include <zmk/pointing/input_split.h>
 
+#include <zephyr/init.h>
 #include <zephyr/logging/log.h>
 
 #include <zmk/event_manager.h>
@@ -31,6 +32,140 @@ static uint8_t peripheral_battery_levels[ZMK_SPLIT_CENTRAL_PERIPHERAL_COUNT] = {
 
 #endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_CENTRAL_BATTERY_LEVEL_FETCHING)
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+
+// Worst case relative drift between the two halves' clocks, e.g. two calibrated RC oscillators.
+#define CLOCK_DRIFT_PPM 1000
+
+struct peripheral_clock {
+    bool synced;
+    // Central uptime minus peripheral uptime, in ms
+    int64_t offset;
+    // Round trip time of the sync that produced the offset
+    uint32_t rtt;
+    int64_t synced_at;
+    // Central uptime the pending sync request was sent at, if any
+    int64_t request_time;
+    // Reconstructed times can't go backwards, or hold-taps and combos would see negative
+    // durations.
+    int64_t last_event_time;
+};
+
+static struct peripheral_clock peripheral_clocks[ZMK_SPLIT_CENTRAL_PERIPHERAL_COUNT];
+
+// A sync request that hasn't been answered by then is assumed lost.
+#define CLOCK_SYNC_REQUEST_TIMEOUT_MS 1000
+
+static void clock_sync_work_cb(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(clock_sync_work, clock_sync_work_cb);
+
+static uint32_t clock_uncertainty(const struct peripheral_clock *clock, int64_t now) {
+    return clock->rtt / 2 + (uint32_t)((now - clock->synced_at) * CLOCK_DRIFT_PPM / 1000000);
+}
+
+static void handle_clock_sync(uint8_t source, uint32_t peripheral_uptime) {
+    struct peripheral_clock *clock = &peripheral_clocks[source];
+    int64_t now = k_uptime_get();
+
+    if (clock->request_time == 0) {
+        LOG_DBG("Ignoring unsolicited clock sync from peripheral %d", source);
+        return;
+    }
+
+    uint32_t rtt = now - clock->request_time;
+    int64_t offset = (now + clock->request_time) / 2 - peripheral_uptime;
+    clock->request_time = 0;
+
+    // Keep the previous sample while it is still the more precise of the two, unless the two
+    // disagree, which means the peripheral restarted and its old offset is meaningless.
+    if (clock->synced) {
+        uint32_t current = clock_uncertainty(clock, now);
+        bool consistent = ABS(offset - clock->offset) <= current + rtt / 2;
+
+        if (consistent && rtt / 2 > current) {
+            return;
+        }
+    }
+
+    LOG_DBG("Peripheral %d clock offset %lld (rtt %d)", source, offset, rtt);
+
+    clock->synced = true;
+    clock->offset = offset;
+    clock->rtt = rtt;
+    clock->synced_at = now;
+}
+
+static int64_t peripheral_event_time(uint8_t source, uint16_t timestamp) {
+    struct peripheral_clock *clock = &peripheral_clocks[source];
+    int64_t now = k_uptime_get();
+    int16_t age = 0;
+
+    if (timestamp != ZMK_SPLIT_TRANSPORT_TIMESTAMP_NONE && clock->synced) {
+        age = (int16_t)((uint16_t)(now - clock->offset) - timestamp);
+
+        if (age > CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC_MAX_EVENT_AGE_MS) {
+            LOG_DBG("Peripheral %d event is %dms old, resyncing", source, age);
+            k_work_reschedule(&clock_sync_work, K_NO_WAIT);
+            age = 0;
+        }
+    }
+
+    clock->last_event_time = MAX(now - MAX(age, 0), clock->last_event_time);
+
+    return clock->last_event_time;
+}
+
+static void clock_sync_work_cb(struct k_work *work) {
+    if (!active_transport || !active_transport->api ||
+        !active_transport->api->get_available_source_ids || !active_transport->api->send_command) {
+        return;
+    }
+
+    uint8_t source_ids[ZMK_SPLIT_CENTRAL_PERIPHERAL_COUNT];
+    int count = active_transport->api->get_available_source_ids(source_ids);
+    bool all_synced = true;
+
+    for (int i = 0; i < count; i++) {
+        struct peripheral_clock *clock = &peripheral_clocks[source_ids[i]];
+        int64_t now = k_uptime_get();
+
+        all_synced = all_synced && clock->synced;
+
+        // Re-requesting while a request is outstanding would pair its answer with the wrong
+        // request time and understate the round trip.
+        if (clock->request_time != 0 && now - clock->request_time < CLOCK_SYNC_REQUEST_TIMEOUT_MS) {
+            continue;
+        }
+
+        clock->request_time = now;
+        int ret = active_transport->api->send_command(
+            source_ids[i], (struct zmk_split_transport_central_command){
+                               .type = ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SYNC_CLOCK,
+                           });
+        if (ret < 0) {
+            LOG_DBG("Failed to request clock sync from peripheral %d (%d)", source_ids[i], ret);
+            clock->request_time = 0;
+        }
+    }
+
+    // Retry quickly until every connected peripheral has answered at least once.
+    if (all_synced && count > 0) {
+        k_work_schedule(&clock_sync_work,
+                        K_SECONDS(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC_INTERVAL_SEC));
+    } else {
+        k_work_schedule(&clock_sync_work, K_SECONDS(1));
+    }
+}
+
+#else
+
+static inline int64_t peripheral_event_time(uint8_t source, uint16_t timestamp) {
+    return k_uptime_get();
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+
 int zmk_split_transport_central_peripheral_event_handler(
     const struct zmk_split_transport_central *transport, uint8_t source,
     struct zmk_split_transport_peripheral_event ev) {
@@ -45,7 +180,9 @@ int zmk_split_transport_central_peripheral_event_handler(
                                                       .position =
                                                           ev.data.key_position_event.position,
                                                       .state = ev.data.key_position_event.pressed,
-                                                      .timestamp = k_uptime_get()};
+                                                      .timestamp = peripheral_event_time(
+                                                          source,
+                                                          ev.data.key_position_event.timestamp)};
         return raise_zmk_position_state_changed(state_ev);
     }
 #if IS_ENABLED(CONFIG_ZMK_INPUT_SPLIT)
@@ -68,12 +205,18 @@ int zmk_split_transport_central_peripheral_event_handler(
     case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_SENSOR_EVENT: {
         struct zmk_sensor_event sensor_ev = {.sensor_index = ev.data.sensor_event.sensor_index,
                                              .channel_data_size = 1,
-                                             .timestamp = k_uptime_get()};
+                                             .timestamp = peripheral_event_time(
+                                                 source, ev.data.sensor_event.timestamp)};
 
         sensor_ev.channel_data[0] = ev.data.sensor_event.channel_data;
 
         return raise_zmk_sensor_event(sensor_ev);
     }
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_CLOCK_SYNC_EVENT:
+        handle_clock_sync(source, ev.data.clock_sync_event.uptime);
+        return 0;
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
     default:
         LOG_WRN("GOT AN UNKNOWN EVENT TYPE %d", ev.type);
         return -ENOTSUP;
@@ -102,6 +245,11 @@ int zmk_split_central_invoke_behavior(uint8_t source, struct zmk_behavior_bindin
                 },
         };
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+    command.data.invoke_behavior.behavior_local_id =
+        zmk_behavior_get_local_id(binding->behavior_dev);
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+
     const size_t payload_dev_size = sizeof(command.data.invoke_behavior.behavior_dev);
     if (strlcpy(command.data.invoke_behavior.behavior_dev, binding->behavior_dev,
                 payload_dev_size) >= payload_dev_size) {
@@ -168,6 +316,10 @@ int zmk_split_central_get_peripheral_battery_level(uint8_t source, uint8_t *leve
 static int central_init(void) {
     STRUCT_SECTION_GET(zmk_split_transport_central, 0, &active_transport);
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+    k_work_schedule(&clock_sync_work, K_SECONDS(1));
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_CENTRAL_CLOCK_SYNC)
+
     return 0;
 }
 
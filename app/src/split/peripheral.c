@@ -8,6 +8,7 @@
 
 #include <zmk/stdlib.h>
 #include <zmk/split/transport/peripheral.h>
+#include <zmk/split/peripheral.h>
 
 #include <drivers/behavior.h>
 #include <zmk/behavior.h>
@@ -38,6 +39,18 @@ int zmk_split_transport_peripheral_command_handler(
             .param2 = cmd.data.invoke_behavior.param2,
             .behavior_dev = cmd.data.invoke_behavior.behavior_dev,
         };
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
+        if (binding.behavior_dev[0] == '\0') {
+            // Commands that name the behavior by local ID resolve to the device's own name, which
+            // the behavior lookup matches by pointer instead of comparing strings.
+            binding.behavior_dev = zmk_behavior_find_behavior_name_from_local_id(
+                cmd.data.invoke_behavior.behavior_local_id);
+            if (!binding.behavior_dev) {
+                LOG_ERR("No behavior with local ID %d", cmd.data.invoke_behavior.behavior_local_id);
+                return -ENODEV;
+            }
+        }
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_BLE_BEHAVIOR_LOCAL_IDS)
         LOG_DBG("%s with params %d %d: pressed? %d", binding.behavior_dev, binding.param1,
                 binding.param2, cmd.data.invoke_behavior.state);
         struct zmk_behavior_binding_event event = {.position = cmd.data.invoke_behavior.position,
@@ -52,6 +65,16 @@ int zmk_split_transport_peripheral_command_handler(
         if (err) {
             LOG_ERR("Failed to invoke behavior %s: %d", binding.behavior_dev, err);
         }
+        break;
+    }
+    case ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SYNC_CLOCK: {
+        struct zmk_split_transport_peripheral_event ev = {
+            .type = ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_CLOCK_SYNC_EVENT,
+            .data = {.clock_sync_event = {
+                         .uptime = k_uptime_get_32(),
+                     }}};
+
+        return zmk_split_peripheral_report_event(&ev);
     }
     default:
         LOG_WRN("Unhandled command type %d", cmd.type);
@@ -86,6 +109,7 @@ int split_peripheral_listener(const zmk_event_t *eh) {
             .data = {.key_position_event = {
                          .position = pos_ev->position,
                          .pressed = pos_ev->state,
+                         .timestamp = zmk_split_transport_timestamp(pos_ev->timestamp),
                      }}};
 
         zmk_split_peripheral_report_event(&ev);
@@ -103,6 +127,7 @@ int split_peripheral_listener(const zmk_event_t *eh) {
             .data = {.sensor_event = {
                          .channel_data = sensor_ev->channel_data[0],
                          .sensor_index = sensor_ev->sensor_index,
+                         .timestamp = zmk_split_transport_timestamp(sensor_ev->timestamp),
                      }}};
 
         zmk_split_peripheral_report_event(&ev);
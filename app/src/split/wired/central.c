@@ -37,8 +37,9 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
     (DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT) && DT_INST_PROP_OR(0, half_duplex, false))
 
 #define RX_BUFFER_SIZE                                                                             \
-    ((sizeof(struct event_envelope) + sizeof(struct msg_postfix)) *                                \
-     CONFIG_ZMK_SPLIT_WIRED_EVENT_BUFFER_ITEMS)
+    MAX((sizeof(struct event_envelope) + sizeof(struct msg_postfix)) *                             \
+            CONFIG_ZMK_SPLIT_WIRED_EVENT_BUFFER_ITEMS,                                             \
+        sizeof(struct event_batch_envelope) + sizeof(struct msg_postfix))
 #define TX_BUFFER_SIZE                                                                             \
     ((sizeof(struct command_envelope) + sizeof(struct msg_postfix)) *                              \
      CONFIG_ZMK_SPLIT_WIRED_CMD_BUFFER_ITEMS)
@@ -124,6 +125,7 @@ static void begin_tx(void) {
 static ssize_t get_payload_data_size(const struct zmk_split_transport_central_command *cmd) {
     switch (cmd->type) {
     case ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_POLL_EVENTS:
+    case ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_SYNC_CLOCK:
         return 0;
     case ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_INVOKE_BEHAVIOR:
         return sizeof(cmd->data.invoke_behavior);
@@ -152,27 +154,14 @@ static int split_central_wired_send_command(uint8_t source,
     size_t payload_size =
         data_size + sizeof(source) + sizeof(enum zmk_split_transport_central_command_type);
 
-    if (ring_buf_space_get(&tx_buf) < MSG_EXTRA_SIZE + payload_size) {
+    struct command_envelope env = {.payload = {.source = source, .cmd = cmd}};
+
+    int err = zmk_split_wired_put_item(&tx_buf, (uint8_t *)&env, payload_size);
+    if (err < 0) {
         LOG_WRN("No room to send command to the peripheral %d", source);
-        return -ENOSPC;
+        return err;
     }
 
-    struct command_envelope env = {.prefix =
-                                       {
-                                           .magic_prefix = ZMK_SPLIT_WIRED_ENVELOPE_MAGIC_PREFIX,
-                                           .payload_size = payload_size,
-                                       },
-                                   .payload = {
-                                       .source = source,
-                                       .cmd = cmd,
-                                   }};
-
-    struct msg_postfix postfix = {.crc =
-                                      crc32_ieee((void *)&env, sizeof(env.prefix) + payload_size)};
-
-    ring_buf_put(&tx_buf, (uint8_t *)&env, sizeof(env.prefix) + payload_size);
-    ring_buf_put(&tx_buf, (uint8_t *)&postfix, sizeof(postfix));
-
     if (can_tx() >= 0) {
         begin_tx();
     }
@@ -316,6 +305,39 @@ static const struct zmk_split_transport_central_api central_api = {
 
 ZMK_SPLIT_TRANSPORT_CENTRAL_REGISTER(wired_central, &central_api);
 
+static void publish_event_batch(const struct event_batch_envelope *env) {
+    if (env->prefix.payload_size < sizeof(env->payload.source)) {
+        LOG_WRN("Peripheral event batch is missing its source");
+        return;
+    }
+
+    size_t events_len = env->prefix.payload_size - sizeof(env->payload.source);
+    size_t offset = 0;
+
+    while (offset < events_len) {
+        struct zmk_split_transport_peripheral_event ev = {0};
+
+        if (events_len - offset < sizeof(ev.type)) {
+            LOG_WRN("Truncated event in peripheral event batch");
+            return;
+        }
+
+        memcpy(&ev.type, env->payload.events + offset, sizeof(ev.type));
+
+        ssize_t data_size = zmk_split_wired_event_data_size(ev.type);
+        if (data_size < 0 || events_len - offset < sizeof(ev.type) + data_size) {
+            LOG_WRN("Invalid event of type %d in peripheral event batch", ev.type);
+            return;
+        }
+
+        memcpy(&ev, env->payload.events + offset, sizeof(ev.type) + data_size);
+        offset += sizeof(ev.type) + data_size;
+
+        zmk_split_transport_central_peripheral_event_handler(&wired_central, env->payload.source,
+                                                             ev);
+    }
+}
+
 static void publish_events_work(struct k_work *work) {
 
 #if IS_HALF_DUPLEX_MODE
@@ -323,14 +345,13 @@ static void publish_events_work(struct k_work *work) {
                       K_MSEC(CONFIG_ZMK_SPLIT_WIRED_HALF_DUPLEX_RX_COMPLETE_TIMEOUT));
 #endif // IS_HALF_DUPLEX_MODE
 
-    while (ring_buf_size_get(&rx_buf) > MSG_EXTRA_SIZE) {
-        struct event_envelope env;
-        int item_err =
-            zmk_split_wired_get_item(&rx_buf, (uint8_t *)&env, sizeof(struct event_envelope));
+    while (ring_buf_size_get(&rx_buf) > 0) {
+        struct event_batch_envelope env;
+        int item_err = zmk_split_wired_get_item(&rx_buf, (uint8_t *)&env,
+                                                sizeof(struct event_batch_envelope));
         switch (item_err) {
         case 0:
-            zmk_split_transport_central_peripheral_event_handler(&wired_central, env.payload.source,
-                                                                 env.payload.event);
+            publish_event_batch(&env);
             break;
         case -EAGAIN:
             return;
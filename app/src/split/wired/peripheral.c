@@ -9,6 +9,7 @@
 
 #include <zephyr/settings/settings.h>
 #include <zephyr/sys/crc.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/sys/ring_buffer.h>
 
 #include <zephyr/logging/log.h>
@@ -38,8 +39,9 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
     (DT_HAS_COMPAT_STATUS_OKAY(DT_DRV_COMPAT) && DT_INST_PROP_OR(0, half_duplex, false))
 
 #define TX_BUFFER_SIZE                                                                             \
-    ((sizeof(struct event_envelope) + sizeof(struct msg_postfix)) *                                \
-     CONFIG_ZMK_SPLIT_WIRED_EVENT_BUFFER_ITEMS)
+    MAX((sizeof(struct event_envelope) + sizeof(struct msg_postfix)) *                             \
+            CONFIG_ZMK_SPLIT_WIRED_EVENT_BUFFER_ITEMS,                                             \
+        sizeof(struct event_batch_envelope) + sizeof(struct msg_postfix))
 #define RX_BUFFER_SIZE                                                                             \
     ((sizeof(struct command_envelope) + sizeof(struct msg_postfix)) *                              \
      CONFIG_ZMK_SPLIT_WIRED_CMD_BUFFER_ITEMS)
@@ -195,67 +197,122 @@ static void begin_tx(void) {
 #endif
 }
 
-static ssize_t get_payload_data_size(const struct zmk_split_transport_peripheral_event *evt) {
-    switch (evt->type) {
-    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_INPUT_EVENT:
-        return sizeof(evt->data.input_event);
-    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_KEY_POSITION_EVENT:
-        return sizeof(evt->data.key_position_event);
-    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_SENSOR_EVENT:
-        return sizeof(evt->data.sensor_event);
-    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_BATTERY_EVENT:
-        return sizeof(evt->data.battery_event);
-    default:
-        return -ENOTSUP;
+// Events are collected into a single frame, which is sent once the work item that reported them
+// is done, e.g. after every change from a kscan pass has been reported. The lock only covers
+// adding to and taking the batch; encoding and logging happen outside it.
+static struct k_spinlock batch_lock;
+static struct event_batch_envelope batch;
+static size_t batch_len;
+
+// Owned by whichever caller holds batch_flushing. A frame is kept here if the TX ring has no room
+// for it, so it goes out ahead of any later batch once the ring has drained.
+static atomic_t batch_flushing;
+static struct event_batch_envelope tx_frame;
+static size_t tx_frame_len;
+
+static int send_tx_frame(void) {
+    size_t payload_size = sizeof(tx_frame.payload.source) + tx_frame_len;
+
+    tx_frame.payload.source = peripheral_id;
+
+    LOG_HEXDUMP_DBG(&tx_frame.payload, payload_size, "Payload");
+
+    int err = zmk_split_wired_put_item(&chosen_tx_buf, (uint8_t *)&tx_frame, payload_size);
+    if (err < 0) {
+        LOG_WRN("No room to send peripheral events to the central (%d bytes of space)",
+                ring_buf_space_get(&chosen_tx_buf));
+        return err;
+    }
+
+    tx_frame_len = 0;
+    return 0;
+}
+
+static bool take_batch(void) {
+    k_spinlock_key_t key = k_spin_lock(&batch_lock);
+    memcpy(tx_frame.payload.events, batch.payload.events, batch_len);
+    tx_frame_len = batch_len;
+    batch_len = 0;
+    k_spin_unlock(&batch_lock, key);
+
+    return tx_frame_len > 0;
+}
+
+static bool batch_pending(void) {
+    k_spinlock_key_t key = k_spin_lock(&batch_lock);
+    bool pending = batch_len > 0;
+    k_spin_unlock(&batch_lock, key);
+
+    return pending;
+}
+
+static int flush_batch(void) {
+    int err = 0;
+
+    do {
+        if (!atomic_cas(&batch_flushing, 0, 1)) {
+            // The flush in progress re-checks the batch before it finishes.
+            return 0;
+        }
+
+        while (err == 0 && (tx_frame_len > 0 || take_batch())) {
+            err = send_tx_frame();
+        }
+
+        atomic_clear(&batch_flushing);
+    } while (err == 0 && batch_pending());
+
+    return err;
+}
+
+static void flush_batch_work_cb(struct k_work *work);
+
+static K_WORK_DEFINE(flush_batch_work, flush_batch_work_cb);
+
+static void flush_batch_work_cb(struct k_work *work) {
+    int err = flush_batch();
+
+#if !IS_HALF_DUPLEX_MODE
+    begin_tx();
+
+    // Try again once the frames ahead of this batch have been sent.
+    if (err == -ENOSPC) {
+        k_work_submit(&flush_batch_work);
     }
+#else
+    // Half-duplex peripherals flush again on the central's next poll.
+    ARG_UNUSED(err);
+#endif
 }
 
 static int
 split_peripheral_wired_report_event(const struct zmk_split_transport_peripheral_event *event) {
-    ssize_t data_size = get_payload_data_size(event);
+    ssize_t data_size = zmk_split_wired_event_data_size(event->type);
     if (data_size < 0) {
         LOG_WRN("Failed to determine payload data size %d", data_size);
         return data_size;
     }
 
-    // Data + type + source
-    size_t payload_size =
-        data_size + sizeof(peripheral_id) + sizeof(enum zmk_split_transport_peripheral_event_type);
+    size_t event_size = sizeof(event->type) + data_size;
 
-    if (ring_buf_space_get(&chosen_tx_buf) < MSG_EXTRA_SIZE + payload_size) {
-        LOG_WRN("No room to send peripheral to the central (have %d but only space for %d)",
-                MSG_EXTRA_SIZE + payload_size, ring_buf_space_get(&chosen_tx_buf));
-        return -ENOSPC;
-    }
+    k_spinlock_key_t key = k_spin_lock(&batch_lock);
+    if (batch_len + event_size > sizeof(batch.payload.events)) {
+        k_spin_unlock(&batch_lock, key);
+        int err = flush_batch();
+        key = k_spin_lock(&batch_lock);
 
-    struct event_envelope env = {.prefix =
-                                     {
-                                         .magic_prefix = ZMK_SPLIT_WIRED_ENVELOPE_MAGIC_PREFIX,
-                                         .payload_size = payload_size,
-                                     },
-                                 .payload = {
-                                     .source = peripheral_id,
-                                     .event = *event,
-                                 }};
-
-    struct msg_postfix postfix = {.crc =
-                                      crc32_ieee((void *)&env, sizeof(env.prefix) + payload_size)};
-
-    LOG_HEXDUMP_DBG(&env, sizeof(env.prefix) + payload_size, "Payload");
-
-    size_t put = ring_buf_put(&chosen_tx_buf, (uint8_t *)&env, sizeof(env.prefix) + payload_size);
-    if (put != sizeof(env.prefix) + payload_size) {
-        LOG_WRN("Failed to put the whole message (%d vs %d)", put,
-                sizeof(env.prefix) + payload_size);
-    }
-    put = ring_buf_put(&chosen_tx_buf, (uint8_t *)&postfix, sizeof(postfix));
-    if (put != sizeof(postfix)) {
-        LOG_WRN("Failed to put the whole message (%d vs %d)", put, sizeof(postfix));
+        if (batch_len + event_size > sizeof(batch.payload.events)) {
+            k_spin_unlock(&batch_lock, key);
+            k_work_submit(&flush_batch_work);
+            return err < 0 ? err : -ENOSPC;
+        }
     }
 
-#if !IS_HALF_DUPLEX_MODE
-    begin_tx();
-#endif
+    memcpy(batch.payload.events + batch_len, event, event_size);
+    batch_len += event_size;
+    k_spin_unlock(&batch_lock, key);
+
+    k_work_submit(&flush_batch_work);
 
     return 0;
 }
@@ -267,13 +324,15 @@ static const struct zmk_split_transport_peripheral_api peripheral_api = {
 ZMK_SPLIT_TRANSPORT_PERIPHERAL_REGISTER(wired_peripheral, &peripheral_api);
 
 static void process_tx_cb(void) {
-    while (ring_buf_size_get(&chosen_rx_buf) > MSG_EXTRA_SIZE) {
+    while (ring_buf_size_get(&chosen_rx_buf) > 0) {
         struct command_envelope env;
         int item_err = zmk_split_wired_get_item(&chosen_rx_buf, (uint8_t *)&env,
                                                 sizeof(struct command_envelope));
         switch (item_err) {
         case 0:
             if (env.payload.cmd.type == ZMK_SPLIT_TRANSPORT_CENTRAL_CMD_TYPE_POLL_EVENTS) {
+                flush_batch();
+
                 begin_tx();
             } else {
                 int ret = k_msgq_put(&cmd_msg_queue, &env.payload.cmd, K_NO_WAIT);
@@ -6,11 +6,14 @@
 
 #include "wired.h"
 
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/crc.h>
 #include <zephyr/drivers/uart.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/logging/log.h>
 
+#include <zmk/cobs.h>
+
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #if IS_ENABLED(CONFIG_ZMK_SPLIT_WIRED_UART_MODE_POLLING)
@@ -261,6 +264,91 @@ int zmk_split_wired_async_init(struct zmk_split_wired_async_state *state) {
 
 #endif
 
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_WIRED_FRAMING_COBS)
+
+// Frames are the payload followed by its CRC16, COBS encoded so the only zero byte is the delimiter
+// that ends them. A receiver that loses its place only needs to find the next zero to resync.
+
+int zmk_split_wired_put_item(struct ring_buf *tx_buf, uint8_t *env, size_t payload_size) {
+    const uint8_t *payload = env + sizeof(struct msg_prefix);
+    uint8_t crc[sizeof(uint16_t)];
+    sys_put_le16(crc16_ccitt(0, payload, payload_size), crc);
+
+    return zmk_cobs_put(tx_buf, payload, payload_size, crc, sizeof(crc));
+}
+
+int zmk_split_wired_get_item(struct ring_buf *rx_buf, uint8_t *env, size_t env_size) {
+    size_t frame_len;
+
+    while (zmk_cobs_find_frame(rx_buf, &frame_len) == 0) {
+        if (frame_len == 0) {
+            ring_buf_get(rx_buf, NULL, 1);
+            continue;
+        }
+
+        if (frame_len > env_size) {
+            LOG_WRN("Discarding frame of %d bytes, bigger than expected max %d", frame_len,
+                    env_size);
+            ring_buf_get(rx_buf, NULL, frame_len + 1);
+            continue;
+        }
+
+        ring_buf_get(rx_buf, env, frame_len);
+        ring_buf_get(rx_buf, NULL, 1);
+
+        int decoded = zmk_cobs_decode(env, frame_len);
+        if (decoded < (int)sizeof(uint16_t) ||
+            decoded - sizeof(uint16_t) + sizeof(struct msg_prefix) > env_size) {
+            LOG_WRN("Discarding malformed frame of %d bytes", frame_len);
+            continue;
+        }
+
+        size_t payload_size = decoded - sizeof(uint16_t);
+        if (crc16_ccitt(0, env, payload_size) != sys_get_le16(env + payload_size)) {
+            LOG_WRN("Data corruption in received frame, ignoring");
+            continue;
+        }
+
+        memmove(env + sizeof(struct msg_prefix), env, payload_size);
+
+        struct msg_prefix *prefix = (struct msg_prefix *)env;
+        memcpy(prefix->magic_prefix, ZMK_SPLIT_WIRED_ENVELOPE_MAGIC_PREFIX,
+               sizeof(prefix->magic_prefix));
+        prefix->payload_size = payload_size;
+
+        return 0;
+    }
+
+    if (ring_buf_space_get(rx_buf) == 0) {
+        LOG_WRN("RX buffer full without a frame delimiter, discarding it");
+        ring_buf_get(rx_buf, NULL, ring_buf_size_get(rx_buf));
+    }
+
+    return -EAGAIN;
+}
+
+#else
+
+int zmk_split_wired_put_item(struct ring_buf *tx_buf, uint8_t *env, size_t payload_size) {
+    struct msg_prefix *prefix = (struct msg_prefix *)env;
+    memcpy(prefix->magic_prefix, ZMK_SPLIT_WIRED_ENVELOPE_MAGIC_PREFIX,
+           sizeof(prefix->magic_prefix));
+    prefix->payload_size = payload_size;
+
+    const size_t len = sizeof(*prefix) + payload_size;
+
+    if (ring_buf_space_get(tx_buf) < len + sizeof(struct msg_postfix)) {
+        return -ENOSPC;
+    }
+
+    struct msg_postfix postfix = {.crc = crc32_ieee(env, len)};
+
+    ring_buf_put(tx_buf, env, len);
+    ring_buf_put(tx_buf, (uint8_t *)&postfix, sizeof(postfix));
+
+    return 0;
+}
+
 int zmk_split_wired_get_item(struct ring_buf *rx_buf, uint8_t *env, size_t env_size) {
     while (ring_buf_size_get(rx_buf) > sizeof(struct msg_prefix) + sizeof(struct msg_postfix)) {
         struct msg_prefix prefix;
@@ -315,4 +403,25 @@ int zmk_split_wired_get_item(struct ring_buf *rx_buf, uint8_t *env, size_t env_s
     }
 
     return -EAGAIN;
-}
\ No newline at end of file
+}
+
+#endif // IS_ENABLED(CONFIG_ZMK_SPLIT_WIRED_FRAMING_COBS)
+
+ssize_t zmk_split_wired_event_data_size(enum zmk_split_transport_peripheral_event_type type) {
+    struct zmk_split_transport_peripheral_event *evt;
+
+    switch (type) {
+    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_INPUT_EVENT:
+        return sizeof(evt->data.input_event);
+    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_KEY_POSITION_EVENT:
+        return sizeof(evt->data.key_position_event);
+    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_SENSOR_EVENT:
+        return sizeof(evt->data.sensor_event);
+    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_BATTERY_EVENT:
+        return sizeof(evt->data.battery_event);
+    case ZMK_SPLIT_TRANSPORT_PERIPHERAL_EVENT_TYPE_CLOCK_SYNC_EVENT:
+        return sizeof(evt->data.clock_sync_event);
+    default:
+        return -ENOTSUP;
+    }
+}
@@ -38,6 +38,23 @@ struct event_envelope {
     struct event_payload payload;
 } __packed;
 
+// Peripheral event frames carry one or more events back to back, each only as long as its type
+// needs, so all the events from one scan pass share a single prefix and CRC. A frame with one event
+// is laid out exactly like an event_envelope.
+struct event_batch_payload {
+    uint8_t source;
+    uint8_t events[CONFIG_ZMK_SPLIT_WIRED_EVENT_BATCH_SIZE *
+                   sizeof(struct zmk_split_transport_peripheral_event)];
+} __packed;
+
+struct event_batch_envelope {
+    struct msg_prefix prefix;
+    struct event_batch_payload payload;
+} __packed;
+
+BUILD_ASSERT(sizeof(struct event_batch_payload) <= UINT8_MAX,
+             "Peripheral event batch too large for the wired envelope payload size");
+
 struct msg_postfix {
     uint32_t crc;
 } __packed;
@@ -91,4 +108,11 @@ int zmk_split_wired_async_init(struct zmk_split_wired_async_state *state);
 
 #endif
 
-int zmk_split_wired_get_item(struct ring_buf *rx_buf, uint8_t *env, size_t env_size);
\ No newline at end of file
+// Frames the payload that follows the msg_prefix at the start of env, and queues it on tx_buf.
+// The prefix is filled in as needed.
+int zmk_split_wired_put_item(struct ring_buf *tx_buf, uint8_t *env, size_t payload_size);
+
+// Reads the next valid frame from rx_buf into env, laid out as a msg_prefix and its payload.
+int zmk_split_wired_get_item(struct ring_buf *rx_buf, uint8_t *env, size_t env_size);
+
+ssize_t zmk_split_wired_event_data_size(enum zmk_split_transport_peripheral_event_type type);
\ No newline at end of file
@@ -136,6 +136,7 @@ static void notif_rpc_tx_cb(struct k_work *work) {
     if (!conn) {
         LOG_WRN("No active connection for queued data, dropping");
         ring_buf_reset(tx_buf);
+        zmk_rpc_tx_space_notify();
         return;
     }
 
@@ -154,6 +155,8 @@ static void notif_rpc_tx_cb(struct k_work *work) {
             ring_buf_get_finish(tx_buf, len);
         }
 
+        zmk_rpc_tx_space_notify();
+
         rpc_indicate_params.data = notify_bytes;
         rpc_indicate_params.len = added;
 
@@ -185,7 +188,8 @@ static void gatt_tx_notify(struct ring_buf *tx_buf, size_t added, bool msg_done,
 
     atomic_t ns = atomic_get(&notify_size);
 
-    if (msg_done || state->pending_notify > ns) {
+    // A full buffer is sent right away, since the writer waits for space before adding more.
+    if (msg_done || state->pending_notify > ns || ring_buf_space_get(tx_buf) == 0) {
         k_work_submit(&notify_tx_work);
         state->pending_notify = 0;
     }
@@ -23,7 +23,80 @@ ZMK_RPC_SUBSYSTEM(keymap)
 #define KEYMAP_RESPONSE(type, ...) ZMK_RPC_RESPONSE(keymap, type, __VA_ARGS__)
 #define KEYMAP_NOTIFICATION(type, ...) ZMK_RPC_NOTIFICATION(keymap, type, __VA_ARGS__)
 
-static bool encode_layer_bindings(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
+typedef bool (*field_encoder_t)(pb_ostream_t *stream, const pb_field_t *field, void *const *arg);
+
+// Nanopb sizes each submessage before writing it, and the layer and layout lists sit several
+// submessages deep in a response, so their callbacks get invoked once for every enclosing message.
+// When only sizing, reuse the size found on the first invocation instead of encoding it all again.
+// A cached size of zero is treated as not yet computed.
+static bool encode_with_cached_size(pb_ostream_t *stream, const pb_field_t *field, void *const *arg,
+                                    field_encoder_t encoder, size_t *cached_size) {
+    if (stream->callback) {
+        return encoder(stream, field, arg);
+    }
+
+    if (*cached_size == 0) {
+        pb_ostream_t sizing_stream = PB_OSTREAM_SIZING;
+
+        if (!encoder(&sizing_stream, field, arg)) {
+            return false;
+        }
+
+        *cached_size = sizing_stream.bytes_written;
+    }
+
+    return pb_write(stream, NULL, *cached_size);
+}
+
+// The layers can change with any request, so these are refreshed each time a response with layers
+// is built.
+static struct {
+    size_t layers;
+    size_t layer_bindings[ZMK_KEYMAP_LAYERS_LEN];
+} keymap_encoded_sizes;
+
+static void reset_keymap_encoded_sizes(void) {
+    memset(&keymap_encoded_sizes, 0, sizeof(keymap_encoded_sizes));
+}
+
+#if IS_ENABLED(CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL)
+
+// With the change journal, sizes are kept across requests and only those of changed layers reset.
+// Bindings are encoded in the order of the selected physical layout, so changing it resets all of
+// them.
+static uint32_t keymap_encoded_sizes_revision;
+static int keymap_encoded_sizes_layout = -1;
+
+static int reset_changed_encoded_size(const struct zmk_keymap_change *change, void *user_data) {
+    keymap_encoded_sizes.layers = 0;
+
+    if (change->type == ZMK_KEYMAP_CHANGE_BINDING && change->layer_id < ZMK_KEYMAP_LAYERS_LEN) {
+        keymap_encoded_sizes.layer_bindings[change->layer_id] = 0;
+    }
+
+    return 0;
+}
+
+static void refresh_keymap_encoded_sizes(void) {
+    int layout = zmk_physical_layouts_get_selected();
+
+    if (layout != keymap_encoded_sizes_layout ||
+        zmk_keymap_foreach_change_since(keymap_encoded_sizes_revision, reset_changed_encoded_size,
+                                        NULL) < 0) {
+        reset_keymap_encoded_sizes();
+    }
+
+    keymap_encoded_sizes_revision = zmk_keymap_get_revision();
+    keymap_encoded_sizes_layout = layout;
+}
+
+#else
+
+static void refresh_keymap_encoded_sizes(void) { reset_keymap_encoded_sizes(); }
+
+#endif // IS_ENABLED(CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL)
+
+static bool write_layer_bindings(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
     const zmk_keymap_layer_id_t layer_id = *(uint8_t *)*arg;
 
     for (int b = 0; b < ZMK_KEYMAP_LEN; b++) {
@@ -50,6 +123,17 @@ static bool encode_layer_bindings(pb_ostream_t *stream, const pb_field_t *field,
     return true;
 }
 
+static bool encode_layer_bindings(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
+    const zmk_keymap_layer_id_t layer_id = *(uint8_t *)*arg;
+
+    if (layer_id >= ZMK_KEYMAP_LAYERS_LEN) {
+        return write_layer_bindings(stream, field, arg);
+    }
+
+    return encode_with_cached_size(stream, field, arg, write_layer_bindings,
+                                   &keymap_encoded_sizes.layer_bindings[layer_id]);
+}
+
 static bool encode_layer_name(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
     const zmk_keymap_layer_index_t layer_idx = *(uint8_t *)*arg;
 
@@ -66,7 +150,7 @@ static bool encode_layer_name(pb_ostream_t *stream, const pb_field_t *field, voi
     return pb_encode_string(stream, name, strlen(name));
 }
 
-static bool encode_keymap_layers(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
+static bool write_keymap_layers(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
     for (zmk_keymap_layer_index_t l = 0; l < ZMK_KEYMAP_LAYERS_LEN; l++) {
         zmk_keymap_layer_id_t layer_id = zmk_keymap_layer_index_to_id(l);
 
@@ -97,6 +181,11 @@ static bool encode_keymap_layers(pb_ostream_t *stream, const pb_field_t *field,
     return true;
 }
 
+static bool encode_keymap_layers(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
+    return encode_with_cached_size(stream, field, arg, write_keymap_layers,
+                                   &keymap_encoded_sizes.layers);
+}
+
 static void populate_keymap_extra_props(zmk_keymap_Keymap *keymap) {
     keymap->max_layer_name_length = CONFIG_ZMK_KEYMAP_LAYER_NAME_MAX_LEN;
 
@@ -116,6 +205,7 @@ zmk_studio_Response get_keymap(const zmk_studio_Request *req) {
     LOG_DBG("");
     zmk_keymap_Keymap resp = zmk_keymap_Keymap_init_zero;
 
+    refresh_keymap_encoded_sizes();
     resp.layers.funcs.encode = encode_keymap_layers;
 
     populate_keymap_extra_props(&resp);
@@ -293,7 +383,7 @@ static bool encode_layout_keys(pb_ostream_t *stream, const pb_field_t *field, vo
     return true;
 }
 
-static bool encode_layouts(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
+static bool write_layouts(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
     struct zmk_physical_layout const *const *layouts;
     const size_t layout_count = zmk_physical_layouts_get_list(&layouts);
 
@@ -322,6 +412,13 @@ static bool encode_layouts(pb_ostream_t *stream, const pb_field_t *field, void *
     return true;
 }
 
+static bool encode_layouts(pb_ostream_t *stream, const pb_field_t *field, void *const *arg) {
+    // The physical layouts are fixed at build time, so their size never needs to be reset.
+    static size_t layouts_encoded_size;
+
+    return encode_with_cached_size(stream, field, arg, write_layouts, &layouts_encoded_size);
+}
+
 zmk_studio_Response get_physical_layouts(const zmk_studio_Request *req) {
     LOG_DBG("");
     zmk_keymap_PhysicalLayouts resp = zmk_keymap_PhysicalLayouts_init_zero;
@@ -338,6 +435,8 @@ zmk_studio_Response set_active_physical_layout(const zmk_studio_Request *req) {
     zmk_keymap_SetActivePhysicalLayoutResponse resp =
         zmk_keymap_SetActivePhysicalLayoutResponse_init_zero;
     resp.which_result = zmk_keymap_SetActivePhysicalLayoutResponse_ok_tag;
+    // The sizes are taken once the response is encoded, after the new layout is selected.
+    reset_keymap_encoded_sizes();
     resp.result.ok.layers.funcs.encode = encode_keymap_layers;
     populate_keymap_extra_props(&resp.result.ok);
 
@@ -368,6 +467,7 @@ zmk_studio_Response move_layer(const zmk_studio_Request *req) {
 
     if (ret >= 0) {
         resp.which_result = zmk_keymap_SetActivePhysicalLayoutResponse_ok_tag;
+        refresh_keymap_encoded_sizes();
         resp.result.ok.layers.funcs.encode = encode_keymap_layers;
         populate_keymap_extra_props(&resp.result.ok);
 
@@ -395,6 +495,7 @@ zmk_studio_Response add_layer(const zmk_studio_Request *req) {
         layer_id = zmk_keymap_layer_index_to_id(ret);
 
         resp.which_result = zmk_keymap_AddLayerResponse_ok_tag;
+        refresh_keymap_encoded_sizes();
 
         resp.result.ok.index = ret;
 
@@ -465,6 +566,7 @@ zmk_studio_Response restore_layer(const zmk_studio_Request *req) {
 
     if (ret >= 0) {
         resp.which_result = zmk_keymap_RemoveLayerResponse_ok_tag;
+        refresh_keymap_encoded_sizes();
         resp.result.ok.id = restore_req->layer_id;
 
         resp.result.ok.name.funcs.encode = encode_layer_name;
@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <string.h>
+
+#include <zephyr/sys/util.h>
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
@@ -77,4 +80,96 @@ bool studio_framing_process_byte(enum studio_framing_state *rpc_framing_state, u
         LOG_ERR("Unsupported framing state: %d", *rpc_framing_state);
         return false;
     }
-}
\ No newline at end of file
+}
+
+static inline bool is_framing_byte(uint8_t c) {
+    // SOF, ESC, and EOF are consecutive, so a single range check covers all of them.
+    return (uint8_t)(c - FRAMING_SOF) <= (FRAMING_EOF - FRAMING_SOF);
+}
+
+// Returns the index of the first framing byte in data, or len if there is none. This checks one
+// byte at a time, since memchr() can only look for a single value.
+static size_t find_framing_byte(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (is_framing_byte(data[i])) {
+            return i;
+        }
+    }
+
+    return len;
+}
+
+size_t studio_framing_process_block(enum studio_framing_state *rpc_framing_state,
+                                    const uint8_t *data, size_t len, uint8_t *out, size_t out_size,
+                                    size_t *out_len) {
+    size_t consumed = 0;
+    size_t written = 0;
+
+    while (consumed < len && written < out_size) {
+        if (*rpc_framing_state == FRAMING_STATE_AWAITING_DATA) {
+            size_t run =
+                find_framing_byte(&data[consumed], MIN(len - consumed, out_size - written));
+
+            memcpy(&out[written], &data[consumed], run);
+            consumed += run;
+            written += run;
+
+            if (consumed == len || written == out_size) {
+                break;
+            }
+        }
+
+        // Framing bytes, and any byte outside of a frame's data, go through the state machine.
+        uint8_t c = data[consumed++];
+        if (studio_framing_process_byte(rpc_framing_state, c)) {
+            out[written++] = c;
+        } else if (*rpc_framing_state == FRAMING_STATE_EOF) {
+            break;
+        }
+    }
+
+    *out_len = written;
+    return consumed;
+}
+
+size_t studio_framing_encoded_len(const uint8_t *data, size_t len) {
+    size_t escapes = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        if (is_framing_byte(data[i])) {
+            escapes++;
+        }
+    }
+
+    return len + escapes;
+}
+
+size_t studio_framing_encode_block(const uint8_t *data, size_t len, uint8_t *out, size_t out_size,
+                                   size_t *out_len, bool *escape_pending) {
+    size_t consumed = 0;
+    size_t written = 0;
+
+    while (consumed < len && written < out_size) {
+        if (*escape_pending) {
+            out[written++] = data[consumed++];
+            *escape_pending = false;
+            continue;
+        }
+
+        size_t run = find_framing_byte(&data[consumed], MIN(len - consumed, out_size - written));
+
+        memcpy(&out[written], &data[consumed], run);
+        consumed += run;
+        written += run;
+
+        if (consumed == len || written == out_size) {
+            break;
+        }
+
+        out[written++] = FRAMING_ESC;
+        *escape_pending = true;
+    }
+
+    *out_len = written;
+    return consumed;
+}
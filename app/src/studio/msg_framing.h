@@ -29,3 +29,36 @@ enum studio_framing_state {
  * has been updated.
  */
 bool studio_framing_process_byte(enum studio_framing_state *frame_state, uint8_t data);
+
+/**
+ * @brief Process a block of incoming bytes from a frame, copying any real data into the output
+ * buffer. Processing stops once the frame's EOF has been consumed or the output buffer is full.
+ * @param data the incoming bytes.
+ * @param len the number of incoming bytes.
+ * @param out the buffer to receive the real, unescaped data.
+ * @param out_size the size of the output buffer.
+ * @param out_len set to the number of bytes written to the output buffer.
+ * @return the number of incoming bytes that were consumed.
+ */
+size_t studio_framing_process_block(enum studio_framing_state *frame_state, const uint8_t *data,
+                                    size_t len, uint8_t *out, size_t out_size, size_t *out_len);
+
+/**
+ * @brief Get the number of bytes needed to write the given data once escaped.
+ */
+size_t studio_framing_encoded_len(const uint8_t *data, size_t len);
+
+/**
+ * @brief Escape a block of data into an output buffer. If the output buffer only has room for the
+ * escape byte of an escaped pair, @p escape_pending is set so the next call writes the data byte
+ * without escaping it again.
+ * @param data the data to escape.
+ * @param len the number of bytes of data.
+ * @param out the buffer to receive the escaped data.
+ * @param out_size the size of the output buffer.
+ * @param out_len set to the number of bytes written to the output buffer.
+ * @param escape_pending tracks an escape byte written without its data byte across calls.
+ * @return the number of data bytes that were consumed.
+ */
+size_t studio_framing_encode_block(const uint8_t *data, size_t len, uint8_t *out, size_t out_size,
+                                   size_t *out_len, bool *escape_pending);
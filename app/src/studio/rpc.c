@@ -24,6 +24,12 @@ LOG_MODULE_REGISTER(zmk_studio, CONFIG_ZMK_STUDIO_LOG_LEVEL);
 
 ZMK_EVENT_IMPL(zmk_studio_rpc_notification);
 
+#define NO_HANDLER UINT8_MAX
+
+// Built by zmk_rpc_init so requests are dispatched without scanning the iterable sections.
+static struct zmk_rpc_subsystem *subsystems_by_choice[ZMK_RPC_SUBSYSTEM_CHOICE_MAX];
+static uint8_t handlers_by_choice[ZMK_RPC_SUBSYSTEM_CHOICE_MAX][ZMK_RPC_REQUEST_CHOICE_MAX];
+
 static struct zmk_rpc_subsystem *find_subsystem_for_choice(uint8_t choice) {
     STRUCT_SECTION_FOREACH(zmk_rpc_subsystem, sub) {
         if (sub->subsystem_choice == choice) {
@@ -34,30 +40,38 @@ static struct zmk_rpc_subsystem *find_subsystem_for_choice(uint8_t choice) {
     return NULL;
 }
 
+static struct zmk_rpc_subsystem *get_subsystem_for_choice(uint8_t choice) {
+    return choice < ZMK_RPC_SUBSYSTEM_CHOICE_MAX ? subsystems_by_choice[choice] : NULL;
+}
+
 zmk_studio_Response zmk_rpc_subsystem_delegate_to_subs(const struct zmk_rpc_subsystem *subsys,
                                                        const zmk_studio_Request *req,
                                                        uint8_t which_req) {
     LOG_DBG("Got subsystem func for %d", subsys->subsystem_choice);
 
-    for (int i = subsys->handlers_start_index; i <= subsys->handlers_end_index; i++) {
-        struct zmk_rpc_subsystem_handler *sub_handler;
-        STRUCT_SECTION_GET(zmk_rpc_subsystem_handler, i, &sub_handler);
-        if (sub_handler->request_choice == which_req) {
-            if (sub_handler->security == ZMK_STUDIO_RPC_HANDLER_SECURED &&
-                zmk_studio_core_get_lock_state() != ZMK_STUDIO_CORE_LOCK_STATE_UNLOCKED) {
-                return ZMK_RPC_RESPONSE(meta, simple_error,
-                                        zmk_meta_ErrorConditions_UNLOCK_REQUIRED);
-            }
-            return sub_handler->func(req);
-        }
+    uint8_t handler_idx = which_req < ZMK_RPC_REQUEST_CHOICE_MAX
+                              ? handlers_by_choice[subsys->subsystem_choice][which_req]
+                              : NO_HANDLER;
+
+    if (handler_idx == NO_HANDLER) {
+        LOG_ERR("No handler func found for %d", which_req);
+        return ZMK_RPC_RESPONSE(meta, simple_error, zmk_meta_ErrorConditions_RPC_NOT_FOUND);
     }
-    LOG_ERR("No handler func found for %d", which_req);
-    return ZMK_RPC_RESPONSE(meta, simple_error, zmk_meta_ErrorConditions_RPC_NOT_FOUND);
+
+    struct zmk_rpc_subsystem_handler *sub_handler;
+    STRUCT_SECTION_GET(zmk_rpc_subsystem_handler, handler_idx, &sub_handler);
+
+    if (sub_handler->security == ZMK_STUDIO_RPC_HANDLER_SECURED &&
+        zmk_studio_core_get_lock_state() != ZMK_STUDIO_CORE_LOCK_STATE_UNLOCKED) {
+        return ZMK_RPC_RESPONSE(meta, simple_error, zmk_meta_ErrorConditions_UNLOCK_REQUIRED);
+    }
+
+    return sub_handler->func(req);
 }
 
 static zmk_studio_Response handle_request(const zmk_studio_Request *req) {
     zmk_studio_core_reschedule_lock_timeout();
-    struct zmk_rpc_subsystem *sub = find_subsystem_for_choice(req->which_subsystem);
+    struct zmk_rpc_subsystem *sub = get_subsystem_for_choice(req->which_subsystem);
     if (!sub) {
         LOG_WRN("No subsystem found for choice %d", req->which_subsystem);
         return ZMK_RPC_RESPONSE(meta, simple_error, zmk_meta_ErrorConditions_RPC_NOT_FOUND);
@@ -83,23 +97,24 @@ struct ring_buf *zmk_rpc_get_rx_buf(void) { return &rpc_rx_buf; }
 void zmk_rpc_rx_notify(void) { k_sem_give(&rpc_rx_sem); }
 
 static bool rpc_read_cb(pb_istream_t *stream, uint8_t *buf, size_t count) {
-    uint32_t write_offset = 0;
+    size_t write_offset = 0;
 
     do {
         uint8_t *buffer;
-        uint32_t len = ring_buf_get_claim(&rpc_rx_buf, &buffer, count);
+        uint32_t len = ring_buf_get_claim(&rpc_rx_buf, &buffer, rpc_rx_buf.size);
+        uint32_t consumed = 0;
 
         if (len > 0) {
-            for (int i = 0; i < len; i++) {
-                if (studio_framing_process_byte(&rpc_framing_state, buffer[i])) {
-                    buf[write_offset++] = buffer[i];
-                }
-            }
+            size_t decoded;
+            consumed = studio_framing_process_block(&rpc_framing_state, buffer, len,
+                                                    &buf[write_offset], count - write_offset,
+                                                    &decoded);
+            write_offset += decoded;
         } else {
             k_sem_take(&rpc_rx_sem, K_FOREVER);
         }
 
-        ring_buf_get_finish(&rpc_rx_buf, len);
+        ring_buf_get_finish(&rpc_rx_buf, consumed);
     } while (write_offset < count && rpc_framing_state != FRAMING_STATE_EOF);
 
     if (rpc_framing_state == FRAMING_STATE_EOF) {
@@ -117,56 +132,37 @@ static pb_istream_t pb_istream_for_rx_ring_buf() {
 
 RING_BUF_DECLARE(rpc_tx_buf, CONFIG_ZMK_STUDIO_RPC_TX_BUF_SIZE);
 
+static K_SEM_DEFINE(rpc_tx_space_sem, 0, 1);
+
 struct ring_buf *zmk_rpc_get_tx_buf(void) { return &rpc_tx_buf; }
 
+void zmk_rpc_tx_space_notify(void) { k_sem_give(&rpc_tx_space_sem); }
+
 static bool rpc_tx_buffer_write(pb_ostream_t *stream, const uint8_t *buf, size_t count) {
     void *user_data = stream->state;
+    size_t remaining = studio_framing_encoded_len(buf, count);
     size_t written = 0;
+    bool escape_pending = false;
 
-    bool escape_byte_already_written = false;
-    do {
-        uint32_t write_idx = 0;
-
+    while (remaining > 0) {
         uint8_t *write_buf;
-        uint32_t claim_len = ring_buf_put_claim(&rpc_tx_buf, &write_buf, count - written);
+        uint32_t claim_len = ring_buf_put_claim(&rpc_tx_buf, &write_buf, remaining);
 
         if (claim_len == 0) {
+            // Wait for the transport to take bytes out of the full buffer.
+            k_sem_take(&rpc_tx_space_sem, K_FOREVER);
             continue;
         }
 
-        int escapes_written = 0;
-        for (int i = 0; i < claim_len && write_idx < claim_len; i++) {
-            uint8_t b = buf[written + i];
-            switch (b) {
-            case FRAMING_EOF:
-            case FRAMING_ESC:
-            case FRAMING_SOF:
-                // Care to be taken. We may need to write the escape byte,
-                // but that's the last available spot for this claim, so we track
-                // if the escape has already been written in the previous iteration
-                // of our loop.
-                if (!escape_byte_already_written) {
-                    escapes_written++;
-                    write_buf[write_idx++] = FRAMING_ESC;
-                    escape_byte_already_written = true;
-                    if (write_idx >= claim_len) {
-                        LOG_WRN("Skipping on, no room to write escape and real byte");
-                        continue;
-                    }
-                }
-            default:
-                write_buf[write_idx++] = b;
-                escape_byte_already_written = false;
-                break;
-            }
-        }
-
-        ring_buf_put_finish(&rpc_tx_buf, write_idx);
+        size_t encoded;
+        written += studio_framing_encode_block(&buf[written], count - written, write_buf,
+                                               claim_len, &encoded, &escape_pending);
 
-        written += (write_idx - escapes_written);
+        ring_buf_put_finish(&rpc_tx_buf, encoded);
+        remaining -= encoded;
 
-        selected_transport->tx_notify(&rpc_tx_buf, write_idx, false, user_data);
-    } while (written < count);
+        selected_transport->tx_notify(&rpc_tx_buf, encoded, false, user_data);
+    }
 
     return true;
 }
@@ -212,29 +208,76 @@ exit:
     return 0;
 }
 
-static void rpc_main(void) {
-    for (;;) {
-        pb_istream_t stream = pb_istream_for_rx_ring_buf();
-        zmk_studio_Request req = zmk_studio_Request_init_zero;
+static bool decode_request(zmk_studio_Request *req) {
+    pb_istream_t stream = pb_istream_for_rx_ring_buf();
 #if IS_ENABLED(CONFIG_THREAD_ANALYZER)
-        thread_analyzer_print();
+    thread_analyzer_print();
 #endif // IS_ENABLED(CONFIG_THREAD_ANALYZER)
-        bool status = pb_decode(&stream, &zmk_studio_Request_msg, &req);
+    bool status = pb_decode(&stream, &zmk_studio_Request_msg, req);
 
-        rpc_framing_state = FRAMING_STATE_IDLE;
+    rpc_framing_state = FRAMING_STATE_IDLE;
 
-        if (status) {
-            zmk_studio_Response resp = handle_request(&req);
+    if (!status) {
+        LOG_DBG("Decode failed");
+    }
+
+    return status;
+}
 
-            int err = send_response(&resp);
+static void handle_request_and_respond(const zmk_studio_Request *req) {
+    zmk_studio_Response resp = handle_request(req);
+
+    int err = send_response(&resp);
 #if IS_ENABLED(CONFIG_THREAD_ANALYZER)
-            thread_analyzer_print();
+    thread_analyzer_print();
 #endif // IS_ENABLED(CONFIG_THREAD_ANALYZER)
-            if (err < 0) {
-                LOG_ERR("Failed to send the RPC response %d", err);
-            }
-        } else {
-            LOG_DBG("Decode failed");
+    if (err < 0) {
+        LOG_ERR("Failed to send the RPC response %d", err);
+    }
+}
+
+#if IS_ENABLED(CONFIG_ZMK_STUDIO_RPC_PIPELINING)
+
+// Requests that have been decoded but not yet handled. Once full, decoding waits, which in turn
+// applies back pressure through the RX buffer.
+K_MSGQ_DEFINE(rpc_request_msgq, sizeof(zmk_studio_Request), CONFIG_ZMK_STUDIO_RPC_PIPELINE_DEPTH,
+              4);
+
+static void rpc_main(void) {
+    for (;;) {
+        zmk_studio_Request req = zmk_studio_Request_init_zero;
+
+        if (decode_request(&req)) {
+            k_msgq_put(&rpc_request_msgq, &req, K_FOREVER);
+        }
+    }
+}
+
+// Decoding runs at a higher priority so the next request is read as soon as it arrives, even
+// while the response thread is still encoding into a full TX buffer.
+K_THREAD_DEFINE(studio_rpc_thread, CONFIG_ZMK_STUDIO_RPC_DECODE_THREAD_STACK_SIZE, rpc_main, NULL,
+                NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO - 1, 0, 0);
+
+static void rpc_response_main(void) {
+    for (;;) {
+        zmk_studio_Request req;
+
+        k_msgq_get(&rpc_request_msgq, &req, K_FOREVER);
+        handle_request_and_respond(&req);
+    }
+}
+
+K_THREAD_DEFINE(studio_rpc_response_thread, CONFIG_ZMK_STUDIO_RPC_THREAD_STACK_SIZE,
+                rpc_response_main, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
+#else
+
+static void rpc_main(void) {
+    for (;;) {
+        zmk_studio_Request req = zmk_studio_Request_init_zero;
+
+        if (decode_request(&req)) {
+            handle_request_and_respond(&req);
         }
     }
 }
@@ -242,9 +285,9 @@ static void rpc_main(void) {
 K_THREAD_DEFINE(studio_rpc_thread, CONFIG_ZMK_STUDIO_RPC_THREAD_STACK_SIZE, rpc_main, NULL, NULL,
                 NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
 
-static void refresh_selected_transport(void) {
-    enum zmk_transport transport = zmk_endpoints_selected().transport;
+#endif // IS_ENABLED(CONFIG_ZMK_STUDIO_RPC_PIPELINING)
 
+static void refresh_selected_transport(enum zmk_transport transport) {
     k_mutex_lock(&rpc_transport_mutex, K_FOREVER);
 
     if (selected_transport && selected_transport->transport == transport) {
@@ -256,6 +299,10 @@ static void refresh_selected_transport(void) {
             selected_transport->rx_stop();
         }
         selected_transport = NULL;
+#if IS_ENABLED(CONFIG_ZMK_STUDIO_RPC_PIPELINING)
+        // Requests decoded from the old transport must not be answered on the new one.
+        k_msgq_purge(&rpc_request_msgq);
+#endif // IS_ENABLED(CONFIG_ZMK_STUDIO_RPC_PIPELINING)
 #if IS_ENABLED(CONFIG_ZMK_STUDIO_LOCK_ON_DISCONNECT)
         zmk_studio_core_lock();
 #endif
@@ -284,11 +331,20 @@ static int zmk_rpc_init(void) {
     struct zmk_rpc_subsystem *prev_sub = NULL;
     int i = 0;
 
+    memset(handlers_by_choice, NO_HANDLER, sizeof(handlers_by_choice));
+
+    STRUCT_SECTION_FOREACH(zmk_rpc_subsystem, sub) {
+        subsystems_by_choice[sub->subsystem_choice] = sub;
+    }
+
     STRUCT_SECTION_FOREACH(zmk_rpc_subsystem_handler, handler) {
         struct zmk_rpc_subsystem *sub = find_subsystem_for_choice(handler->subsystem_choice);
 
         __ASSERT(sub != NULL, "RPC Handler for unknown subsystem choice %d",
                  handler->subsystem_choice);
+        __ASSERT(i < NO_HANDLER, "Too many RPC handlers for the dispatch table");
+
+        handlers_by_choice[handler->subsystem_choice][handler->request_choice] = i;
 
         if (prev_choice < 0) {
             sub->handlers_start_index = i;
@@ -306,7 +362,7 @@ static int zmk_rpc_init(void) {
         prev_sub->handlers_end_index = i - 1;
     }
 
-    refresh_selected_transport();
+    refresh_selected_transport(zmk_endpoints_selected().transport);
 
     return 0;
 }
@@ -316,7 +372,7 @@ SYS_INIT(zmk_rpc_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
 static int studio_rpc_listener_cb(const zmk_event_t *eh) {
     struct zmk_endpoint_changed *ep_changed = as_zmk_endpoint_changed(eh);
     if (ep_changed) {
-        refresh_selected_transport();
+        refresh_selected_transport(ep_changed->endpoint.transport);
         return ZMK_EV_EVENT_BUBBLE;
     }
 
@@ -36,6 +36,8 @@ static void tx_notify(struct ring_buf *tx_ring_buf, size_t written, bool msg_don
 
             ring_buf_get_finish(tx_buf, claim_len);
         }
+
+        zmk_rpc_tx_space_notify();
 #endif
     }
 }
@@ -137,6 +139,8 @@ static void serial_cb(const struct device *dev, void *user_data) {
 
             ring_buf_get_finish(tx_buf, MAX(sent, 0));
         }
+
+        zmk_rpc_tx_space_notify();
     }
 }
 
@@ -6,11 +6,13 @@
 
 #include <zephyr/device.h>
 #include <zephyr/init.h>
+#include <string.h>
 
 #include <zephyr/usb/usb_device.h>
 #include <zephyr/usb/class/usb_hid.h>
 
 #include <zmk/usb.h>
+#include <zmk/usb_hid.h>
 #include <zmk/hid.h>
 #include <zmk/keymap.h>
 
@@ -28,9 +30,199 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 static const struct device *hid_dev;
 
-static K_SEM_DEFINE(hid_sem, 1, 1);
+union usb_hid_report {
+    struct zmk_hid_keyboard_report keyboard;
+    struct zmk_hid_consumer_report consumer;
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    struct zmk_hid_mouse_report mouse;
+#endif // IS_ENABLED(CONFIG_ZMK_POINTING)
+#if IS_ENABLED(CONFIG_ZMK_USB_BOOT)
+    zmk_hid_boot_report_t boot;
+#endif // IS_ENABLED(CONFIG_ZMK_USB_BOOT)
+};
+
+struct usb_hid_queued_report {
+    // Boot protocol reports have no ID on the wire, but are still keyboard reports.
+    uint8_t report_id;
+    uint8_t len;
+    union usb_hid_report report;
+};
+
+#define REPORT_QUEUE_SIZE CONFIG_ZMK_USB_HID_REPORT_QUEUE_SIZE
+// One spare slot, so a report whose write has to be retried can always be put back in front.
+#define REPORT_QUEUE_SLOTS (REPORT_QUEUE_SIZE + 1)
+#define REPORT_ID_COUNT (ZMK_HID_REPORT_ID_MOUSE + 1)
+
+// A transfer that hasn't completed after this long is assumed lost, e.g. to a bus reset.
+#define EP_BUSY_TIMEOUT_MS 30
+
+// Reports are written to the interrupt IN endpoint one at a time from in_ready_cb, so senders
+// never wait for the endpoint. Keyboard and consumer reports, and mouse button changes, are
+// edges the host must see in order, so they go through an ordered queue. Mouse movement only
+// keeps the latest state, accumulating deltas, and is sent once the queue is empty.
+//
+// While the queue is full, only the latest report of each report ID is kept, and moved to the
+// end of the queue as soon as there is room. Every report ID still ends up in its latest state,
+// so a full queue can't leave a key stuck, and only the intermediate states of a report ID that
+// overflowed more than once are lost.
+static struct k_spinlock tx_lock;
+static struct usb_hid_queued_report report_queue[REPORT_QUEUE_SLOTS];
+static size_t report_queue_head;
+static size_t report_queue_len;
+static struct usb_hid_queued_report overflow_reports[REPORT_ID_COUNT];
+static uint8_t overflow_pending;
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+static struct zmk_hid_mouse_report pending_mouse_report;
+static bool mouse_report_pending;
+// Buttons of the most recent mouse report that was queued or made pending.
+static zmk_mouse_button_flags_t last_mouse_buttons;
+#endif // IS_ENABLED(CONFIG_ZMK_POINTING)
+static bool ep_busy;
+static uint32_t ep_busy_since;
+static struct zmk_usb_hid_stats tx_stats;
+
+static void ep_timeout_work_cb(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(ep_timeout_work, ep_timeout_work_cb);
+
+static void clear_tx_queue(void) {
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+    report_queue_len = 0;
+    overflow_pending = 0;
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    mouse_report_pending = false;
+    last_mouse_buttons = 0;
+#endif // IS_ENABLED(CONFIG_ZMK_POINTING)
+    ep_busy = false;
+    k_spin_unlock(&tx_lock, key);
+}
+
+// Must be called with tx_lock held.
+static void enqueue_report(uint8_t report_id, const uint8_t *report, size_t len) {
+    struct usb_hid_queued_report *slot;
+
+    if (report_queue_len >= REPORT_QUEUE_SIZE) {
+        if (overflow_pending & BIT(report_id)) {
+            tx_stats.dropped++;
+        }
+
+        slot = &overflow_reports[report_id];
+        overflow_pending |= BIT(report_id);
+    } else {
+        slot = &report_queue[(report_queue_head + report_queue_len) % REPORT_QUEUE_SLOTS];
+        report_queue_len++;
+    }
+
+    slot->report_id = report_id;
+    slot->len = len;
+    memcpy(&slot->report, report, len);
+}
+
+// Must be called with tx_lock held. Overflowed reports are newer than anything in the queue, so
+// they go at the end of it.
+static void requeue_overflow_reports(void) {
+    while (overflow_pending && report_queue_len < REPORT_QUEUE_SIZE) {
+        uint8_t report_id = find_lsb_set(overflow_pending) - 1;
+        const struct usb_hid_queued_report *overflow = &overflow_reports[report_id];
+
+        overflow_pending &= ~BIT(report_id);
+        enqueue_report(report_id, (const uint8_t *)&overflow->report, overflow->len);
+    }
+}
 
-static void in_ready_cb(const struct device *dev) { k_sem_give(&hid_sem); }
+// Must be called with tx_lock held. Copies the next report to send into next.
+static bool take_next_report(struct usb_hid_queued_report *next) {
+    if (report_queue_len > 0) {
+        *next = report_queue[report_queue_head];
+        report_queue_head = (report_queue_head + 1) % REPORT_QUEUE_SLOTS;
+        report_queue_len--;
+        requeue_overflow_reports();
+        return true;
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_POINTING)
+    if (mouse_report_pending) {
+        next->report_id = ZMK_HID_REPORT_ID_MOUSE;
+        next->len = sizeof(pending_mouse_report);
+        next->report.mouse = pending_mouse_report;
+        mouse_report_pending = false;
+        return true;
+    }
+#endif // IS_ENABLED(CONFIG_ZMK_POINTING)
+
+    return false;
+}
+
+static void send_next_report(void) {
+    // The endpoint write copies the report into the endpoint buffer, so a copy taken under the
+    // lock is all that is needed, even if a late completion starts another write meanwhile.
+    struct usb_hid_queued_report next;
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+
+    if (ep_busy) {
+        if (k_cyc_to_ms_floor32(k_cycle_get_32() - ep_busy_since) < EP_BUSY_TIMEOUT_MS) {
+            k_spin_unlock(&tx_lock, key);
+            return;
+        }
+
+        LOG_WRN("USB HID transfer did not complete, sending the next report anyway");
+        tx_stats.timeouts++;
+    }
+
+    if (!take_next_report(&next)) {
+        ep_busy = false;
+        k_spin_unlock(&tx_lock, key);
+        return;
+    }
+
+    ep_busy = true;
+    ep_busy_since = k_cycle_get_32();
+    k_spin_unlock(&tx_lock, key);
+
+    // Without a completion, nothing else would send the rest of the queue.
+    k_work_reschedule(&ep_timeout_work, K_MSEC(EP_BUSY_TIMEOUT_MS + 1));
+
+    int err = hid_int_ep_write(hid_dev, (uint8_t *)&next.report, next.len, NULL);
+    if (err == -EAGAIN) {
+        // A transfer assumed lost after the timeout is still running. Put the report back in
+        // front, and send it from in_ready_cb once that transfer completes.
+        key = k_spin_lock(&tx_lock);
+        report_queue_head = (report_queue_head + REPORT_QUEUE_SLOTS - 1) % REPORT_QUEUE_SLOTS;
+        report_queue[report_queue_head] = next;
+        report_queue_len++;
+        k_spin_unlock(&tx_lock, key);
+    } else if (err) {
+        LOG_WRN("Failed to write USB HID report (%d)", err);
+
+        key = k_spin_lock(&tx_lock);
+        ep_busy = false;
+        tx_stats.dropped++;
+        k_spin_unlock(&tx_lock, key);
+    }
+}
+
+static void ep_timeout_work_cb(struct k_work *work) { send_next_report(); }
+
+static void in_ready_cb(const struct device *dev) {
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+    if (ep_busy) {
+        uint32_t busy_us = k_cyc_to_us_floor32(k_cycle_get_32() - ep_busy_since);
+
+        tx_stats.sent++;
+        tx_stats.busy_us_total += busy_us;
+        tx_stats.busy_us_max = MAX(tx_stats.busy_us_max, busy_us);
+        ep_busy = false;
+    }
+    k_spin_unlock(&tx_lock, key);
+
+    send_next_report();
+}
+
+void zmk_usb_hid_get_stats(struct zmk_usb_hid_stats *stats) {
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+    *stats = tx_stats;
+    k_spin_unlock(&tx_lock, key);
+}
 
 #define HID_GET_REPORT_TYPE_MASK 0xff00
 #define HID_GET_REPORT_ID_MASK 0x00ff
@@ -184,7 +376,7 @@ static const struct hid_ops ops = {
     .set_report = set_report_cb,
 };
 
-static int zmk_usb_hid_send_report(const uint8_t *report, size_t len) {
+static int check_usb_status(void) {
     switch (zmk_usb_get_status()) {
     case USB_DC_SUSPEND:
         return usb_wakeup_request();
@@ -192,23 +384,33 @@ static int zmk_usb_hid_send_report(const uint8_t *report, size_t len) {
     case USB_DC_RESET:
     case USB_DC_DISCONNECTED:
     case USB_DC_UNKNOWN:
+        // No transfer will complete, so start over once the host is back.
+        clear_tx_queue();
         return -ENODEV;
     default:
-        k_sem_take(&hid_sem, K_MSEC(30));
-        int err = hid_int_ep_write(hid_dev, report, len, NULL);
-
-        if (err) {
-            k_sem_give(&hid_sem);
-        }
+        return 1;
+    }
+}
 
-        return err;
+static int zmk_usb_hid_send_report(uint8_t report_id, const uint8_t *report, size_t len) {
+    int ret = check_usb_status();
+    if (ret <= 0) {
+        return ret;
     }
+
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+    enqueue_report(report_id, report, len);
+    k_spin_unlock(&tx_lock, key);
+
+    send_next_report();
+
+    return 0;
 }
 
 int zmk_usb_hid_send_keyboard_report(void) {
     size_t len;
     uint8_t *report = get_keyboard_report(&len);
-    return zmk_usb_hid_send_report(report, len);
+    return zmk_usb_hid_send_report(ZMK_HID_REPORT_ID_KEYBOARD, report, len);
 }
 
 int zmk_usb_hid_send_consumer_report(void) {
@@ -219,7 +421,8 @@ int zmk_usb_hid_send_consumer_report(void) {
 #endif /* IS_ENABLED(CONFIG_ZMK_USB_BOOT) */
 
     struct zmk_hid_consumer_report *report = zmk_hid_get_consumer_report();
-    return zmk_usb_hid_send_report((uint8_t *)report, sizeof(*report));
+    return zmk_usb_hid_send_report(ZMK_HID_REPORT_ID_CONSUMER, (uint8_t *)report,
+                                   sizeof(*report));
 }
 
 #if IS_ENABLED(CONFIG_ZMK_POINTING)
@@ -230,8 +433,65 @@ int zmk_usb_hid_send_mouse_report() {
     }
 #endif /* IS_ENABLED(CONFIG_ZMK_USB_BOOT) */
 
+    int ret = check_usb_status();
+    if (ret <= 0) {
+        return ret;
+    }
+
     struct zmk_hid_mouse_report *report = zmk_hid_get_mouse_report();
-    return zmk_usb_hid_send_report((uint8_t *)report, sizeof(*report));
+
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+
+    if (report->body.buttons != last_mouse_buttons) {
+        // A button change is an edge, so it is queued in order with keyboard and consumer
+        // reports, after any movement that happened before it.
+        if (mouse_report_pending) {
+            enqueue_report(ZMK_HID_REPORT_ID_MOUSE, (uint8_t *)&pending_mouse_report,
+                           sizeof(pending_mouse_report));
+            mouse_report_pending = false;
+        }
+
+        enqueue_report(ZMK_HID_REPORT_ID_MOUSE, (uint8_t *)report, sizeof(*report));
+        last_mouse_buttons = report->body.buttons;
+        k_spin_unlock(&tx_lock, key);
+
+        send_next_report();
+        return 0;
+    }
+
+    if (mouse_report_pending) {
+        struct zmk_hid_mouse_report_body *pending = &pending_mouse_report.body;
+        int32_t d_x = pending->d_x + report->body.d_x;
+        int32_t d_y = pending->d_y + report->body.d_y;
+        int32_t d_scroll_y = pending->d_scroll_y + report->body.d_scroll_y;
+        int32_t d_scroll_x = pending->d_scroll_x + report->body.d_scroll_x;
+
+        if (IN_RANGE(d_x, INT16_MIN, INT16_MAX) && IN_RANGE(d_y, INT16_MIN, INT16_MAX) &&
+            IN_RANGE(d_scroll_y, INT16_MIN, INT16_MAX) &&
+            IN_RANGE(d_scroll_x, INT16_MIN, INT16_MAX)) {
+            pending->d_x = d_x;
+            pending->d_y = d_y;
+            pending->d_scroll_y = d_scroll_y;
+            pending->d_scroll_x = d_scroll_x;
+            tx_stats.merged++;
+            k_spin_unlock(&tx_lock, key);
+
+            send_next_report();
+            return 0;
+        }
+
+        // The sums no longer fit, so send the movement so far ahead of the rest.
+        enqueue_report(ZMK_HID_REPORT_ID_MOUSE, (uint8_t *)&pending_mouse_report,
+                       sizeof(pending_mouse_report));
+    }
+
+    pending_mouse_report = *report;
+    mouse_report_pending = true;
+    k_spin_unlock(&tx_lock, key);
+
+    send_next_report();
+
+    return 0;
 }
 #endif // IS_ENABLED(CONFIG_ZMK_POINTING)
 
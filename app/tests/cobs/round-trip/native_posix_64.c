@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include <zmk/cobs.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// Encodes frames into a ring buffer, finds and decodes them again, and checks that they come back
+// unchanged. Every frame is written at several buffer offsets, so the encoder's writes and the
+// decoder's search both cross the end of the buffer's storage.
+
+// The longest wired split frame: a payload of UINT8_MAX bytes and its CRC16.
+#define MAX_FRAME_LEN (UINT8_MAX + sizeof(uint16_t))
+#define TAIL_LEN sizeof(uint16_t)
+#define RANDOM_FRAMES 200
+
+RING_BUF_DECLARE(frame_buf, ZMK_COBS_ENCODED_LEN_MAX(MAX_FRAME_LEN) + 40);
+
+static const uint32_t offsets[] = {0, 1, 40, 150, 299};
+
+static uint8_t frame[MAX_FRAME_LEN];
+static uint8_t received[ZMK_COBS_ENCODED_LEN_MAX(MAX_FRAME_LEN)];
+static uint32_t random_state;
+
+static uint32_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static void move_to_offset(const uint32_t offset) {
+    static const uint8_t filler[300];
+
+    ring_buf_reset(&frame_buf);
+    ring_buf_put(&frame_buf, filler, offset);
+    ring_buf_get(&frame_buf, NULL, offset);
+}
+
+// Returns the encoded length of the frame, or a negative error if any offset fails.
+static int round_trip(const uint8_t *data, const size_t len) {
+    // Like the wired split, the last two bytes stand in for a CRC passed separately.
+    const size_t tail_len = len >= TAIL_LEN ? TAIL_LEN : 0;
+    int encoded_len = -EINVAL;
+
+    for (int i = 0; i < ARRAY_SIZE(offsets); i++) {
+        size_t frame_len;
+
+        move_to_offset(offsets[i]);
+
+        int ret = zmk_cobs_put(&frame_buf, data, len - tail_len, data + len - tail_len, tail_len);
+        if (ret < 0) {
+            return ret;
+        }
+
+        const uint32_t queued = ring_buf_size_get(&frame_buf);
+        if (queued > ZMK_COBS_ENCODED_LEN_MAX(len)) {
+            return -E2BIG;
+        }
+
+        ret = zmk_cobs_find_frame(&frame_buf, &frame_len);
+        if (ret < 0 || frame_len + 1 != queued) {
+            return -EBADMSG;
+        }
+
+        ring_buf_get(&frame_buf, received, frame_len);
+        ring_buf_get(&frame_buf, NULL, 1);
+
+        ret = zmk_cobs_decode(received, frame_len);
+        if (ret != len || memcmp(received, data, len) != 0) {
+            return -EBADMSG;
+        }
+
+        encoded_len = queued;
+    }
+
+    return encoded_len;
+}
+
+static void check_frame(const char *name, const uint8_t *data, const size_t len) {
+    int ret = round_trip(data, len);
+    if (ret < 0) {
+        LOG_DBG("%s: %zu bytes failed (%d)", name, len, ret);
+        return;
+    }
+
+    LOG_DBG("%s: %zu bytes encoded as %d", name, len, ret);
+}
+
+static void fill_non_zero(uint8_t *data, const size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] = i % UINT8_MAX + 1;
+    }
+}
+
+static void check_random_frames(void) {
+    int failed = 0;
+    size_t bytes = 0;
+    size_t zeros = 0;
+
+    random_state = 0xc0b5;
+
+    for (int n = 0; n < RANDOM_FRAMES; n++) {
+        const size_t len = next_random() % (MAX_FRAME_LEN + 1);
+
+        for (size_t i = 0; i < len; i++) {
+            // Zero about one byte in eight, with long runs of zeros now and then.
+            const uint32_t r = next_random();
+            frame[i] = (r & 0x7) == 0 || (n % 16 == 0 && i % 64 < 20) ? 0 : r >> 24;
+            zeros += frame[i] == 0;
+        }
+
+        if (round_trip(frame, len) < 0) {
+            failed++;
+        }
+
+        bytes += len;
+    }
+
+    LOG_DBG("random: %d of %d frames failed, %zu bytes with %zu zeros", failed, RANDOM_FRAMES,
+            bytes, zeros);
+}
+
+static void check_malformed_frames(void) {
+    size_t frame_len;
+
+    // A code byte which runs past the end of the frame.
+    uint8_t overrun[] = {0x05, 0x11, 0x22};
+    LOG_DBG("overrun: %d", zmk_cobs_decode(overrun, sizeof(overrun)));
+
+    // A delimiter inside the frame.
+    uint8_t delimiter[] = {0x02, 0x11, ZMK_COBS_DELIMITER, 0x22};
+    LOG_DBG("delimiter: %d", zmk_cobs_decode(delimiter, sizeof(delimiter)));
+
+    // Bytes with no delimiter yet.
+    ring_buf_reset(&frame_buf);
+    ring_buf_put(&frame_buf, overrun, sizeof(overrun));
+    LOG_DBG("unterminated: %d", zmk_cobs_find_frame(&frame_buf, &frame_len));
+
+    // A frame which might not fit, which must not be partly queued.
+    fill_non_zero(frame, MAX_FRAME_LEN);
+    ring_buf_reset(&frame_buf);
+    const uint32_t fill =
+        ring_buf_capacity_get(&frame_buf) - ZMK_COBS_ENCODED_LEN_MAX(MAX_FRAME_LEN) + 1;
+    ring_buf_put(&frame_buf, frame, fill);
+    const uint32_t queued = ring_buf_size_get(&frame_buf);
+    int ret = zmk_cobs_put(&frame_buf, frame, MAX_FRAME_LEN, NULL, 0);
+    LOG_DBG("full: %d, %u bytes queued after", ret, ring_buf_size_get(&frame_buf) - queued);
+}
+
+static int cobs_round_trip_init(void) {
+    check_frame("empty", frame, 0);
+
+    memset(frame, 0, MAX_FRAME_LEN);
+    check_frame("one zero", frame, 1);
+    check_frame("zero run", frame, 16);
+    check_frame("all zeros", frame, MAX_FRAME_LEN);
+
+    fill_non_zero(frame, MAX_FRAME_LEN);
+    check_frame("253 non-zero", frame, ZMK_COBS_MAX_RUN - 1);
+    check_frame("254 non-zero", frame, ZMK_COBS_MAX_RUN);
+    check_frame("255 non-zero", frame, ZMK_COBS_MAX_RUN + 1);
+
+    frame[ZMK_COBS_MAX_RUN] = 0;
+    check_frame("254 non-zero then zero", frame, ZMK_COBS_MAX_RUN + 1);
+    check_frame("254 non-zero, zero, more", frame, MAX_FRAME_LEN);
+
+    fill_non_zero(frame, MAX_FRAME_LEN);
+    frame[0] = 0;
+    check_frame("zero then 254 non-zero", frame, ZMK_COBS_MAX_RUN + 1);
+
+    fill_non_zero(frame, MAX_FRAME_LEN);
+    check_frame("max frame", frame, MAX_FRAME_LEN);
+
+    frame[MAX_FRAME_LEN - 1] = 0;
+    frame[MAX_FRAME_LEN - 2] = 0;
+    check_frame("max frame ending in zeros", frame, MAX_FRAME_LEN);
+
+    check_random_frames();
+    check_malformed_frames();
+
+    return 0;
+}
+
+SYS_INIT(cobs_round_trip_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
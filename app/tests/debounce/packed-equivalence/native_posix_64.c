@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <zmk/debounce.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// Runs zmk_debounce_packed_update() and zmk_debounce_update() on the same bouncing readings, one
+// scan per millisecond, for every press and release threshold up to MAX_THRESHOLD_SCANS.
+
+#define MAX_OUTPUTS 16
+#define MAX_INPUTS 20
+#define MAX_THRESHOLD_SCANS 11
+#define SCANS 400
+
+// The default debounce time at the default 1 ms scan period.
+#define DEFAULT_THRESHOLD_SCANS 5
+
+#define PACKED_STATE_LEN DEBOUNCE_PACKED_STATE_LEN(DEBOUNCE_PACKED_PLANES(MAX_THRESHOLD_SCANS))
+
+static struct zmk_debounce_state scalar_states[MAX_OUTPUTS * MAX_INPUTS];
+static uint32_t packed_states[MAX_OUTPUTS][PACKED_STATE_LEN];
+static uint32_t readings[MAX_OUTPUTS];
+static uint32_t random_state;
+
+static uint32_t next_random(void) {
+    // xorshift32, seeded the same way for every matrix so the results are repeatable.
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static void compare_debouncers(const int outputs, const int inputs) {
+    int mismatches = 0;
+    int changes = 0;
+    int updates = 0;
+    int skipped = 0;
+
+    random_state = 0x5eed;
+
+    for (int press = 0; press <= MAX_THRESHOLD_SCANS; press++) {
+        for (int release = 0; release <= MAX_THRESHOLD_SCANS; release++) {
+            const struct zmk_debounce_config config = {
+                .debounce_press_ms = press,
+                .debounce_release_ms = release,
+                .algorithm = ZMK_DEBOUNCE_INTEGRATOR,
+            };
+            const struct zmk_debounce_packed_config packed_config = {
+                .debounce_press_scans = press,
+                .debounce_release_scans = release,
+                .planes = DEBOUNCE_PACKED_PLANES(MAX(press, release)),
+            };
+
+            memset(scalar_states, 0, sizeof(scalar_states));
+            memset(packed_states, 0, sizeof(packed_states));
+            memset(readings, 0, sizeof(readings));
+
+            for (int scan = 0; scan < SCANS; scan++) {
+                for (int o = 0; o < outputs; o++) {
+                    uint32_t *packed = packed_states[o];
+
+                    // Each switch flips with a 1 in 8 chance per scan, so it holds for about as
+                    // long as the thresholds being tested.
+                    readings[o] ^= next_random() & next_random() & next_random() & BIT_MASK(inputs);
+
+                    const uint32_t latched = zmk_debounce_packed_get_pressed(packed);
+                    if (readings[o] == latched &&
+                        zmk_debounce_packed_get_active(packed, &packed_config) == latched) {
+                        skipped++;
+                    }
+
+                    const uint32_t changed =
+                        zmk_debounce_packed_update(packed, readings[o], &packed_config);
+                    const uint32_t pressed = zmk_debounce_packed_get_pressed(packed);
+                    const uint32_t active = zmk_debounce_packed_get_active(packed, &packed_config);
+
+                    for (int i = 0; i < inputs; i++) {
+                        struct zmk_debounce_state *state = &scalar_states[o * inputs + i];
+
+                        zmk_debounce_update(state, readings[o] & BIT(i), 1, &config);
+
+                        if (zmk_debounce_get_changed(state) != !!(changed & BIT(i)) ||
+                            zmk_debounce_is_pressed(state) != !!(pressed & BIT(i)) ||
+                            zmk_debounce_is_active(state) != !!(active & BIT(i))) {
+                            mismatches++;
+                        }
+
+                        changes += zmk_debounce_get_changed(state);
+                        updates++;
+                    }
+                }
+            }
+        }
+    }
+
+    LOG_DBG("%dx%d: %d mismatches in %d switch updates with %d changes", outputs, inputs,
+            mismatches, updates, changes);
+    LOG_DBG("%dx%d: %d of %d packed updates had nothing to do", outputs, inputs, skipped,
+            updates / inputs);
+    LOG_DBG("%dx%d: %zu bytes of packed state and %zu bytes of per-key state at %d scans",
+            outputs, inputs,
+            outputs * DEBOUNCE_PACKED_STATE_LEN(DEBOUNCE_PACKED_PLANES(DEFAULT_THRESHOLD_SCANS)) *
+                sizeof(uint32_t),
+            outputs * inputs * sizeof(struct zmk_debounce_state), DEFAULT_THRESHOLD_SCANS);
+}
+
+static int debounce_equivalence_init(void) {
+    compare_debouncers(6, 20);
+    compare_debouncers(16, 16);
+    return 0;
+}
+
+SYS_INIT(debounce_equivalence_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <zmk/debounce.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// Replays bouncy switch waveforms through each debounce algorithm, one scan per millisecond, and
+// reports how long each one takes to report the intended press and release and how many other
+// changes it reports.
+
+#define DEBOUNCE_MS 5
+#define NO_EDGE -1
+
+struct waveform {
+    const char *name;
+    /** One reading per millisecond. '1' is closed and '0' is open. */
+    const char *samples;
+    /** Index of the first sample of the intended press, or NO_EDGE. */
+    int press_ms;
+    /** Index of the first sample of the intended release, or NO_EDGE. */
+    int release_ms;
+};
+
+static const struct waveform waveforms[] = {
+    {
+        .name = "clean tap",
+        .samples = "0000000000"
+                   "111111111111111111111111111111"
+                   "000000000000000000000000000000",
+        .press_ms = 10,
+        .release_ms = 40,
+    },
+    {
+        .name = "bouncy tap",
+        .samples = "0000000000"
+                   "1011011"
+                   "111111111111111111111111111111"
+                   "0100100"
+                   "000000000000000000000000000000",
+        .press_ms = 10,
+        .release_ms = 47,
+    },
+    {
+        .name = "short bouncy tap",
+        .samples = "0000000000"
+                   "1101"
+                   "1111"
+                   "0010"
+                   "000000000000000000000000000000",
+        .press_ms = 10,
+        .release_ms = 18,
+    },
+    {
+        .name = "hold with dropout",
+        .samples = "0000000000"
+                   "11111111111111111111"
+                   "0"
+                   "11111111111111111111"
+                   "000000000000000000000000000000",
+        .press_ms = 10,
+        .release_ms = 51,
+    },
+    {
+        .name = "noise spike",
+        .samples = "0000000000"
+                   "1"
+                   "000000000000000000000000000000",
+        .press_ms = NO_EDGE,
+        .release_ms = NO_EDGE,
+    },
+};
+
+static const char *const algorithm_names[] = {
+    [ZMK_DEBOUNCE_INTEGRATOR] = "integrator",
+    [ZMK_DEBOUNCE_EAGER] = "eager",
+    [ZMK_DEBOUNCE_EAGER_PRESS] = "eager-press",
+    [ZMK_DEBOUNCE_DEFER_ROW] = "defer-row",
+};
+
+struct replay_result {
+    /** Time from the intended press to the first press reported after it, or NO_EDGE. */
+    int press_latency_ms;
+    /** Time from the intended release to the first release reported after it, or NO_EDGE. */
+    int release_latency_ms;
+    /** Number of reported changes other than the intended press and release. */
+    int false_changes;
+};
+
+static struct replay_result replay(const struct waveform *waveform,
+                                   const struct zmk_debounce_config *config) {
+    struct zmk_debounce_state state = {0};
+    struct zmk_debounce_state row = {0};
+    struct replay_result result = {
+        .press_latency_ms = NO_EDGE,
+        .release_latency_ms = NO_EDGE,
+    };
+    int changes = 0;
+
+    for (int t = 0; waveform->samples[t]; t++) {
+        zmk_debounce_update(&state, waveform->samples[t] == '1', 1, config);
+        zmk_debounce_update_row(&row, &state, 1, 1, 1, config);
+
+        if (!zmk_debounce_get_changed(&state)) {
+            continue;
+        }
+
+        changes++;
+
+        if (zmk_debounce_is_pressed(&state)) {
+            if (result.press_latency_ms == NO_EDGE && waveform->press_ms != NO_EDGE &&
+                t >= waveform->press_ms) {
+                result.press_latency_ms = t - waveform->press_ms;
+            }
+        } else {
+            if (result.release_latency_ms == NO_EDGE && waveform->release_ms != NO_EDGE &&
+                t >= waveform->release_ms) {
+                result.release_latency_ms = t - waveform->release_ms;
+            }
+        }
+    }
+
+    result.false_changes = changes - (result.press_latency_ms != NO_EDGE) -
+                           (result.release_latency_ms != NO_EDGE);
+
+    return result;
+}
+
+static void format_latency(char *buf, const size_t len, const int latency_ms) {
+    if (latency_ms == NO_EDGE) {
+        snprintf(buf, len, "missed");
+    } else {
+        snprintf(buf, len, "%d ms", latency_ms);
+    }
+}
+
+static void replay_waveforms(const enum zmk_debounce_algorithm algorithm) {
+    const struct zmk_debounce_config config = {
+        .debounce_press_ms = DEBOUNCE_MS,
+        .debounce_release_ms = DEBOUNCE_MS,
+        .algorithm = algorithm,
+    };
+    const char *name = algorithm_names[algorithm];
+    int worst_press_ms = 0;
+    int worst_release_ms = 0;
+    int false_changes = 0;
+    int missed = 0;
+
+    for (int i = 0; i < ARRAY_SIZE(waveforms); i++) {
+        const struct waveform *waveform = &waveforms[i];
+        const struct replay_result result = replay(waveform, &config);
+        char press[12];
+        char release[12];
+
+        if (waveform->press_ms != NO_EDGE) {
+            format_latency(press, sizeof(press), result.press_latency_ms);
+            format_latency(release, sizeof(release), result.release_latency_ms);
+            LOG_DBG("%s, %s: press %s, release %s, %d false changes", name, waveform->name, press,
+                    release, result.false_changes);
+
+            missed += (result.press_latency_ms == NO_EDGE) + (result.release_latency_ms == NO_EDGE);
+            worst_press_ms = MAX(worst_press_ms, result.press_latency_ms);
+            worst_release_ms = MAX(worst_release_ms, result.release_latency_ms);
+        } else {
+            LOG_DBG("%s, %s: %d false changes", name, waveform->name, result.false_changes);
+        }
+
+        false_changes += result.false_changes;
+    }
+
+    LOG_DBG("%s: worst press %d ms, worst release %d ms, %d missed, %d false changes in %zu "
+            "waveforms",
+            name, worst_press_ms, worst_release_ms, missed, false_changes, ARRAY_SIZE(waveforms));
+}
+
+static int debounce_waveforms_init(void) {
+    replay_waveforms(ZMK_DEBOUNCE_INTEGRATOR);
+    replay_waveforms(ZMK_DEBOUNCE_EAGER);
+    replay_waveforms(ZMK_DEBOUNCE_EAGER_PRESS);
+    replay_waveforms(ZMK_DEBOUNCE_DEFER_ROW);
+    return 0;
+}
+
+SYS_INIT(debounce_waveforms_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
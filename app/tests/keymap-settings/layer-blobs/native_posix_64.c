@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include <dt-bindings/zmk/keys.h>
+#include <zmk/behavior.h>
+#include <zmk/keymap.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// A settings backend kept in RAM, so the test can seed entries written by older firmware, count
+// the bytes written and fail writes on demand.
+
+#define RAM_STORE_ENTRIES 8
+
+struct ram_store_entry {
+    char name[24];
+    uint8_t value[64];
+    size_t len;
+};
+
+static struct ram_store_entry ram_store_entries[RAM_STORE_ENTRIES];
+static size_t ram_store_bytes_written;
+static int ram_store_writes;
+static int ram_store_failing_writes;
+
+static struct ram_store_entry *ram_store_find(const char *name) {
+    for (int i = 0; i < ARRAY_SIZE(ram_store_entries); i++) {
+        if (strcmp(ram_store_entries[i].name, name) == 0) {
+            return &ram_store_entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+static int ram_store_put(const char *name, const void *value, size_t len) {
+    struct ram_store_entry *entry = ram_store_find(name);
+    if (!entry) {
+        entry = ram_store_find("");
+    }
+
+    if (!entry || strlen(name) >= sizeof(entry->name) || len > sizeof(entry->value)) {
+        return -ENOMEM;
+    }
+
+    strcpy(entry->name, name);
+    memcpy(entry->value, value, len);
+    entry->len = len;
+
+    return 0;
+}
+
+static int ram_store_count(void) {
+    int count = 0;
+
+    for (int i = 0; i < ARRAY_SIZE(ram_store_entries); i++) {
+        if (ram_store_entries[i].name[0]) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static ssize_t ram_store_read_cb(void *cb_arg, void *data, size_t len) {
+    const struct ram_store_entry *entry = cb_arg;
+
+    len = MIN(len, entry->len);
+    memcpy(data, entry->value, len);
+
+    return len;
+}
+
+static int ram_store_load(struct settings_store *cs, const struct settings_load_arg *arg) {
+    for (int i = 0; i < ARRAY_SIZE(ram_store_entries); i++) {
+        struct ram_store_entry *entry = &ram_store_entries[i];
+
+        if (entry->name[0]) {
+            settings_call_set_handler(entry->name, entry->len, ram_store_read_cb, entry, arg);
+        }
+    }
+
+    return 0;
+}
+
+static int ram_store_save(struct settings_store *cs, const char *name, const char *value,
+                          size_t val_len) {
+    ram_store_writes++;
+
+    if (val_len == 0) {
+        struct ram_store_entry *entry = ram_store_find(name);
+        if (entry) {
+            LOG_DBG("Deleted %s", name);
+            entry->name[0] = '\0';
+        }
+
+        return 0;
+    }
+
+    if (ram_store_failing_writes > 0) {
+        ram_store_failing_writes--;
+        LOG_DBG("Failed to write %s", name);
+        return -ENOSPC;
+    }
+
+    int ret = ram_store_put(name, value, val_len);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ram_store_bytes_written += val_len;
+    LOG_DBG("Wrote %zu bytes to %s", val_len, name);
+
+    return 0;
+}
+
+static const struct settings_store_itf ram_store_itf = {
+    .csi_load = ram_store_load,
+    .csi_save = ram_store_save,
+};
+
+static struct settings_store ram_store = {.cs_itf = &ram_store_itf};
+
+// Matches the per-key binding entries saved before layer blobs were added.
+struct legacy_binding_setting {
+    zmk_behavior_local_id_t behavior_local_id;
+    uint32_t param1;
+    uint32_t param2;
+} __packed;
+
+static int put_legacy_binding(zmk_keymap_layer_id_t layer_id, uint8_t key_position,
+                              uint32_t keycode) {
+    char name[24];
+    const struct legacy_binding_setting setting = {
+        .behavior_local_id =
+            zmk_behavior_get_local_id(zmk_keymap_get_layer_binding_at_idx(0, 0)->behavior_dev),
+        .param1 = keycode,
+    };
+
+    sprintf(name, "keymap/l/%d/%d", layer_id, key_position);
+    return ram_store_put(name, &setting, sizeof(setting));
+}
+
+int settings_backend_init(void) {
+    int ret = put_legacy_binding(0, 1, C);
+    if (ret < 0) {
+        return ret;
+    }
+
+    settings_src_register(&ram_store);
+    settings_dst_register(&ram_store);
+
+    return 0;
+}
+
+#define SETTINGS_TEST_START_MS 50
+#define SETTINGS_TEST_INTERVAL_MS 100
+
+static int settings_test_step;
+static int writes_after_reset;
+
+static void reload_keymap(void) {
+    int64_t start = k_uptime_get();
+
+    LOG_DBG("Reloading the keymap from settings");
+    int ret = zmk_keymap_discard_changes();
+    if (ret < 0) {
+        LOG_ERR("Failed to reload the keymap (%d)", ret);
+        return;
+    }
+
+    LOG_DBG("Reloaded the keymap in %lld ms", k_uptime_get() - start);
+}
+
+static void settings_test_work_cb(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct zmk_behavior_binding binding;
+    size_t bytes_written;
+    int ret = 0;
+
+    switch (settings_test_step++) {
+    case 0:
+        LOG_DBG("Binding &kp D at position 0");
+        binding = *zmk_keymap_get_layer_binding_at_idx(0, 0);
+        binding.param1 = D;
+        ret = zmk_keymap_set_layer_binding_at_idx(0, 0, binding);
+        if (ret < 0) {
+            break;
+        }
+
+        bytes_written = ram_store_bytes_written;
+        ret = zmk_keymap_save_changes();
+        LOG_DBG("Saved changes in %zu bytes", ram_store_bytes_written - bytes_written);
+        break;
+    case 1:
+        reload_keymap();
+        break;
+    case 2:
+        // Leaves a per-key entry behind whose migration fails, so reset has to clear it.
+        LOG_DBG("Adding a per-key entry and failing its migration");
+        ret = put_legacy_binding(0, 0, E);
+        ram_store_failing_writes = 1;
+        reload_keymap();
+        break;
+    case 3:
+        LOG_DBG("Resetting keymap settings");
+        ret = zmk_keymap_reset_settings();
+        writes_after_reset = ram_store_writes;
+        LOG_DBG("%d settings left", ram_store_count());
+        break;
+    case 4:
+        reload_keymap();
+        break;
+    case 5:
+        LOG_DBG("%d settings writes since the reset", ram_store_writes - writes_after_reset);
+        return;
+    }
+
+    if (ret < 0) {
+        LOG_ERR("Failed settings test step %d (%d)", settings_test_step - 1, ret);
+    }
+
+    k_work_schedule(dwork, K_MSEC(SETTINGS_TEST_INTERVAL_MS));
+}
+
+static K_WORK_DELAYABLE_DEFINE(settings_test_work, settings_test_work_cb);
+
+static int settings_test_init(void) {
+    k_work_schedule(&settings_test_work, K_MSEC(SETTINGS_TEST_START_MS));
+    return 0;
+}
+
+SYS_INIT(settings_test_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/kscan.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <zmk/kscan_scan_rate.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// Flips a switch which never bounces, so the time each change takes to be reported shows how much
+// debounce time the driver counted on each scan. The second press lands while the driver is
+// slowing down to 12 ms scans, so it is reported one 3 ms scan after the 12 ms one instead of two.
+
+#define STATS_TIME_MS 1100
+
+static const struct device *test_kscan = DEVICE_DT_GET(DT_NODELABEL(test_kscan));
+static const struct device *test_gpio = DEVICE_DT_GET(DT_NODELABEL(test_gpio));
+
+struct switch_step {
+    int64_t time_ms;
+    int value;
+};
+
+static const struct switch_step switch_steps[] = {
+    {.time_ms = 100, .value = 1},
+    {.time_ms = 200, .value = 0},
+    {.time_ms = 245, .value = 1},
+    {.time_ms = 301, .value = 0},
+};
+
+static int switch_step_index;
+
+static void scan_rate_test_callback(const struct device *dev, uint32_t row, uint32_t column,
+                                    bool pressed) {
+    LOG_DBG("Key %s at %lld ms", pressed ? "pressed" : "released", k_uptime_get());
+}
+
+static void scan_rate_test_work_cb(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+
+    if (switch_step_index < ARRAY_SIZE(switch_steps)) {
+        const struct switch_step *step = &switch_steps[switch_step_index++];
+
+        int ret = gpio_emul_input_set(test_gpio, 0, step->value);
+        if (ret < 0) {
+            LOG_ERR("Failed to set the switch (%d)", ret);
+        }
+
+        const int64_t next_ms = switch_step_index < ARRAY_SIZE(switch_steps)
+                                    ? switch_steps[switch_step_index].time_ms
+                                    : STATS_TIME_MS;
+        k_work_schedule(dwork, K_TIMEOUT_ABS_MS(next_ms));
+        return;
+    }
+
+    struct zmk_kscan_scan_rate_stats stats;
+    int ret = zmk_kscan_scan_rate_get_stats(test_kscan, &stats);
+    if (ret < 0) {
+        LOG_ERR("Failed to get scan statistics (%d)", ret);
+        return;
+    }
+
+    LOG_DBG("%u scans, %u idle, %u wakeups, %u scans per second", stats.scans, stats.idle_scans,
+            stats.wakeups, stats.scans_per_second);
+}
+
+static K_WORK_DELAYABLE_DEFINE(scan_rate_test_work, scan_rate_test_work_cb);
+
+static int scan_rate_test_init(void) {
+    int ret = kscan_config(test_kscan, scan_rate_test_callback);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = kscan_enable_callback(test_kscan);
+    if (ret < 0) {
+        return ret;
+    }
+
+    k_work_schedule(&scan_rate_test_work, K_TIMEOUT_ABS_MS(switch_steps[0].time_ms));
+    return 0;
+}
+
+SYS_INIT(scan_rate_test_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
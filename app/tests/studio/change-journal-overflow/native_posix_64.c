@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <dt-bindings/zmk/keys.h>
+
+#include "../rpc_test.h"
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// Makes more keymap changes than the change journal holds, and checks that the journal reports
+// the revisions it no longer covers while it keeps wrapping around. Studio only resets the cached
+// encoded sizes of the layers the journal says changed, so the keymap is fetched after each batch
+// of changes. The oldest changes that fall out of the journal are the only ones on layer 1, so the
+// keymap only encodes if Studio falls back to resetting every cached size.
+
+struct binding_change {
+    zmk_keymap_layer_id_t layer_id;
+    uint8_t binding_idx;
+    uint32_t param1;
+};
+
+static const struct binding_change first_changes[] = {
+    {0, 0, LC(A)},
+    {1, 0, LC(N1)},
+    {0, 1, LC(B)},
+};
+
+static const struct binding_change overflowing_changes[] = {
+    {1, 1, LC(N2)}, {1, 3, LC(N3)}, {0, 3, LC(C)}, {0, 0, LS(A)}, {0, 1, LS(B)}, {0, 0, LA(A)},
+};
+
+BUILD_ASSERT(ARRAY_SIZE(overflowing_changes) > CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL_SIZE,
+             "The changes must overflow the journal");
+
+static void check_keymap_response(uint32_t request_id, pb_istream_t *stream) {
+    struct rpc_test_keymap keymap;
+
+    if (!rpc_test_decode_keymap(stream, &keymap)) {
+        LOG_ERR("Failed to decode the keymap of response %u", request_id);
+        return;
+    }
+
+    LOG_DBG("Response %u: %zu layers, %d mismatches", request_id, keymap.layers_len,
+            rpc_test_count_keymap_mismatches(&keymap));
+
+    for (size_t l = 0; l < keymap.layers_len; l++) {
+        const struct rpc_test_layer *layer = &keymap.layers[l];
+
+        LOG_DBG("Layer %u (%s): %zu bindings, first param1 0x%x", layer->id, layer->name,
+                layer->bindings_len, layer->bindings[0].param1);
+    }
+}
+
+static void response_cb(struct rpc_test_transport *transport, const uint8_t *msg, size_t len) {
+    uint32_t request_id;
+    pb_istream_t stream;
+
+    if (!rpc_test_get_request_id(msg, len, &request_id)) {
+        LOG_DBG("Notification");
+        return;
+    }
+
+    if (!RPC_TEST_OPEN_RESPONSE(msg, len, keymap, get_keymap, &stream)) {
+        LOG_ERR("Unexpected response to request %u", request_id);
+        return;
+    }
+
+    check_keymap_response(request_id, &stream);
+}
+
+RPC_TEST_TRANSPORT(test_transport, ZMK_TRANSPORT_USB, response_cb);
+
+static int apply_changes(const struct binding_change *changes, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        struct zmk_behavior_binding binding =
+            *zmk_keymap_get_layer_binding_at_idx(changes[i].layer_id, changes[i].binding_idx);
+
+        binding.param1 = changes[i].param1;
+
+        int ret = zmk_keymap_set_layer_binding_at_idx(changes[i].layer_id, changes[i].binding_idx,
+                                                      binding);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    LOG_DBG("Made %zu changes", len);
+    return 0;
+}
+
+static int log_change(const struct zmk_keymap_change *change, void *user_data) {
+    int *visited = user_data;
+
+    (*visited)++;
+    LOG_DBG("%s change on layer %d at position %u",
+            change->type == ZMK_KEYMAP_CHANGE_BINDING ? "Binding" : "Layer", change->layer_id,
+            change->key_position);
+
+    return 0;
+}
+
+static void log_changes_since(uint32_t revision, const char *description) {
+    int visited = 0;
+    int ret = zmk_keymap_foreach_change_since(revision, log_change, &visited);
+
+    LOG_DBG("Changes since %s: %d visited, returned %d", description, visited, ret);
+}
+
+static int send_get_keymap(uint32_t request_id) {
+    zmk_studio_Request req = RPC_TEST_REQUEST(keymap, request_id, get_keymap, true);
+
+    return rpc_test_send_request(&req);
+}
+
+#define JOURNAL_TEST_START_MS 100
+#define JOURNAL_TEST_INTERVAL_MS 100
+
+static int journal_test_step;
+static uint32_t synced_revision;
+
+static void journal_test_work_cb(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    const uint32_t request_id = journal_test_step + 1;
+    uint32_t revision;
+    int ret = 0;
+
+    switch (journal_test_step++) {
+    case 0:
+        break;
+    case 1:
+        ret = apply_changes(first_changes, ARRAY_SIZE(first_changes));
+        log_changes_since(synced_revision, "the first response");
+        break;
+    case 2:
+        ret = apply_changes(overflowing_changes, ARRAY_SIZE(overflowing_changes));
+        revision = zmk_keymap_get_revision();
+        log_changes_since(synced_revision, "the second response");
+        log_changes_since(revision - CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL_SIZE, "the journal start");
+        log_changes_since(revision - CONFIG_ZMK_KEYMAP_CHANGE_JOURNAL_SIZE - 1,
+                          "before the journal start");
+        break;
+    case 3:
+        revision = zmk_keymap_get_revision();
+        log_changes_since(revision, "the latest revision");
+        log_changes_since(revision + 1, "a future revision");
+
+        LOG_DBG("Discarding changes");
+        ret = zmk_keymap_discard_changes();
+        log_changes_since(revision, "before discarding");
+        break;
+    default:
+        return;
+    }
+
+    if (ret >= 0) {
+        synced_revision = zmk_keymap_get_revision();
+        ret = send_get_keymap(request_id);
+    }
+
+    if (ret < 0) {
+        LOG_ERR("Failed journal test step %d (%d)", journal_test_step - 1, ret);
+    }
+
+    k_work_schedule(dwork, K_MSEC(JOURNAL_TEST_INTERVAL_MS));
+}
+
+static K_WORK_DELAYABLE_DEFINE(journal_test_work, journal_test_work_cb);
+
+static int journal_test_init(void) {
+    k_work_schedule(&journal_test_work, K_MSEC(JOURNAL_TEST_START_MS));
+    return 0;
+}
+
+SYS_INIT(journal_test_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
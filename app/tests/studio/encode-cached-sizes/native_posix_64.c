@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <dt-bindings/zmk/keys.h>
+#include <zmk/physical_layouts.h>
+
+#include "../rpc_test.h"
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// Fetches the keymap and physical layouts through Studio RPC, which sizes the layer, binding and
+// layout lists once and reuses the cached sizes for the enclosing submessages. A binding is changed
+// to one with a longer encoding between the keymap requests, so a stale size would make the second
+// response fail to encode. Every response is decoded and compared with the keymap and layouts.
+
+#define MAX_LAYOUT_NAME_LEN 16
+#define MAX_LAYOUT_KEYS 8
+
+struct decoded_layout {
+    char name[MAX_LAYOUT_NAME_LEN];
+    zmk_keymap_KeyPhysicalAttrs keys[MAX_LAYOUT_KEYS];
+    size_t keys_len;
+};
+
+static uint8_t first_layouts_response[RPC_TEST_MAX_MSG_LEN];
+static size_t first_layouts_response_len;
+
+static bool decode_layout_key(pb_istream_t *stream, const pb_field_t *field, void **arg) {
+    struct decoded_layout *layout = *arg;
+
+    if (layout->keys_len >= ARRAY_SIZE(layout->keys)) {
+        return false;
+    }
+
+    return pb_decode(stream, &zmk_keymap_KeyPhysicalAttrs_msg, &layout->keys[layout->keys_len++]);
+}
+
+static bool decode_layout_name(pb_istream_t *stream, const pb_field_t *field, void **arg) {
+    struct decoded_layout *layout = *arg;
+    const size_t len = stream->bytes_left;
+
+    if (len >= sizeof(layout->name)) {
+        return false;
+    }
+
+    layout->name[len] = '\0';
+    return pb_read(stream, (uint8_t *)layout->name, len);
+}
+
+static bool decode_layout(pb_istream_t *stream, const pb_field_t *field, void **arg) {
+    struct decoded_layout *layout = *arg;
+    zmk_keymap_PhysicalLayout msg = zmk_keymap_PhysicalLayout_init_zero;
+
+    // Only the first layout is checked, since the test keymap has just the one.
+    if (layout->name[0]) {
+        return pb_read(stream, NULL, stream->bytes_left);
+    }
+
+    msg.name.funcs.decode = decode_layout_name;
+    msg.name.arg = layout;
+    msg.keys.funcs.decode = decode_layout_key;
+    msg.keys.arg = layout;
+
+    return pb_decode(stream, &zmk_keymap_PhysicalLayout_msg, &msg);
+}
+
+static int count_layout_mismatches(const struct decoded_layout *decoded) {
+    struct zmk_physical_layout const *const *layouts;
+    const size_t layout_count = zmk_physical_layouts_get_list(&layouts);
+
+    if (layout_count == 0 || strcmp(decoded->name, layouts[0]->display_name) != 0 ||
+        decoded->keys_len != layouts[0]->keys_len) {
+        return 1;
+    }
+
+    int mismatches = 0;
+
+    for (size_t k = 0; k < decoded->keys_len; k++) {
+        const struct zmk_key_physical_attrs *key = &layouts[0]->keys[k];
+
+        if (decoded->keys[k].width != key->width || decoded->keys[k].height != key->height ||
+            decoded->keys[k].x != key->x || decoded->keys[k].y != key->y) {
+            mismatches++;
+        }
+    }
+
+    return mismatches;
+}
+
+static void check_keymap_response(uint32_t request_id, pb_istream_t *stream) {
+    struct rpc_test_keymap keymap;
+
+    if (!rpc_test_decode_keymap(stream, &keymap)) {
+        LOG_ERR("Failed to decode the keymap of response %u", request_id);
+        return;
+    }
+
+    LOG_DBG("Response %u: %zu layers, %d mismatches", request_id, keymap.layers_len,
+            rpc_test_count_keymap_mismatches(&keymap));
+
+    for (size_t l = 0; l < keymap.layers_len; l++) {
+        const struct rpc_test_layer *layer = &keymap.layers[l];
+
+        LOG_DBG("Layer %u (%s): %zu bindings, first param1 0x%x", layer->id, layer->name,
+                layer->bindings_len, layer->bindings[0].param1);
+    }
+}
+
+static void check_layouts_response(uint32_t request_id, pb_istream_t *stream, const uint8_t *msg,
+                                   size_t len) {
+    zmk_keymap_PhysicalLayouts layouts = zmk_keymap_PhysicalLayouts_init_zero;
+    struct decoded_layout layout = {0};
+
+    layouts.layouts.funcs.decode = decode_layout;
+    layouts.layouts.arg = &layout;
+
+    if (!pb_decode(stream, &zmk_keymap_PhysicalLayouts_msg, &layouts)) {
+        LOG_ERR("Failed to decode the layouts of response %u", request_id);
+        return;
+    }
+
+    if (first_layouts_response_len == 0) {
+        memcpy(first_layouts_response, msg, len);
+        first_layouts_response_len = len;
+    }
+
+    LOG_DBG("Response %u: layout %s, %zu keys, %d mismatches, %s the first", request_id,
+            layout.name, layout.keys_len, count_layout_mismatches(&layout),
+            len == first_layouts_response_len && memcmp(msg, first_layouts_response, len) == 0
+                ? "same as"
+                : "differs from");
+}
+
+static void response_cb(struct rpc_test_transport *transport, const uint8_t *msg, size_t len) {
+    uint32_t request_id;
+    pb_istream_t stream;
+
+    if (!rpc_test_get_request_id(msg, len, &request_id)) {
+        LOG_DBG("Notification");
+        return;
+    }
+
+    if (RPC_TEST_OPEN_RESPONSE(msg, len, keymap, get_keymap, &stream)) {
+        check_keymap_response(request_id, &stream);
+    } else if (RPC_TEST_OPEN_RESPONSE(msg, len, keymap, get_physical_layouts, &stream)) {
+        check_layouts_response(request_id, &stream, msg, len);
+    } else {
+        LOG_ERR("Unexpected response to request %u", request_id);
+    }
+}
+
+RPC_TEST_TRANSPORT(test_transport, ZMK_TRANSPORT_USB, response_cb);
+
+#define ENCODE_TEST_START_MS 100
+#define ENCODE_TEST_INTERVAL_MS 100
+
+static int encode_test_step;
+
+static void encode_test_work_cb(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    const uint32_t request_id = encode_test_step + 1;
+    struct zmk_behavior_binding binding;
+    zmk_studio_Request req;
+    int ret = 0;
+
+    switch (encode_test_step++) {
+    case 0:
+        req = RPC_TEST_REQUEST(keymap, request_id, get_keymap, true);
+        ret = rpc_test_send_request(&req);
+        break;
+    case 1:
+        LOG_DBG("Binding &kp LC(A) at position 0 on layer 0");
+        binding = *zmk_keymap_get_layer_binding_at_idx(0, 0);
+        binding.param1 = LC(A);
+        ret = zmk_keymap_set_layer_binding_at_idx(0, 0, binding);
+        if (ret < 0) {
+            break;
+        }
+
+        req = RPC_TEST_REQUEST(keymap, request_id, get_keymap, true);
+        ret = rpc_test_send_request(&req);
+        break;
+    case 2:
+    case 3:
+        req = RPC_TEST_REQUEST(keymap, request_id, get_physical_layouts, true);
+        ret = rpc_test_send_request(&req);
+        break;
+    default:
+        return;
+    }
+
+    if (ret < 0) {
+        LOG_ERR("Failed encode test step %d (%d)", encode_test_step - 1, ret);
+    }
+
+    k_work_schedule(dwork, K_MSEC(ENCODE_TEST_INTERVAL_MS));
+}
+
+static K_WORK_DELAYABLE_DEFINE(encode_test_work, encode_test_work_cb);
+
+static int encode_test_init(void) {
+    k_work_schedule(&encode_test_work, K_MSEC(ENCODE_TEST_START_MS));
+    return 0;
+}
+
+SYS_INIT(encode_test_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "../../../src/studio/msg_framing.h"
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// Checks the block framing codec against the per-byte state machine. Random payloads, heavy in
+// framing byte values, are escaped in random output chunk sizes and compared with escaping one
+// byte at a time. Streams of frames, some of them corrupted, are then decoded in random input and
+// output chunk sizes and compared with feeding studio_framing_process_byte() one byte at a time.
+
+#define PAYLOADS 400
+#define MAX_PAYLOAD_LEN 64
+#define STREAMS 200
+#define MAX_STREAM_FRAMES 6
+#define CORRUPT_STREAMS 40
+#define MAX_CHUNK_LEN 24
+
+#define MAX_STREAM_LEN (MAX_STREAM_FRAMES * (2 * MAX_PAYLOAD_LEN + 2) + MAX_STREAM_FRAMES)
+
+static uint8_t payload[MAX_PAYLOAD_LEN];
+static uint8_t expected[2 * MAX_PAYLOAD_LEN];
+static uint8_t encoded[2 * MAX_PAYLOAD_LEN];
+static uint8_t stream[MAX_STREAM_LEN];
+static uint8_t byte_out[MAX_STREAM_LEN];
+static uint8_t block_out[MAX_STREAM_LEN];
+static size_t byte_frame_ends[MAX_STREAM_LEN];
+static size_t block_frame_ends[MAX_STREAM_LEN];
+static uint32_t random_state;
+
+static uint32_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static uint32_t random_range(const uint32_t min, const uint32_t max) {
+    return min + next_random() % (max - min + 1);
+}
+
+static uint8_t random_byte(void) {
+    // One byte in four is SOF, ESC or EOF.
+    const uint32_t r = next_random();
+    return (r & 0x3) == 0 ? FRAMING_SOF + (r >> 8) % 3 : r >> 24;
+}
+
+static size_t escape_bytewise(const uint8_t *data, const size_t len, uint8_t *out) {
+    size_t written = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == FRAMING_SOF || data[i] == FRAMING_ESC || data[i] == FRAMING_EOF) {
+            out[written++] = FRAMING_ESC;
+        }
+        out[written++] = data[i];
+    }
+
+    return written;
+}
+
+static size_t escape_in_chunks(const uint8_t *data, const size_t len, uint8_t *out) {
+    size_t consumed = 0;
+    size_t written = 0;
+    bool escape_pending = false;
+
+    while (consumed < len || escape_pending) {
+        size_t chunk_written;
+
+        consumed += studio_framing_encode_block(&data[consumed], len - consumed, &out[written],
+                                                random_range(1, MAX_CHUNK_LEN), &chunk_written,
+                                                &escape_pending);
+        written += chunk_written;
+    }
+
+    return written;
+}
+
+static void check_encoding(void) {
+    int mismatches = 0;
+    size_t bytes = 0;
+    size_t escaped_bytes = 0;
+
+    for (int n = 0; n < PAYLOADS; n++) {
+        const size_t len = random_range(0, MAX_PAYLOAD_LEN);
+
+        for (size_t i = 0; i < len; i++) {
+            payload[i] = random_byte();
+        }
+
+        const size_t expected_len = escape_bytewise(payload, len, expected);
+        const size_t encoded_len = escape_in_chunks(payload, len, encoded);
+
+        if (studio_framing_encoded_len(payload, len) != expected_len ||
+            encoded_len != expected_len || memcmp(encoded, expected, expected_len) != 0) {
+            mismatches++;
+        }
+
+        bytes += len;
+        escaped_bytes += expected_len;
+    }
+
+    LOG_DBG("%d payloads, %zu bytes escaped to %zu, %d mismatches", PAYLOADS, bytes,
+            escaped_bytes, mismatches);
+}
+
+static size_t build_stream(const bool corrupt) {
+    const int frames = random_range(1, MAX_STREAM_FRAMES);
+    size_t len = 0;
+
+    for (int f = 0; f < frames; f++) {
+        const size_t payload_len = random_range(0, MAX_PAYLOAD_LEN);
+
+        for (size_t i = 0; i < payload_len; i++) {
+            payload[i] = random_byte();
+        }
+
+        stream[len++] = FRAMING_SOF;
+        len += escape_bytewise(payload, payload_len, &stream[len]);
+        stream[len++] = FRAMING_EOF;
+
+        // Stray bytes between frames.
+        if (corrupt && (next_random() & 0x1)) {
+            stream[len++] = random_byte();
+        }
+    }
+
+    if (corrupt) {
+        for (int i = random_range(1, 4); i > 0; i--) {
+            stream[next_random() % len] = random_byte();
+        }
+    }
+
+    return len;
+}
+
+struct decode_result {
+    size_t out_len;
+    size_t frames;
+};
+
+static struct decode_result decode_bytewise(const uint8_t *data, const size_t len) {
+    enum studio_framing_state state = FRAMING_STATE_IDLE;
+    struct decode_result result = {0};
+
+    for (size_t i = 0; i < len; i++) {
+        if (studio_framing_process_byte(&state, data[i])) {
+            byte_out[result.out_len++] = data[i];
+        }
+
+        if (state == FRAMING_STATE_EOF) {
+            byte_frame_ends[result.frames++] = result.out_len;
+            state = FRAMING_STATE_IDLE;
+        }
+    }
+
+    return result;
+}
+
+static struct decode_result decode_in_chunks(const uint8_t *data, const size_t len) {
+    enum studio_framing_state state = FRAMING_STATE_IDLE;
+    struct decode_result result = {0};
+    size_t consumed = 0;
+
+    while (consumed < len) {
+        const size_t chunk_len = MIN(random_range(1, MAX_CHUNK_LEN), len - consumed);
+        const size_t out_size = random_range(1, MAX_CHUNK_LEN);
+        size_t decoded;
+
+        consumed += studio_framing_process_block(&state, &data[consumed], chunk_len,
+                                                 &block_out[result.out_len], out_size, &decoded);
+        result.out_len += decoded;
+
+        // Like rpc_read_cb(), the caller starts looking for the next frame after an EOF.
+        if (state == FRAMING_STATE_EOF) {
+            block_frame_ends[result.frames++] = result.out_len;
+            state = FRAMING_STATE_IDLE;
+        }
+    }
+
+    return result;
+}
+
+static void check_decoding(const char *name, const int streams, const bool corrupt) {
+    int mismatches = 0;
+    size_t bytes = 0;
+    size_t frames = 0;
+
+    for (int n = 0; n < streams; n++) {
+        const size_t len = build_stream(corrupt);
+        const struct decode_result bytewise = decode_bytewise(stream, len);
+        const struct decode_result chunked = decode_in_chunks(stream, len);
+
+        if (chunked.out_len != bytewise.out_len || chunked.frames != bytewise.frames ||
+            memcmp(block_out, byte_out, bytewise.out_len) != 0 ||
+            memcmp(block_frame_ends, byte_frame_ends, bytewise.frames * sizeof(size_t)) != 0) {
+            mismatches++;
+        }
+
+        bytes += len;
+        frames += bytewise.frames;
+    }
+
+    LOG_DBG("%s: %d streams, %zu bytes with %zu frames, %d mismatches", name, streams, bytes,
+            frames, mismatches);
+}
+
+static int framing_codec_init(void) {
+    random_state = 0xf4a3;
+
+    check_encoding();
+    check_decoding("clean", STREAMS, false);
+    check_decoding("corrupt", CORRUPT_STREAMS, true);
+
+    return 0;
+}
+
+SYS_INIT(framing_codec_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <zmk/events/endpoint_changed.h>
+
+#include "../rpc_test.h"
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+// Queues requests behind a response that is stuck waiting for space in the TX buffer, then
+// switches the endpoint from USB to BLE. The switch waits for the response being sent to finish,
+// and the requests still queued from USB must be dropped rather than answered over BLE. A request
+// sent after the switch is answered over BLE.
+
+static void response_cb(struct rpc_test_transport *transport, const uint8_t *msg, size_t len) {
+    uint32_t request_id;
+
+    if (!rpc_test_get_request_id(msg, len, &request_id)) {
+        LOG_DBG("%s: notification", transport->name);
+        return;
+    }
+
+    LOG_DBG("%s: response to request %u", transport->name, request_id);
+}
+
+RPC_TEST_TRANSPORT(usb_transport, ZMK_TRANSPORT_USB, response_cb);
+RPC_TEST_TRANSPORT(ble_transport, ZMK_TRANSPORT_BLE, response_cb);
+
+#define PIPELINE_TEST_START_MS 100
+#define PIPELINE_TEST_INTERVAL_MS 100
+#define PIPELINE_TEST_UNSTALL_MS 50
+
+// Runs outside the work queue, which is blocked switching transports until the response finishes.
+static void unstall_timer_expiry(struct k_timer *timer) {
+    LOG_DBG("Unstalling %s", usb_transport.name);
+    usb_transport.stalled = false;
+    rpc_test_drain(&usb_transport);
+}
+
+static K_TIMER_DEFINE(unstall_timer, unstall_timer_expiry, NULL);
+
+static int pipeline_test_step;
+
+static void pipeline_test_work_cb(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    zmk_studio_Request req;
+    int ret = 0;
+
+    switch (pipeline_test_step++) {
+    case 0:
+        LOG_DBG("Sending 3 requests while %s is stalled", usb_transport.name);
+        usb_transport.stalled = true;
+
+        req = RPC_TEST_REQUEST(keymap, 1, get_keymap, true);
+        ret = rpc_test_send_request(&req);
+        for (uint32_t request_id = 2; ret >= 0 && request_id <= 3; request_id++) {
+            req = RPC_TEST_REQUEST(core, request_id, get_lock_state, true);
+            ret = rpc_test_send_request(&req);
+        }
+        break;
+    case 1:
+        LOG_DBG("Switching to BLE");
+        k_timer_start(&unstall_timer, K_MSEC(PIPELINE_TEST_UNSTALL_MS), K_NO_WAIT);
+        ret = raise_zmk_endpoint_changed((struct zmk_endpoint_changed){
+            .endpoint = {.transport = ZMK_TRANSPORT_BLE},
+        });
+        break;
+    case 2:
+        LOG_DBG("Sending request 4");
+        req = RPC_TEST_REQUEST(core, 4, get_lock_state, true);
+        ret = rpc_test_send_request(&req);
+        break;
+    default:
+        return;
+    }
+
+    if (ret < 0) {
+        LOG_ERR("Failed pipeline test step %d (%d)", pipeline_test_step - 1, ret);
+    }
+
+    k_work_schedule(dwork, K_MSEC(PIPELINE_TEST_INTERVAL_MS));
+}
+
+static K_WORK_DELAYABLE_DEFINE(pipeline_test_work, pipeline_test_work_cb);
+
+static int pipeline_test_init(void) {
+    k_work_schedule(&pipeline_test_work, K_MSEC(PIPELINE_TEST_START_MS));
+    return 0;
+}
+
+SYS_INIT(pipeline_test_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+// Helpers shared by the Studio RPC tests. A test registers one or more transports in place of the
+// UART transport, sends framed requests through the RX buffer, and gets every response sent on
+// its transports back unframed, so it can pick them apart with nanopb.
+
+#include <errno.h>
+#include <string.h>
+
+#include <pb_decode.h>
+#include <pb_encode.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include <zmk/behavior.h>
+#include <zmk/keymap.h>
+#include <zmk/matrix.h>
+#include <zmk/studio/rpc.h>
+
+#include "../../src/studio/msg_framing.h"
+
+#define RPC_TEST_MAX_MSG_LEN 512
+#define RPC_TEST_MAX_REQUEST_LEN 32
+
+struct rpc_test_transport;
+
+typedef void (*rpc_test_response_cb)(struct rpc_test_transport *transport, const uint8_t *msg,
+                                     size_t len);
+
+struct rpc_test_transport {
+    const char *name;
+    rpc_test_response_cb response_cb;
+    /** While set, sent bytes are left in the TX buffer, as if the host had stopped reading. */
+    bool stalled;
+    enum studio_framing_state framing_state;
+    uint8_t msg[RPC_TEST_MAX_MSG_LEN];
+    size_t msg_len;
+};
+
+// Takes everything sent so far out of the TX buffer, and passes on each response it completes.
+static inline void rpc_test_drain(struct rpc_test_transport *transport) {
+    struct ring_buf *tx_buf = zmk_rpc_get_tx_buf();
+    uint8_t *data;
+    uint32_t len;
+
+    while ((len = ring_buf_get_claim(tx_buf, &data, UINT32_MAX)) > 0) {
+        for (uint32_t i = 0; i < len; i++) {
+            if (studio_framing_process_byte(&transport->framing_state, data[i]) &&
+                transport->msg_len < sizeof(transport->msg)) {
+                transport->msg[transport->msg_len++] = data[i];
+            }
+
+            if (transport->framing_state == FRAMING_STATE_EOF) {
+                transport->response_cb(transport, transport->msg, transport->msg_len);
+                transport->msg_len = 0;
+                transport->framing_state = FRAMING_STATE_IDLE;
+            }
+        }
+
+        ring_buf_get_finish(tx_buf, len);
+    }
+
+    zmk_rpc_tx_space_notify();
+}
+
+static inline void rpc_test_tx_notify(struct ring_buf *buf, size_t added, bool message_done,
+                                      void *user_data) {
+    struct rpc_test_transport *transport = user_data;
+
+    if (!transport->stalled) {
+        rpc_test_drain(transport);
+    }
+}
+
+/**
+ * @brief Register a test transport in place of the transport of the given type. It logs when its
+ *        RX is started and stopped, so it must be used after LOG_MODULE_DECLARE.
+ * @param _name The identifier of the `struct rpc_test_transport` to define.
+ * @param _transport The `enum zmk_transport` the transport is selected for.
+ * @param _response_cb The `rpc_test_response_cb` invoked with each response.
+ */
+#define RPC_TEST_TRANSPORT(_name, _transport, _response_cb)                                        \
+    static struct rpc_test_transport _name = {                                                     \
+        .name = #_name,                                                                            \
+        .response_cb = _response_cb,                                                               \
+    };                                                                                             \
+    static void *_name##_tx_user_data(void) { return &_name; }                                     \
+    static int _name##_rx_start(void) {                                                            \
+        LOG_DBG("RX started");                                                                     \
+        return 0;                                                                                  \
+    }                                                                                              \
+    static int _name##_rx_stop(void) {                                                             \
+        LOG_DBG("RX stopped");                                                                     \
+        return 0;                                                                                  \
+    }                                                                                              \
+    ZMK_RPC_TRANSPORT(_name##_rpc_transport, _transport, _name##_rx_start, _name##_rx_stop,        \
+                      _name##_tx_user_data, rpc_test_tx_notify)
+
+/**
+ * @brief Create a zmk_studio_Request struct for the given subsystem and type, like
+ *        ZMK_RPC_RESPONSE does for responses.
+ */
+#define RPC_TEST_REQUEST(subsys, _request_id, _type, ...)                                          \
+    ((zmk_studio_Request){                                                                         \
+        .request_id = _request_id,                                                                 \
+        .which_subsystem = zmk_studio_Request_##subsys##_tag,                                      \
+        .subsystem =                                                                               \
+            {                                                                                      \
+                .subsys =                                                                          \
+                    {                                                                              \
+                        .which_request_type = zmk_##subsys##_Request_##_type##_tag,                \
+                        .request_type = {._type = __VA_ARGS__},                                    \
+                    },                                                                             \
+            },                                                                                     \
+    })
+
+static inline int rpc_test_send_request(const zmk_studio_Request *req) {
+    uint8_t msg[RPC_TEST_MAX_REQUEST_LEN];
+    uint8_t frame[2 * RPC_TEST_MAX_REQUEST_LEN + 2];
+    size_t frame_len = 0;
+    pb_ostream_t stream = pb_ostream_from_buffer(msg, sizeof(msg));
+
+    if (!pb_encode(&stream, &zmk_studio_Request_msg, req)) {
+        return -EINVAL;
+    }
+
+    frame[frame_len++] = FRAMING_SOF;
+    for (size_t i = 0; i < stream.bytes_written; i++) {
+        if (msg[i] == FRAMING_SOF || msg[i] == FRAMING_ESC || msg[i] == FRAMING_EOF) {
+            frame[frame_len++] = FRAMING_ESC;
+        }
+        frame[frame_len++] = msg[i];
+    }
+    frame[frame_len++] = FRAMING_EOF;
+
+    struct ring_buf *rx_buf = zmk_rpc_get_rx_buf();
+    if (ring_buf_space_get(rx_buf) < frame_len) {
+        return -ENOSPC;
+    }
+
+    ring_buf_put(rx_buf, frame, frame_len);
+    zmk_rpc_rx_notify();
+
+    return 0;
+}
+
+// Opens a stream over the first field in the message with the given tag, which must be a
+// submessage, string or bytes field.
+static inline bool rpc_test_open_field(pb_istream_t *stream, uint32_t tag,
+                                       pb_istream_t *field_stream) {
+    pb_wire_type_t wire_type;
+    uint32_t field_tag;
+    bool eof;
+
+    while (pb_decode_tag(stream, &wire_type, &field_tag, &eof)) {
+        if (field_tag == tag && wire_type == PB_WT_STRING) {
+            return pb_make_string_substream(stream, field_stream);
+        }
+
+        if (!pb_skip_field(stream, wire_type)) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+static inline bool rpc_test_read_uint32_field(pb_istream_t *stream, uint32_t tag,
+                                              uint32_t *value) {
+    pb_wire_type_t wire_type;
+    uint32_t field_tag;
+    bool eof;
+
+    while (pb_decode_tag(stream, &wire_type, &field_tag, &eof)) {
+        if (field_tag == tag && wire_type == PB_WT_VARINT) {
+            return pb_decode_varint32(stream, value);
+        }
+
+        if (!pb_skip_field(stream, wire_type)) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the ID of the request a response answers.
+ * @retval false if the message is a notification, or cannot be decoded.
+ */
+static inline bool rpc_test_get_request_id(const uint8_t *msg, size_t len, uint32_t *request_id) {
+    pb_istream_t stream = pb_istream_from_buffer(msg, len);
+    pb_istream_t request_response;
+
+    return rpc_test_open_field(&stream, zmk_studio_Response_request_response_tag,
+                               &request_response) &&
+           rpc_test_read_uint32_field(&request_response, zmk_studio_RequestResponse_request_id_tag,
+                                      request_id);
+}
+
+/**
+ * @brief Open a stream over the response of the given subsystem and type, e.g. the encoded
+ *        zmk_keymap_Keymap of a keymap get_keymap response.
+ */
+#define RPC_TEST_OPEN_RESPONSE(msg, len, subsys, _type, stream)                                    \
+    rpc_test_open_response(msg, len, zmk_studio_RequestResponse_##subsys##_tag,                    \
+                           zmk_##subsys##_Response_##_type##_tag, stream)
+
+static inline bool rpc_test_open_response(const uint8_t *msg, size_t len,
+                                          uint32_t subsystem_tag, uint32_t type_tag,
+                                          pb_istream_t *response) {
+    pb_istream_t stream = pb_istream_from_buffer(msg, len);
+    pb_istream_t request_response;
+    pb_istream_t subsystem_response;
+
+    return rpc_test_open_field(&stream, zmk_studio_Response_request_response_tag,
+                               &request_response) &&
+           rpc_test_open_field(&request_response, subsystem_tag, &subsystem_response) &&
+           rpc_test_open_field(&subsystem_response, type_tag, response);
+}
+
+struct rpc_test_layer {
+    uint32_t id;
+    char name[CONFIG_ZMK_KEYMAP_LAYER_NAME_MAX_LEN + 1];
+    zmk_keymap_BehaviorBinding bindings[ZMK_KEYMAP_LEN];
+    size_t bindings_len;
+};
+
+struct rpc_test_keymap {
+    struct rpc_test_layer layers[ZMK_KEYMAP_LAYERS_LEN];
+    size_t layers_len;
+};
+
+static inline bool rpc_test_decode_binding(pb_istream_t *stream, const pb_field_t *field,
+                                           void **arg) {
+    struct rpc_test_layer *layer = *arg;
+
+    if (layer->bindings_len >= ARRAY_SIZE(layer->bindings)) {
+        return false;
+    }
+
+    return pb_decode(stream, &zmk_keymap_BehaviorBinding_msg,
+                     &layer->bindings[layer->bindings_len++]);
+}
+
+static inline bool rpc_test_decode_layer_name(pb_istream_t *stream, const pb_field_t *field,
+                                              void **arg) {
+    struct rpc_test_layer *layer = *arg;
+    const size_t len = stream->bytes_left;
+
+    if (len >= sizeof(layer->name)) {
+        return false;
+    }
+
+    layer->name[len] = '\0';
+    return pb_read(stream, (uint8_t *)layer->name, len);
+}
+
+static inline bool rpc_test_decode_layer(pb_istream_t *stream, const pb_field_t *field,
+                                         void **arg) {
+    struct rpc_test_keymap *keymap = *arg;
+
+    if (keymap->layers_len >= ARRAY_SIZE(keymap->layers)) {
+        return false;
+    }
+
+    struct rpc_test_layer *layer = &keymap->layers[keymap->layers_len++];
+    zmk_keymap_Layer msg = zmk_keymap_Layer_init_zero;
+
+    msg.name.funcs.decode = rpc_test_decode_layer_name;
+    msg.name.arg = layer;
+    msg.bindings.funcs.decode = rpc_test_decode_binding;
+    msg.bindings.arg = layer;
+
+    if (!pb_decode(stream, &zmk_keymap_Layer_msg, &msg)) {
+        return false;
+    }
+
+    layer->id = msg.id;
+    return true;
+}
+
+/**
+ * @brief Decode a get_keymap response, opened with RPC_TEST_OPEN_RESPONSE.
+ */
+static inline bool rpc_test_decode_keymap(pb_istream_t *stream, struct rpc_test_keymap *keymap) {
+    zmk_keymap_Keymap msg = zmk_keymap_Keymap_init_zero;
+
+    memset(keymap, 0, sizeof(*keymap));
+    msg.layers.funcs.decode = rpc_test_decode_layer;
+    msg.layers.arg = keymap;
+
+    return pb_decode(stream, &zmk_keymap_Keymap_msg, &msg);
+}
+
+/**
+ * @brief Count the layers and bindings of a decoded keymap which differ from the current keymap.
+ */
+static inline int rpc_test_count_keymap_mismatches(const struct rpc_test_keymap *keymap) {
+    int mismatches = 0;
+
+    for (zmk_keymap_layer_index_t l = 0; l < ZMK_KEYMAP_LAYERS_LEN; l++) {
+        const zmk_keymap_layer_id_t layer_id = zmk_keymap_layer_index_to_id(l);
+
+        if (layer_id == UINT8_MAX) {
+            mismatches += keymap->layers_len != l;
+            break;
+        }
+
+        if (l >= keymap->layers_len) {
+            mismatches++;
+            continue;
+        }
+
+        const struct rpc_test_layer *layer = &keymap->layers[l];
+        const char *name = zmk_keymap_layer_name(layer_id);
+
+        if (layer->id != layer_id || strcmp(layer->name, name ? name : "") != 0 ||
+            layer->bindings_len != ZMK_KEYMAP_LEN) {
+            mismatches++;
+            continue;
+        }
+
+        for (int b = 0; b < ZMK_KEYMAP_LEN; b++) {
+            const struct zmk_behavior_binding *binding =
+                zmk_keymap_get_layer_binding_at_idx(layer_id, b);
+            zmk_keymap_BehaviorBinding expected = zmk_keymap_BehaviorBinding_init_zero;
+
+            if (binding && binding->behavior_dev) {
+                expected.behavior_id = zmk_behavior_get_local_id(binding->behavior_dev);
+                expected.param1 = binding->param1;
+                expected.param2 = binding->param2;
+            }
+
+            if (layer->bindings[b].behavior_id != expected.behavior_id ||
+                layer->bindings[b].param1 != expected.param1 ||
+                layer->bindings[b].param2 != expected.param2) {
+                mismatches++;
+            }
+        }
+    }
+
+    return mismatches;
+}
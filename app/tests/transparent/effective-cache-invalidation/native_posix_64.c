@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2025 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <dt-bindings/zmk/keys.h>
+#include <zmk/keymap.h>
+
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#define EDIT_KEYMAP_START_MS 100
+#define EDIT_KEYMAP_INTERVAL_MS 50
+
+static int edit_step;
+
+static void edit_keymap_work_cb(struct k_work *work) {
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct zmk_behavior_binding binding;
+    int ret;
+
+    switch (edit_step++) {
+    case 0:
+        LOG_DBG("Moving layer 1 above layer 2");
+        ret = zmk_keymap_move_layer(2, 1);
+        break;
+    case 1:
+        LOG_DBG("Binding &kp E at position 2 of layer 1");
+        binding = *zmk_keymap_get_layer_binding_at_idx(1, 2);
+        binding.param1 = E;
+        ret = zmk_keymap_set_layer_binding_at_idx(1, 2, binding);
+        break;
+    case 2:
+        LOG_DBG("Discarding changes");
+        ret = zmk_keymap_discard_changes();
+        break;
+    default:
+        return;
+    }
+
+    if (ret < 0) {
+        LOG_ERR("Failed to edit the keymap (%d)", ret);
+    }
+
+    k_work_schedule(dwork, K_MSEC(EDIT_KEYMAP_INTERVAL_MS));
+}
+
+static K_WORK_DELAYABLE_DEFINE(edit_keymap_work, edit_keymap_work_cb);
+
+static int edit_keymap_init(void) {
+    k_work_schedule(&edit_keymap_work, K_MSEC(EDIT_KEYMAP_START_MS));
+    return 0;
+}
+
+SYS_INIT(edit_keymap_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);